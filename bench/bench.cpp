@@ -0,0 +1,504 @@
+#include <core.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+using namespace ch::core;
+
+// heap allocations made by this process, read by the --allocs mode
+static std::atomic<uint64_t> g_num_allocs(0);
+
+void* operator new(size_t size) {
+  g_num_allocs.fetch_add(1, std::memory_order_relaxed);
+  auto ptr = malloc(size ? size : 1);
+  if (nullptr == ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace {
+
+// synthetic design: a register pipeline of mixing stages
+template <unsigned N>
+struct Pipeline {
+  __io (
+    __in (ch_uint<N>)  in,
+    __out (ch_uint<N>) out
+  );
+
+  Pipeline(uint32_t stages) : stages_(stages) {}
+
+  void describe() {
+    std::vector<ch_uint<N>> stages;
+    stages.emplace_back(io.in);
+    for (uint32_t i = 0; i < stages_; ++i) {
+      auto& x = stages.back();
+      auto y = ch_next(((x << 1) ^ (x >> 3)) + (x & i));
+      stages.emplace_back(y);
+    }
+    io.out = stages.back();
+  }
+
+  uint32_t stages_;
+};
+
+template <unsigned N>
+int run_pipeline(uint32_t scale, uint32_t ticks) {
+  ch_device<Pipeline<N>> device(32 * scale);
+  ch_simulator sim(device);
+  auto t = sim.reset(0);
+  for (uint32_t i = 0; i < ticks; i += 2) {
+    device.io.in = i;
+    t = sim.step(t, 2);
+  }
+  std::cout << "out = " << device.io.out << std::endl;
+  return 0;
+}
+
+struct workload_t {
+  std::string name;
+  std::vector<std::string> args;
+  std::string cwd;
+};
+
+struct backend_t {
+  const char* name;
+  int cflags;
+};
+
+// backend cflags as passed through CASH_CFLAGS
+template <typename... Flags>
+static int backend_cflags(Flags... flags) {
+  return (0 | ... | static_cast<int>(flags));
+}
+
+struct result_t {
+  std::string design;
+  std::string backend;
+  int status;
+  double wall;
+  long peak_rss;
+  std::string profile;
+};
+
+std::string self_path() {
+  char buf[4096];
+  auto len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+  if (len < 0)
+    return "";
+  buf[len] = 0;
+  return buf;
+}
+
+std::string read_file(const std::string& filename) {
+  std::ifstream in(filename);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  auto str = ss.str();
+  while (!str.empty() && isspace(str.back())) {
+    str.pop_back();
+  }
+  return str;
+}
+
+double profile_value(const std::string& profile, const std::string& key) {
+  auto pos = profile.find("\"" + key + "\":");
+  if (pos == std::string::npos)
+    return 0;
+  return std::atof(profile.c_str() + pos + key.size() + 3);
+}
+
+result_t run_workload(const workload_t& workload,
+                      const backend_t& backend,
+                      int base_cflags,
+                      const std::string& profile_file) {
+  result_t result;
+  result.design  = workload.name;
+  result.backend = backend.name;
+  result.status  = -1;
+  result.wall    = 0;
+  result.peak_rss = 0;
+
+  unlink(profile_file.c_str());
+
+  auto start = std::chrono::steady_clock::now();
+  auto pid = fork();
+  if (0 == pid) {
+    // silence the workload output
+    if (!freopen("/dev/null", "w", stdout)
+     || !freopen("/dev/null", "w", stderr)) {
+      _exit(127);
+    }
+    if (!workload.cwd.empty() && chdir(workload.cwd.c_str()) != 0) {
+      _exit(127);
+    }
+    auto cflags = std::to_string(base_cflags | backend.cflags);
+    setenv("CASH_CFLAGS", cflags.c_str(), 1);
+    setenv("CASH_PROFILE", profile_file.c_str(), 1);
+    std::vector<char*> argv;
+    for (auto& arg : workload.args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  if (pid < 0)
+    return result;
+
+  int status = 0;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0)
+    return result;
+  auto end = std::chrono::steady_clock::now();
+  result.wall = std::chrono::duration<double>(end - start).count();
+  result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+  result.peak_rss = usage.ru_maxrss;
+  result.profile = read_file(profile_file);
+  return result;
+}
+
+void print_result(std::ostream& out, const result_t& result) {
+  auto elaborate = profile_value(result.profile, "elaborate");
+  auto optimize  = profile_value(result.profile, "optimize");
+  auto jit       = profile_value(result.profile, "jit");
+  auto simulate  = profile_value(result.profile, "simulate");
+  auto ticks     = profile_value(result.profile, "ticks");
+  // two ticks per clock cycle
+  auto cycles_per_sec = (simulate > 0) ? (ticks / 2) / simulate : 0.0;
+  out << "    {\"design\": \"" << result.design << "\""
+      << ", \"backend\": \"" << result.backend << "\""
+      << ", \"status\": " << result.status
+      << ", \"elaborate_s\": " << elaborate
+      << ", \"optimize_s\": " << optimize
+      << ", \"jit_s\": " << jit
+      << ", \"simulate_s\": " << simulate
+      << ", \"cycles\": " << static_cast<uint64_t>(ticks / 2)
+      << ", \"cycles_per_s\": " << cycles_per_sec
+      << ", \"peak_rss_kb\": " << result.peak_rss
+      << ", \"wall_s\": " << result.wall
+      << "}";
+}
+
+// times one call of a word kernel in nanoseconds
+template <typename F>
+double time_kernel(F&& func, uint32_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// microbenchmarks of the wide bitvector kernels per instruction set and width
+int run_kernels(std::ostream& out, uint32_t iterations) {
+  using namespace ch::internal;
+  std::vector<simd::isa_type> isas{simd::isa_type::generic};
+  auto host = simd::detect_isa();
+  if (host >= simd::isa_type::avx2) {
+    isas.push_back(simd::isa_type::avx2);
+  }
+  if (host >= simd::isa_type::avx512) {
+    isas.push_back(simd::isa_type::avx512);
+  }
+  static const char* isa_names[] = {"generic", "avx2", "avx512"};
+
+  out << "{" << std::endl;
+  out << "  \"isa\": \"" << isa_names[static_cast<int>(host)] << "\"," << std::endl;
+  out << "  \"kernels\": [" << std::endl;
+  bool first = true;
+  auto print = [&](const char* kernel, const char* isa, uint32_t width, double ns) {
+    out << (first ? "" : ",\n")
+        << "    {\"kernel\": \"" << kernel << "\""
+        << ", \"isa\": \"" << isa << "\""
+        << ", \"width\": " << width
+        << ", \"ns\": " << ns << "}";
+    first = false;
+  };
+
+  volatile uint64_t sink = 0;
+  for (uint32_t width : {256, 512, 1024, 2048}) {
+    uint32_t n = width / 64;
+    std::vector<uint64_t> a(n + 1), b(n + 1), c(n + 1);
+    for (uint32_t i = 0; i <= n; ++i) {
+      a[i] = 0x9e3779b97f4a7c15ull * (i + 1);
+      b[i] = a[i];
+    }
+    // equality scans equal values, ordering a difference in the lowest word
+    auto d = a;
+    b[0] ^= 1;
+    for (auto isa : isas) {
+      auto& k = simd::get_kernels(isa);
+      auto name = isa_names[static_cast<int>(isa)];
+      print("and", name, width, time_kernel([&]() { k.bit_and(c.data(), a.data(), b.data(), n); }, iterations));
+      print("or", name, width, time_kernel([&]() { k.bit_or(c.data(), a.data(), b.data(), n); }, iterations));
+      print("xor", name, width, time_kernel([&]() { k.bit_xor(c.data(), a.data(), b.data(), n); }, iterations));
+      print("inv", name, width, time_kernel([&]() { k.bit_inv(c.data(), a.data(), n); }, iterations));
+      print("eq", name, width, time_kernel([&]() { sink = sink + k.eq(a.data(), d.data(), n); }, iterations));
+      print("lt", name, width, time_kernel([&]() { sink = sink + k.diff(a.data(), b.data(), n); }, iterations));
+      print("slice", name, width, time_kernel([&]() { k.shr(c.data(), a.data(), n, 13); }, iterations));
+    }
+    print("add", "generic", width, time_kernel([&]() { sink = sink + simd::generic::add(c.data(), a.data(), b.data(), n); }, iterations));
+    print("add", "native", width, time_kernel([&]() { sink = sink + simd::add(c.data(), a.data(), b.data(), n); }, iterations));
+    print("sub", "generic", width, time_kernel([&]() { sink = sink + simd::generic::sub(c.data(), a.data(), b.data(), n); }, iterations));
+    print("sub", "native", width, time_kernel([&]() { sink = sink + simd::sub(c.data(), a.data(), b.data(), n); }, iterations));
+  }
+#ifdef CH_LIMBS_INT128
+  // multiply and divide, truncated to the operand width and at full width
+  for (uint32_t width : {256, 512, 1024, 2048, 4096}) {
+    uint32_t n = width / 64;
+    std::vector<uint64_t> a(n), b(n), c(2 * n), q(n), r(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      a[i] = 0x9e3779b97f4a7c15ull * (i + 1);
+      b[i] = ~a[i];
+    }
+    auto mul_iterations = std::max<uint32_t>(iterations / (n * n / 16 + 1), 10);
+    print("mul", "native", width, time_kernel([&]() { limbs::mul(c.data(), n, a.data(), n, b.data(), n); }, mul_iterations));
+    print("mul_full", "native", width, time_kernel([&]() { limbs::mul(c.data(), 2 * n, a.data(), n, b.data(), n); }, mul_iterations));
+    print("div", "native", width, time_kernel([&]() { limbs::div(q.data(), n, r.data(), n, c.data(), 2 * n, b.data(), n); }, mul_iterations));
+  }
+#endif
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+  return 0;
+}
+
+// JIT compile time of a design split into many regions per compile thread count
+int run_jit_threads(std::ostream& out, uint32_t scale, const std::string& profile_file) {
+  workload_t workload{"pipe256x" + std::to_string(scale),
+                      {self_path(), "--synth", "pipe256", std::to_string(scale), "2"}, ""};
+  backend_t backend{"simjit", backend_cflags(ch_flags::disable_tex)};
+  std::vector<uint32_t> threads{1, 2, 4, 8};
+  auto cores = std::thread::hardware_concurrency();
+  if (cores > 8) {
+    threads.push_back(cores);
+  }
+  // small regions yield one function per region to compile
+  setenv("CASH_JIT_REGION_SIZE", "256", 1);
+
+  out << "{" << std::endl;
+  out << "  \"design\": \"" << workload.name << "\"," << std::endl;
+  out << "  \"cores\": " << cores << "," << std::endl;
+  out << "  \"results\": [" << std::endl;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    setenv("CASH_JIT_THREADS", std::to_string(threads[i]).c_str(), 1);
+    std::cerr << "compiling " << workload.name << " on " << threads[i] << " threads ..." << std::endl;
+    auto result = run_workload(workload, backend, 0, profile_file);
+    out << "    {\"threads\": " << threads[i]
+        << ", \"status\": " << result.status
+        << ", \"jit_s\": " << profile_value(result.profile, "jit")
+        << ", \"wall_s\": " << result.wall
+        << "}" << ((i + 1 < threads.size()) ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl;
+  out << "}" << std::endl;
+  unlink(profile_file.c_str());
+  return 0;
+}
+
+template <typename F>
+double count_allocs(F&& func, uint32_t iterations) {
+  auto start = g_num_allocs.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < iterations; ++i) {
+    func();
+  }
+  auto end = g_num_allocs.load(std::memory_order_relaxed);
+  return double(end - start) / iterations;
+}
+
+template <unsigned N>
+double suint_allocs(uint32_t iterations) {
+  ch_suint<N> a(0x12345678), b(0x9abcdef);
+  return count_allocs([&]() {
+    ch_suint<N> c = (a + b) ^ (a << 3);
+    b = c - a;
+  }, iterations);
+}
+
+template <unsigned N>
+double elaborate_allocs() {
+  return count_allocs([]() {
+    ch_device<Pipeline<N>> device(32);
+  }, 1);
+}
+
+// heap allocations per operation on system values and per elaboration
+int run_allocs(std::ostream& out, uint32_t iterations) {
+  using namespace ch::internal;
+  out << "{" << std::endl;
+  out << "  \"allocs\": [" << std::endl;
+  bool first = true;
+  auto print = [&](const char* op, uint32_t width, double allocs) {
+    out << (first ? "" : ",\n")
+        << "    {\"op\": \"" << op << "\""
+        << ", \"width\": " << width
+        << ", \"allocs\": " << allocs << "}";
+    first = false;
+  };
+
+  for (uint32_t width : {32, 64, 128, 256, 512}) {
+    sdata_type a(width, 0x5a5a5a5a);
+    print("sdata_create", width, count_allocs([&]() { sdata_type b(width, 1); }, iterations));
+    print("sdata_copy", width, count_allocs([&]() { sdata_type b(a); }, iterations));
+    print("sdata_move", width, count_allocs([&]() {
+      sdata_type b(std::move(a));
+      a = std::move(b);
+    }, iterations));
+  }
+  print("suint_alu", 64, suint_allocs<64>(iterations));
+  print("suint_alu", 128, suint_allocs<128>(iterations));
+  print("suint_alu", 256, suint_allocs<256>(iterations));
+  print("elaborate", 64, elaborate_allocs<64>());
+  print("elaborate", 256, elaborate_allocs<256>());
+
+  out << std::endl << "  ]" << std::endl;
+  out << "}" << std::endl;
+  return 0;
+}
+
+void usage() {
+  std::cerr << "usage: cash-bench [-o <file>] [-f <design>] [-t <ticks>] [-s <scale>...]" << std::endl;
+  std::cerr << "       cash-bench --kernels [<iterations>]" << std::endl;
+  std::cerr << "       cash-bench --allocs [<iterations>]" << std::endl;
+  std::cerr << "       cash-bench --jit-threads [<scale>]" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+  // child mode: run a synthetic design
+  if (argc == 5 && 0 == strcmp(argv[1], "--synth")) {
+    std::string name(argv[2]);
+    auto scale = std::atoi(argv[3]);
+    auto ticks = std::atoi(argv[4]);
+    if (name == "pipe64")
+      return run_pipeline<64>(scale, ticks);
+    if (name == "pipe256")
+      return run_pipeline<256>(scale, ticks);
+    return 1;
+  }
+
+  // kernel mode: time the bitvector kernels
+  if (argc >= 2 && 0 == strcmp(argv[1], "--kernels")) {
+    auto iterations = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+    return run_kernels(std::cout, iterations);
+  }
+
+  // allocation mode: count heap allocations of system values
+  if (argc >= 2 && 0 == strcmp(argv[1], "--allocs")) {
+    auto iterations = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    return run_allocs(std::cout, iterations);
+  }
+
+  auto profile_file = "/tmp/cash-bench." + std::to_string(getpid()) + ".json";
+
+  // compile mode: time the JIT with increasing compile threads
+  if (argc >= 2 && 0 == strcmp(argv[1], "--jit-threads")) {
+    auto scale = (argc > 2) ? std::atoi(argv[2]) : 16;
+    return run_jit_threads(std::cout, scale, profile_file);
+  }
+
+  std::string out_file;
+  std::string filter;
+  uint32_t ticks = 20000;
+  std::vector<uint32_t> scales;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-o" && i + 1 < argc) {
+      out_file = argv[++i];
+    } else if (arg == "-f" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "-t" && i + 1 < argc) {
+      ticks = std::atoi(argv[++i]);
+    } else if (arg == "-s" && i + 1 < argc) {
+      scales.push_back(std::atoi(argv[++i]));
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (scales.empty()) {
+    scales = {1, 4, 16};
+  }
+
+  std::vector<workload_t> workloads;
+  for (auto name : {"aes", "fft", "sobel", "matmul", "vectoradd", "gcd", "sqrt"}) {
+    workloads.push_back({name, {std::string(CASH_BENCH_BINDIR) + "/" + name}, CASH_BENCH_EXAMPLESDIR});
+  }
+  auto self = self_path();
+  for (auto name : {"pipe64", "pipe256"}) {
+    for (auto scale : scales) {
+      auto design = std::string(name) + "x" + std::to_string(scale);
+      workloads.push_back({design, {self, "--synth", name, std::to_string(scale), std::to_string(ticks)}, ""});
+    }
+  }
+
+  // only the JIT backend selected at build time is available
+  std::vector<backend_t> backends;
+#if defined(LLVMJIT)
+  backends.push_back({"simjit-llvm", backend_cflags(ch_flags::disable_tex)});
+  backends.push_back({"simjit-llvm-nolayout", backend_cflags(ch_flags::disable_tex, ch_flags::disable_lay)});
+  backends.push_back({"simjit-llvm-nowide", backend_cflags(ch_flags::disable_tex, ch_flags::disable_wid)});
+#elif defined(LIBJIT)
+  backends.push_back({"simjit-libjit", backend_cflags(ch_flags::disable_tex)});
+  backends.push_back({"simjit-libjit-nolayout", backend_cflags(ch_flags::disable_tex, ch_flags::disable_lay)});
+#endif
+  backends.push_back({"simref", backend_cflags(ch_flags::disable_jit)});
+
+  auto base_cflags = static_cast<int>(ch_getflags());
+
+  std::vector<result_t> results;
+  for (auto& workload : workloads) {
+    if (!filter.empty() && workload.name.find(filter) == std::string::npos)
+      continue;
+    for (auto& backend : backends) {
+      std::cerr << "running " << workload.name << " on " << backend.name << " ..." << std::endl;
+      results.push_back(run_workload(workload, backend, base_cflags, profile_file));
+    }
+  }
+  unlink(profile_file.c_str());
+
+  std::ofstream file;
+  if (!out_file.empty()) {
+    file.open(out_file);
+  }
+  auto& out = out_file.empty() ? std::cout : file;
+  out << "{" << std::endl;
+  out << "  \"ticks\": " << ticks << "," << std::endl;
+  out << "  \"results\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i) {
+    print_result(out, results[i]);
+    out << ((i + 1 < results.size()) ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl;
+  out << "}" << std::endl;
+
+  return 0;
+}
@@ -29,6 +29,10 @@ public:
   typedef word_t  block_type;
   typedef size_t  size_type;
 
+  // values up to this many bits are stored inline without a heap allocation
+  static constexpr uint32_t INLINE_SIZE  = 128;
+  static constexpr uint32_t INLINE_WORDS = INLINE_SIZE / bitwidth_v<word_t>;
+
   class const_iterator;
   class iterator;
 
@@ -415,9 +419,13 @@ public:
     std::copy_n(other.words_, other.num_words(), words_);
   }
 
-  bitvector(bitvector&& other) {
-    words_ = other.words_;
-    size_  = other.size_;
+  bitvector(bitvector&& other) noexcept
+    : words_(other.words_)
+    , size_(other.size_) {
+    if (other.is_inline()) {
+      std::copy_n(other.inline_, other.num_words(), inline_);
+      words_ = inline_;
+    }
     other.size_ = 0;
     other.words_ = nullptr;
   }
@@ -432,12 +440,14 @@ public:
     return *this;
   }
 
-  bitvector& operator=(bitvector&& other) {
-    if (words_) {
-      delete [] words_;
-    }
+  bitvector& operator=(bitvector&& other) noexcept {
+    this->release();
     size_  = other.size_;
     words_ = other.words_;
+    if (other.is_inline()) {
+      std::copy_n(other.inline_, other.num_words(), inline_);
+      words_ = inline_;
+    }
     other.size_ = 0;
     other.words_ = nullptr;
     return *this;
@@ -546,19 +556,18 @@ public:
   }
 
   void clear() {
-    delete [] words_;
+    this->release();
+    words_ = nullptr;
     size_ = 0;
   }
 
   void resize(uint32_t size) {
     uint32_t old_num_words = ceildiv(size_, bitwidth_v<word_t>);
     uint32_t new_num_words = ceildiv(size, bitwidth_v<word_t>);
-    if (new_num_words != old_num_words) {
-      auto words = new word_t[new_num_words];
-      if (words_) {
-        delete [] words_;
-      }
-      words_ = words;      
+    if (new_num_words != old_num_words || nullptr == words_) {
+      auto words = (new_num_words <= INLINE_WORDS) ? inline_ : new word_t[new_num_words];
+      this->release();
+      words_ = words;
     }
     size_ = size;
 
@@ -786,8 +795,21 @@ public:
 
 protected:
 
+  bool is_inline() const {
+    return (words_ == inline_);
+  }
+
+  // frees heap storage, inline storage and empty values own nothing
+  void release() {
+    if (!this->is_inline()) {
+      delete [] words_;
+    }
+  }
+
+  // must stay the first member, the simulator writes external word pointers here
   word_t* words_;
   uint32_t size_;
+  word_t inline_[INLINE_WORDS];
 };
 
 template <typename word_t>
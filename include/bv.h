@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.h"
+#include "simd.h"
+#include "limbs.h"
 
 namespace ch {
 namespace internal {
@@ -889,6 +891,14 @@ void bv_slice_vector_unaligned(T* w_dst, uint32_t dst_size, const T* w_src, uint
 
   // update intermediate blocks
   auto w_dst_end = (w_dst++) + w_dst_end_idx;
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    uint32_t count = w_dst_end - w_dst;
+    if (count >= simd::MIN_WORDS) {
+      simd::kernels().shr(w_dst, w_src, count, w_src_lsb);
+      w_dst += count;
+      w_src += count;
+    }
+  }
   while (w_dst < w_dst_end) {
     T tmp = *w_src++ >> w_src_lsb;
     *w_dst++ = tmp | (w_src[0] << (WORD_SIZE - w_src_lsb));
@@ -1203,6 +1213,13 @@ bool bv_eq_vector(const T* lhs, uint32_t lhs_size, const T* rhs, uint32_t rhs_si
   BitAccessor arg0(lhs, lhs_size, rhs_size);
   BitAccessor arg1(rhs, rhs_size, lhs_size);
   auto num_words = ceildiv(std::max(lhs_size, rhs_size), bitwidth_v<T>);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()
+     && !arg1.need_resize()) {
+      return simd::kernels().eq(lhs, rhs, num_words);
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     if (arg0.get(i) != arg1.get(i))
       return false;
@@ -1254,6 +1271,14 @@ bool bv_lt_vector(const T* lhs, uint32_t lhs_size, const T* rhs, uint32_t rhs_si
 
   // same-sign words comparison
   uint32_t num_words = ceildiv(std::max(lhs_size, rhs_size), WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()
+     && !arg1.need_resize()) {
+      auto i = simd::kernels().diff(lhs, rhs, num_words);
+      return (i >= 0) && (lhs[i] < rhs[i]);
+    }
+  }
   for (int32_t i = static_cast<int32_t>(num_words) - 1; i >= 0; --i) {
     if (arg0.get(i) != arg1.get(i))
       return (arg0.get(i) < arg1.get(i));
@@ -1488,6 +1513,14 @@ void bv_inv_vector(T* out, uint32_t out_size, const T* in, uint32_t in_size) {
   BitAccessor arg0(in, in_size, out_size);
 
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()) {
+      simd::kernels().bit_inv(out, in, num_words);
+      bv_clear_extra_bits(out, out_size);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     out[i] = ~arg0.get(i);
   }
@@ -1530,6 +1563,14 @@ void bv_and_vector(T* out, uint32_t out_size, const T* lhs, uint32_t lhs_size, c
   BitAccessor arg1(rhs, rhs_size, out_size);
 
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()
+     && !arg1.need_resize()) {
+      simd::kernels().bit_and(out, lhs, rhs, num_words);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     out[i] = arg0.get(i) & arg1.get(i);
   }
@@ -1578,6 +1619,14 @@ void bv_or_vector(T* out, uint32_t out_size, const T* lhs, uint32_t lhs_size, co
   BitAccessor arg1(rhs, rhs_size, out_size);
 
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()
+     && !arg1.need_resize()) {
+      simd::kernels().bit_or(out, lhs, rhs, num_words);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     out[i] = arg0.get(i) | arg1.get(i);
   }
@@ -1626,6 +1675,14 @@ void bv_xor_vector(T* out, uint32_t out_size, const T* lhs, uint32_t lhs_size, c
   BitAccessor arg1(rhs, rhs_size, out_size);
 
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (num_words >= simd::MIN_WORDS
+     && !arg0.need_resize()
+     && !arg1.need_resize()) {
+      simd::kernels().bit_xor(out, lhs, rhs, num_words);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     out[i] = arg0.get(i) ^ arg1.get(i);
   }
@@ -1924,6 +1981,14 @@ void bv_add_vector(T* out, uint32_t out_size, const T* lhs, uint32_t lhs_size, c
 
   T carry(0);
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (!arg0.need_resize()
+     && !arg1.need_resize()) {
+      simd::add(out, lhs, rhs, num_words);
+      bv_clear_extra_bits(out, out_size);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     auto a = arg0.get(i);
     auto b = arg1.get(i);
@@ -1969,6 +2034,14 @@ void bv_sub_vector(T* out, uint32_t out_size, const T* lhs, uint32_t lhs_size, c
 
   T borrow(0);
   uint32_t num_words = ceildiv(out_size, WORD_SIZE);
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    if (!arg0.need_resize()
+     && !arg1.need_resize()) {
+      simd::sub(out, lhs, rhs, num_words);
+      bv_clear_extra_bits(out, out_size);
+      return;
+    }
+  }
   for (uint32_t i = 0; i < num_words; ++i) {
     auto a = arg0.get(i);
     auto b = arg1.get(i);
@@ -2006,6 +2079,16 @@ void bv_umul(T* out, uint32_t out_size,
   assert(out_size <= lhs_size + rhs_size);
   static constexpr uint32_t XWORD_SIZE = bitwidth_v<xword_t>;
 
+#ifdef CH_LIMBS_INT128
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    limbs::mul(out, ceildiv(out_size, 64),
+               lhs, ceildiv(lhs_size, 64),
+               rhs, ceildiv(rhs_size, 64));
+    bv_clear_extra_bits(out, out_size);
+    return;
+  }
+#endif
+
   auto u = reinterpret_cast<const xword_t*>(lhs);
   auto v = reinterpret_cast<const xword_t*>(rhs);
   auto w = reinterpret_cast<xword_t*>(out);
@@ -2124,6 +2207,17 @@ void bv_udiv(T* quot, uint32_t quot_size,
     throw std::runtime_error("divide by zero");
   }
 
+#ifdef CH_LIMBS_INT128
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    auto m64 = ceildiv<int>(bv_msb(lhs, lhs_size) + 1, 64);
+    auto n64 = ceildiv<int>(bv_msb(rhs, rhs_size) + 1, 64);
+    if (m64 >= n64) {
+      limbs::div(quot, ceildiv(quot_size, 64), rem, ceildiv(rem_size, 64), lhs, m64, rhs, n64);
+      return;
+    }
+  }
+#endif
+
   // reset the outputs
   if (qn) {
     std::fill_n(q, qn, 0);
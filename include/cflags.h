@@ -26,7 +26,13 @@ enum class ch_flags {
   disable_snc     = (1 << 17), // 131072
   disable_cpb     = (1 << 18), // 262144
   merged_only_opt = (1 << 19), // 524288
-  verbose_tracing = (1 << 20)  // 1048576
+  verbose_tracing = (1 << 20), // 1048576
+  disable_tex     = (1 << 21), // 2097152
+  disable_act     = (1 << 22), // 4194304
+  disable_bwn     = (1 << 24), // 16777216
+  hash_consing    = (1 << 25), // 33554432
+  disable_lay     = (1 << 26), // 67108864
+  disable_wid     = (1 << 27)  // 134217728
 };
 
 inline constexpr auto operator|(ch_flags lsh, ch_flags rhs) {
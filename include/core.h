@@ -375,7 +375,9 @@ namespace system {
 
   using ch::internal::ch_device;
   using ch::internal::ch_simulator;
+  using ch::internal::ch_simopts;
   using ch::internal::ch_tracer;
+  using ch::internal::ch_cwfreader;
   using ch::internal::ch_flags;
 
   //
@@ -383,8 +385,12 @@ namespace system {
   //
 
   using ch::internal::ch_stats;
+  using ch::internal::ch_optstats;
+  using ch::internal::ch_opt_stats;
+  using ch::internal::ch_pass_stats;
   using ch::internal::ch_setflags;
   using ch::internal::ch_getflags;
+  using ch::internal::ch_setircache;
 
   //
   // codegen functions
@@ -108,7 +108,46 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// cache the elaborated design of top-level devices without constructor
+// arguments in 'dir' (also set by CASH_IR_CACHE), reloading it skips
+// describe() and the optimizer. Entries are keyed by the device name, the
+// compiler flags and 'fingerprint', which defaults to the running executable
+// identity. An empty 'dir' disables the cache.
+void ch_setircache(const std::string& dir, const std::string& fingerprint = "");
+
+///////////////////////////////////////////////////////////////////////////////
+
 void ch_stats(std::ostream& out, const device_base& device);
 
+///////////////////////////////////////////////////////////////////////////////
+
+struct ch_pass_stats {
+  std::string name;
+  uint32_t runs;    // number of executions
+  uint32_t changes; // executions that modified the graph
+  double time;      // wall time in seconds
+  int64_t nodes;    // net change in node count
+
+  ch_pass_stats(const std::string& p_name)
+    : name(p_name), runs(0), changes(0), time(0), nodes(0)
+  {}
+};
+
+struct ch_opt_stats {
+  uint32_t iterations; // fixpoint iterations
+  uint64_t nodes_before;
+  uint64_t nodes_after;
+  double time;         // wall time in seconds
+  std::vector<ch_pass_stats> passes;
+
+  ch_opt_stats() : iterations(0), nodes_before(0), nodes_after(0), time(0) {}
+
+  ch_pass_stats& pass(const std::string& name);
+
+  ch_opt_stats& operator+=(const ch_opt_stats& other);
+};
+
+ch_opt_stats ch_optstats(const device_base& device);
+
 }
 }
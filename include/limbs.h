@@ -0,0 +1,366 @@
+#pragma once
+
+#include "simd.h"
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SIZEOF_INT128__)
+  #define CH_LIMBS_INT128
+#endif
+
+#ifdef CH_LIMBS_INT128
+
+namespace ch {
+namespace internal {
+namespace limbs {
+
+// multiplications with both operands at least this many words use Karatsuba
+static constexpr uint32_t KARATSUBA_THRESHOLD = 24;
+
+// truncated products of at least this many words split recursively
+static constexpr uint32_t MULLO_THRESHOLD = 96;
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// propagates a carry into w[0..n), returns the carry out
+inline uint64_t incr(uint64_t* w, uint32_t n, uint64_t c) {
+  for (uint32_t i = 0; c && i < n; ++i) {
+    w[i] += c;
+    c = (w[i] < c);
+  }
+  return c;
+}
+
+// propagates a borrow into w[0..n), returns the borrow out
+inline uint64_t decr(uint64_t* w, uint32_t n, uint64_t b) {
+  for (uint32_t i = 0; b && i < n; ++i) {
+    auto x = w[i];
+    w[i] = x - b;
+    b = (x < b);
+  }
+  return b;
+}
+
+// w[0..wn) += x[0..xn), xn <= wn, returns the carry out
+inline uint64_t add_into(uint64_t* w, uint32_t wn, const uint64_t* x, uint32_t xn) {
+  auto c = simd::add(w, w, x, xn);
+  return incr(w + xn, wn - xn, c);
+}
+
+// w[0..wn) -= x[0..xn), xn <= wn, returns the borrow out
+inline uint64_t sub_from(uint64_t* w, uint32_t wn, const uint64_t* x, uint32_t xn) {
+  auto b = simd::sub(w, w, x, xn);
+  return decr(w + xn, wn - xn, b);
+}
+
+// w[0..n) += u[0..n) * b, returns the carry word
+inline uint64_t addmul_1(uint64_t* w, const uint64_t* u, uint32_t n, uint64_t b) {
+  uint64_t c = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto t = uint128_t(u[i]) * b + w[i] + c;
+    w[i] = uint64_t(t);
+    c = uint64_t(t >> 64);
+  }
+  return c;
+}
+
+// w[0..n) -= u[0..n) * b, returns the borrow word
+inline uint64_t submul_1(uint64_t* w, const uint64_t* u, uint32_t n, uint64_t b) {
+  uint64_t c = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto t = uint128_t(u[i]) * b + c;
+    auto lo = uint64_t(t);
+    auto x = w[i];
+    w[i] = x - lo;
+    c = uint64_t(t >> 64) + (x < lo);
+  }
+  return c;
+}
+
+// (hi:lo) / d with hi < d, returns the quotient and the remainder in r
+inline uint64_t div_2by1(uint64_t hi, uint64_t lo, uint64_t d, uint64_t* r) {
+#ifdef CH_SIMD_X86
+  uint64_t q;
+  __asm__("divq %4" : "=a"(q), "=d"(*r) : "0"(lo), "1"(hi), "rm"(d));
+  return q;
+#else
+  auto n = (uint128_t(hi) << 64) | lo;
+  *r = uint64_t(n % d);
+  return uint64_t(n / d);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// w[0..m+n) = u[0..m) * v[0..n)
+inline void mul_basecase(uint64_t* w,
+                         const uint64_t* u, uint32_t m,
+                         const uint64_t* v, uint32_t n) {
+  std::fill_n(w, m, 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    w[i + m] = addmul_1(w + i, u, m, v[i]);
+  }
+}
+
+// w[0..n) = low n words of u[0..n) * v[0..n)
+inline void mullo_basecase(uint64_t* w, const uint64_t* u, const uint64_t* v, uint32_t n) {
+  std::fill_n(w, n, 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    addmul_1(w + i, u, n - i, v[i]);
+  }
+}
+
+// scratch words needed by karatsuba()
+inline uint32_t karatsuba_scratch(uint32_t n) {
+  if (n < KARATSUBA_THRESHOLD)
+    return 0;
+  auto k = n - n / 2;
+  return 4 * (k + 1) + karatsuba_scratch(k + 1);
+}
+
+// w[0..2n) = a[0..n) * b[0..n)
+inline void karatsuba(uint64_t* w, const uint64_t* a, const uint64_t* b, uint32_t n, uint64_t* scratch) {
+  if (n < KARATSUBA_THRESHOLD) {
+    mul_basecase(w, a, n, b, n);
+    return;
+  }
+
+  // split into low halves of h words and high halves of k words
+  auto h = n / 2;
+  auto k = n - h;
+  auto sa = scratch;
+  auto sb = sa + (k + 1);
+  auto z1 = sb + (k + 1);
+  auto next = z1 + 2 * (k + 1);
+
+  // (a0 + a1) * (b0 + b1)
+  std::copy_n(a + h, k, sa);
+  sa[k] = add_into(sa, k, a, h);
+  std::copy_n(b + h, k, sb);
+  sb[k] = add_into(sb, k, b, h);
+  karatsuba(z1, sa, sb, k + 1, next);
+
+  // a0 * b0 and a1 * b1
+  karatsuba(w, a, b, h, next);
+  karatsuba(w + 2 * h, a + h, b + h, k, next);
+
+  // middle term
+  sub_from(z1, 2 * (k + 1), w, 2 * h);
+  sub_from(z1, 2 * (k + 1), w + 2 * h, 2 * k);
+  add_into(w + h, 2 * n - h, z1, 2 * k + 1);
+}
+
+// scratch words needed by mullo()
+inline uint32_t mullo_scratch(uint32_t n) {
+  if (n < MULLO_THRESHOLD)
+    return 0;
+  auto h = n - n / 2;
+  auto l = n / 2;
+  return 2 * h + l + std::max(karatsuba_scratch(h), mullo_scratch(l));
+}
+
+// w[0..n) = low n words of a[0..n) * b[0..n)
+inline void mullo(uint64_t* w, const uint64_t* a, const uint64_t* b, uint32_t n, uint64_t* scratch) {
+  if (n < MULLO_THRESHOLD) {
+    mullo_basecase(w, a, b, n);
+    return;
+  }
+
+  // only the low product is needed in full,
+  // the cross products are truncated recursively.
+  auto h = n - n / 2;
+  auto l = n / 2;
+  auto t = scratch;
+  auto c = t + 2 * h;
+  auto next = c + l;
+
+  karatsuba(t, a, b, h, next);
+  std::copy_n(t, n, w);
+
+  mullo(c, a + h, b, l, next);
+  add_into(w + h, l, c, l);
+
+  mullo(c, a, b + h, l, next);
+  add_into(w + h, l, c, l);
+}
+
+// w[0..m+n) = u[0..m) * v[0..n), m >= n
+inline void mul_full(uint64_t* w,
+                     const uint64_t* u, uint32_t m,
+                     const uint64_t* v, uint32_t n) {
+  assert(m >= n);
+  if (n < KARATSUBA_THRESHOLD) {
+    mul_basecase(w, u, m, v, n);
+    return;
+  }
+
+  std::vector<uint64_t> scratch(2 * n + karatsuba_scratch(n));
+  auto t = scratch.data();
+  auto next = t + 2 * n;
+
+  if (m == n) {
+    karatsuba(w, u, v, n, next);
+    return;
+  }
+
+  // unbalanced operands are multiplied in n-word chunks
+  std::fill_n(w, m + n, 0);
+  for (uint32_t i = 0; i < m; i += n) {
+    auto len = std::min(n, m - i);
+    if (len == n) {
+      karatsuba(t, u + i, v, n, next);
+    } else {
+      mul_full(t, v, n, u + i, len);
+    }
+    add_into(w + i, m + n - i, t, len + n);
+  }
+}
+
+// w[0..p) = low p words of u[0..m) * v[0..n)
+inline void mul(uint64_t* w, uint32_t p,
+                const uint64_t* u, uint32_t m,
+                const uint64_t* v, uint32_t n) {
+  // words above p do not contribute to the result
+  m = std::min(m, p);
+  n = std::min(n, p);
+  while (m && 0 == u[m - 1]) --m;
+  while (n && 0 == v[n - 1]) --n;
+  if (0 == m || 0 == n) {
+    std::fill_n(w, p, 0);
+    return;
+  }
+  if (m < n) {
+    std::swap(u, v);
+    std::swap(m, n);
+  }
+
+  if (n < KARATSUBA_THRESHOLD) {
+    std::fill_n(w, p, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+      auto len = std::min(m, p - i);
+      auto c = addmul_1(w + i, u, len, v[i]);
+      if (i + m < p) {
+        w[i + m] = c;
+      }
+    }
+  } else if (m == p && n == p) {
+    std::vector<uint64_t> scratch(mullo_scratch(p));
+    mullo(w, u, v, p, scratch.data());
+  } else if (m + n <= p) {
+    mul_full(w, u, m, v, n);
+    std::fill(w + m + n, w + p, 0);
+  } else {
+    std::vector<uint64_t> t(m + n);
+    mul_full(t.data(), u, m, v, n);
+    std::copy_n(t.data(), p, w);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Knuth's algorithm D on 64-bit words.
+// divides u[0..m) by v[0..n), with m >= n and v[n-1] != 0,
+// writes the first qn quotient words and the first rn remainder words.
+inline void div(uint64_t* q, uint32_t qn,
+                uint64_t* r, uint32_t rn,
+                const uint64_t* u, uint32_t m,
+                const uint64_t* v, uint32_t n) {
+  assert(m >= n && n && v[n - 1]);
+
+  if (qn) {
+    std::fill_n(q, qn, 0);
+  }
+  if (rn) {
+    std::fill_n(r, rn, 0);
+  }
+
+  if (1 == n) {
+    // short division
+    auto d = v[0];
+    uint64_t rem = 0;
+    for (int i = m - 1; i >= 0; --i) {
+      auto qi = div_2by1(rem, u[i], d, &rem);
+      if (uint32_t(i) < qn)
+        q[i] = qi;
+    }
+    if (rn) {
+      r[0] = rem;
+    }
+    return;
+  }
+
+  std::vector<uint64_t> tmp(m + 1 + n);
+  auto un = tmp.data();
+  auto vn = un + m + 1;
+
+  // normalize so that the divisor's top bit is set
+  int s = __builtin_clzll(v[n - 1]);
+  if (s) {
+    un[m] = u[m - 1] >> (64 - s);
+    for (int i = m - 1; i > 0; --i) {
+      un[i] = (u[i] << s) | (u[i - 1] >> (64 - s));
+    }
+    un[0] = u[0] << s;
+    for (int i = n - 1; i > 0; --i) {
+      vn[i] = (v[i] << s) | (v[i - 1] >> (64 - s));
+    }
+    vn[0] = v[0] << s;
+  } else {
+    un[m] = 0;
+    std::copy_n(u, m, un);
+    std::copy_n(v, n, vn);
+  }
+
+  auto v1 = vn[n - 1];
+  auto v2 = vn[n - 2];
+
+  for (int j = m - n; j >= 0; --j) {
+    // estimate the quotient word from the top two words of the divisor
+    uint64_t qhat, rhat;
+    bool overflow = false;
+    if (un[j + n] >= v1) {
+      qhat = ~uint64_t(0);
+      rhat = un[j + n - 1] + v1;
+      overflow = (rhat < v1);
+    } else {
+      qhat = div_2by1(un[j + n], un[j + n - 1], v1, &rhat);
+    }
+    while (!overflow
+        && uint128_t(qhat) * v2 > ((uint128_t(rhat) << 64) | un[j + n - 2])) {
+      --qhat;
+      rhat += v1;
+      overflow = (rhat < v1);
+    }
+
+    // multiply and subtract, add back if the estimate was one too large
+    auto b = submul_1(un + j, vn, n, qhat);
+    auto t = un[j + n];
+    un[j + n] = t - b;
+    if (t < b) {
+      --qhat;
+      un[j + n] += simd::add(un + j, un + j, vn, n);
+    }
+
+    if (uint32_t(j) < qn)
+      q[j] = qhat;
+  }
+
+  if (rn) {
+    // unnormalize the remainder
+    auto k = std::min(n, rn);
+    if (s) {
+      for (uint32_t i = 0; i < k; ++i) {
+        r[i] = (un[i] >> s) | (un[i + 1] << (64 - s));
+      }
+    } else {
+      std::copy_n(un, k, r);
+    }
+  }
+}
+
+}
+}
+}
+
+#endif
@@ -97,7 +97,7 @@ class lnodeimpl;
 class lnode {
 public:
 
-  lnode() : impl_(nullptr), next_user_(nullptr) {}
+  lnode() : impl_(nullptr), next_user_(nullptr), prev_user_(nullptr) {}
 
   lnode(lnodeimpl* impl);
 
@@ -145,6 +145,7 @@ protected:
 
   mutable lnodeimpl* impl_;
   lnode* next_user_;
+  lnode* prev_user_;
 
   friend class lnodeimpl;
 };
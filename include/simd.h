@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace ch {
+namespace internal {
+namespace simd {
+
+// vectors shorter than this many words use the scalar loops
+static constexpr uint32_t MIN_WORDS = 4;
+
+enum class isa_type {
+  generic,
+  avx2,
+  avx512,
+};
+
+// word kernels of the wide bitvector operations, all sizes are in 64-bit words
+struct kernels_t {
+  isa_type isa;
+  void (*bit_and)(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+  void (*bit_or)(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+  void (*bit_xor)(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+  void (*bit_inv)(uint64_t* out, const uint64_t* in, uint32_t n);
+  // returns true if all words are equal
+  bool (*eq)(const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+  // returns the index of the most significant differing word, or -1
+  int32_t (*diff)(const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+  // out[i] = (in[i] >> shift) | (in[i+1] << (64 - shift)), reads n+1 words
+  void (*shr)(uint64_t* out, const uint64_t* in, uint32_t n, uint32_t shift);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// returns the kernels of a given instruction set,
+// falls back to the next lower one if it is not compiled in.
+const kernels_t& get_kernels(isa_type isa);
+
+// best instruction set supported by the host,
+// CASH_SIMD=generic|avx2|avx512 lowers the selection.
+isa_type detect_isa();
+
+// kernels dispatched on the host CPU, selected once
+const kernels_t& kernels();
+
+namespace generic {
+
+uint64_t add(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+
+uint64_t sub(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+
+}
+
+// multi-word addition, returns the carry out.
+// the carry chain is serial, x86 uses add-with-carry instead of vectors.
+uint64_t add(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+
+// multi-word subtraction, returns the borrow out
+uint64_t sub(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n);
+
+}
+}
+}
@@ -7,6 +7,21 @@ namespace internal {
 
 class simulatorimpl;
 
+struct ch_simopts {
+  // number of independent stimulus lanes evaluated per call.
+  // lanes share the compiled design but each has its own state,
+  // they are evaluated one after another, not vectorized.
+  uint32_t num_lanes;
+
+  // number of worker threads evaluating the design (0 = all cores).
+  // compiled simulation spreads the lanes over the threads, so it uses
+  // at most num_lanes threads. the interpreter (ch_flags::disable_jit)
+  // also partitions the logic of each lane across the threads.
+  uint32_t num_threads;
+
+  ch_simopts() : num_lanes(1), num_threads(1) {}
+};
+
 class ch_simulator {
 public:  
   
@@ -19,6 +34,12 @@ public:
     : ch_simulator(std::vector<device_base>{first, (more)...})
   {}
 
+  ch_simulator(const std::vector<device_base>& devices, const ch_simopts& options);
+
+  ch_simulator(const device_base& device, const ch_simopts& options)
+    : ch_simulator(std::vector<device_base>{device}, options)
+  {}
+
   ch_simulator(const ch_simulator& other);
 
   ch_simulator(ch_simulator&& other);
@@ -39,12 +60,80 @@ public:
 
   void eval();
 
+  // save the state of all lanes, including port values
+  void checkpoint(std::ostream& out) const;
+
+  void checkpoint(const std::string& file) const {
+    std::ofstream out(file, std::ios::binary);
+    this->checkpoint(out);
+  }
+
+  // load a state saved by checkpoint() on the same design
+  void restore(std::istream& in);
+
+  void restore(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    this->restore(in);
+  }
+
+  // clone of the simulator and its current state sharing the compiled
+  // design, its ports are only accessible through poke() and peek()
+  ch_simulator fork() const;
+
+  uint32_t num_lanes() const;
+
+  uint32_t num_threads() const;
+
+  // simulations start on the interpreter while the design is compiled,
+  // this blocks until the compiled code has taken over.
+  void wait_jit();
+
+  // number of switches from the interpreter to compiled code
+  uint32_t num_jit_swaps() const;
+
+  template <typename P, typename V>
+  void poke(uint32_t lane, const P& port, const V& value) {
+    static_assert(is_system_io_v<P>, "invalid type");
+    typename P::traits::system_type tmp(value);
+    this->poke_data(lane, system_accessor::data(port), system_accessor::data(tmp));
+  }
+
+  // drive an input port as a clock with the given period and phase in ticks,
+  // step() then only evaluates the design at clock edges
+  template <typename P>
+  void add_clock(const P& port, uint32_t period, uint32_t phase = 0) {
+    static_assert(is_system_io_v<P>, "invalid type");
+    this->add_clock_data(system_accessor::data(port), period, phase);
+  }
+
+  template <typename P>
+  auto peek(uint32_t lane, const P& port) const {
+    static_assert(is_system_io_v<P>, "invalid type");
+    typename P::traits::system_type ret;
+    system_accessor::assign(ret, this->peek_data(lane, system_accessor::data(port)));
+    return ret;
+  }
+
+  auto impl() const {
+    return impl_;
+  }
+
 protected:
 
   ch_simulator(simulatorimpl* impl);
 
+  void poke_data(uint32_t lane, const sdata_type& port, const sdata_type& value);
+
+  const sdata_type& peek_data(uint32_t lane, const sdata_type& port) const;
+
+  void add_clock_data(const sdata_type& port, uint32_t period, uint32_t phase);
+
   simulatorimpl* impl_;
 };
 
+void ch_stats(std::ostream& out, const ch_simulator& simulator);
+
+ch_opt_stats ch_optstats(const ch_simulator& simulator);
+
 }
 }
@@ -5,6 +5,8 @@
 namespace ch {
 namespace internal {
 
+class cwfreaderimpl;
+
 class ch_tracer : public ch_simulator {
 public:
 
@@ -41,6 +43,26 @@ public:
     toVCD(out);
   }
 
+  // compressed binary trace with a time index, see ch_cwfreader
+  void toCWF(std::ofstream& out);
+
+  void toCWF(const std::string& file) {
+    std::ofstream out(file, std::ios::binary);
+    toCWF(out);
+  }
+
+  // write the trace to a file during the simulation instead of keeping it
+  // in memory, at most max_blocks blocks of 100 ticks are held at a time.
+  // must be called before the simulation starts.
+  void streamText(const std::string& file, uint32_t max_blocks = 64);
+
+  void streamVCD(const std::string& file, uint32_t max_blocks = 64);
+
+  void streamCWF(const std::string& file, uint32_t max_blocks = 64);
+
+  // flush the streamed trace and end tracing
+  void closeStream();
+
   void toVerilog(std::ofstream& out,
                  const std::string& moduleFileName,
                  bool passthru = false);
@@ -79,6 +101,38 @@ protected:
   ch_tracer(simulatorimpl* impl);
 };
 
+// reader of traces written by ch_tracer::toCWF() or streamCWF()
+class ch_cwfreader {
+public:
+
+  ch_cwfreader(const std::string& file);
+
+  ~ch_cwfreader();
+
+  ch_cwfreader(const ch_cwfreader& other) = delete;
+
+  ch_cwfreader& operator=(const ch_cwfreader& other) = delete;
+
+  ch_tick num_ticks() const;
+
+  uint32_t num_signals() const;
+
+  const std::string& signal_name(uint32_t signal) const;
+
+  uint32_t signal_width(uint32_t signal) const;
+
+  // index of the signal with the given name, or -1
+  int find_signal(const std::string& name) const;
+
+  // value changes of a signal within [start, end), starting with its value at start.
+  // only the frames overlapping the window are read and decompressed.
+  std::vector<std::pair<ch_tick, sdata_type>> read(uint32_t signal, ch_tick start, ch_tick end) const;
+
+protected:
+
+  cwfreaderimpl* impl_;
+};
+
 }
 }
 
@@ -19,7 +19,7 @@ public:
     return data_width_;
   }
 
-  uint32_t num_items() {
+  uint32_t num_items() const {
     return num_items_;
   }
 
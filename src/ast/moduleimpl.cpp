@@ -6,7 +6,8 @@
 
 using namespace ch::internal;
 
-static uint32_t find_port_index(moduleportimpl* port, const std::vector<lnode>& list) {
+template <typename List>
+static uint32_t find_port_index(moduleportimpl* port, const List& list) {
   // lookup existing binding  
   for (uint32_t index = 0; index < list.size(); ++index) {
     auto impl = reinterpret_cast<moduleportimpl*>(list[index].impl());
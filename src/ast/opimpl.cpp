@@ -38,13 +38,32 @@ void opimpl::init(ch_op op, bool is_signed, lnodeimpl* lhs, lnodeimpl* rhs) {
   if (rhs) {
     this->add_src(rhs);
   }
-  // disable the sign if not applicable
-  if (is_signed
-   && !CH_OP_IS_SIGNED(op)
-   && !this->should_resize_opds()) {
-    is_signed = false;
+  signed_ = is_signed_opd(op, this->size(), is_signed, lhs, rhs);
+}
+
+static bool should_resize(ch_op op, uint32_t size, const lnodeimpl* lhs, const lnodeimpl* rhs) {
+  auto op_resize = CH_OP_RESIZE(op);
+  switch (op_resize) {
+  case op_flags::resize_src:
+    // source operand sizes should match
+    return (lhs->size() != rhs->size());
+  case op_flags::resize_dst:
+    // source operand and destination sizes should match
+    return (lhs->size() < size)
+        || (rhs && rhs->size() < size);
+  default:
+    return false;
   }
-  signed_ = is_signed;
+}
+
+bool opimpl::is_signed_opd(ch_op op,
+                           uint32_t size,
+                           bool is_signed,
+                           const lnodeimpl* lhs,
+                           const lnodeimpl* rhs) {
+  // disable the sign if not applicable
+  return is_signed
+      && (CH_OP_IS_SIGNED(op) || should_resize(op, size, lhs, rhs));
 }
 
 lnodeimpl* opimpl::clone(context* ctx, const clone_map& cloned_nodes) const {
@@ -78,18 +97,10 @@ void opimpl::print(std::ostream& out) const {
 }
 
 bool opimpl::should_resize_opds() const {
-  auto op_resize = CH_OP_RESIZE(op_);
-  switch (op_resize) {
-  case op_flags::resize_src:
-    // source operand sizes should match
-    return (this->src(0).size() != this->src(1).size());
-  case op_flags::resize_dst:
-    // source operand and destination sizes should match
-    return ((this->src(0).size() < this->size())
-        || ((this->num_srcs() > 1) && this->src(1).size() < this->size()));
-  default:
-    return false;
-  }
+  return should_resize(op_,
+                       this->size(),
+                       this->src(0).impl(),
+                       (this->num_srcs() > 1) ? this->src(1).impl() : nullptr);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -102,7 +113,7 @@ lnodeimpl* ch::internal::createOpNode(
     const std::string& name,
     const source_location& sloc) {
   is_signed &= CH_OP_IS_SIGNED(op);
-  return ctx_curr()->create_node<opimpl>(op, size, is_signed, in.impl(), name, sloc);
+  return ctx_curr()->create_op(op, size, is_signed, in.impl(), nullptr, name, sloc);
 }
 
 lnodeimpl* ch::internal::createOpNode(
@@ -113,5 +124,5 @@ lnodeimpl* ch::internal::createOpNode(
     const lnode& rhs,
     const std::string& name,
     const source_location& sloc) {
-  return ctx_curr()->create_node<opimpl>(op, size, is_signed, lhs.impl(), rhs.impl(), name, sloc);
+  return ctx_curr()->create_op(op, size, is_signed, lhs.impl(), rhs.impl(), name, sloc);
 }
\ No newline at end of file
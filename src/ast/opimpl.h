@@ -18,6 +18,13 @@ public:
 
   bool should_resize_opds() const;
 
+  // operand sign of a construction, it is dropped where it does not apply
+  static bool is_signed_opd(ch_op op,
+                            uint32_t size,
+                            bool is_signed,
+                            const lnodeimpl* lhs,
+                            const lnodeimpl* rhs);
+
   lnodeimpl* clone(context* ctx, const clone_map& cloned_nodes) const override;
 
   bool equals(const lnodeimpl& other) const override;
@@ -53,6 +53,18 @@ selectimpl::selectimpl(context* ctx,
   }
 }
 
+selectimpl::selectimpl(context* ctx,
+                       uint32_t size,
+                       lnodeimpl* key,
+                       const std::vector<lnodeimpl*>& srcs,
+                       const std::string& name,
+                       const source_location& sloc)
+  : selectimpl(ctx, size, key, name, sloc) {
+  for (auto src : srcs) {
+    this->add_src(src);
+  }
+}
+
 lnodeimpl* selectimpl::clone(context* ctx, const clone_map& cloned_nodes) const {
   lnodeimpl* key = nullptr;
   if (this->has_key()) {
@@ -95,39 +107,38 @@ void selectimpl::print(std::ostream& out) const {
 lnode select_impl::emit(const lnode& def_value) {
   auto& stmts = stmts_;
   auto key  = key_.empty() ? nullptr : key_.impl();
-  auto sel  = ctx_curr()->create_node<selectimpl>(
-      def_value.size(), key, srcinfo_.name(), srcinfo_.sloc());
+  std::vector<lnodeimpl*> srcs;
   if (key) {
     // insert switch cases in ascending order
     for (auto& stmt : stmts) {
       auto pred = stmt.first.impl();
       assert(type_lit == pred->type()); // the case predicate should be a literal value
       auto& ipred = reinterpret_cast<litimpl*>(pred)->value();
-      uint32_t i = 1;
-      for (; i < sel->num_srcs(); i += 2) {
-        auto& sel_ipred = reinterpret_cast<litimpl*>(sel->src(i).impl())->value();
+      uint32_t i = 0;
+      for (; i < srcs.size(); i += 2) {
+        auto& sel_ipred = reinterpret_cast<litimpl*>(srcs[i])->value();
         CH_CHECK(sel_ipred != ipred, "duplicate switch case");
         if (sel_ipred > ipred) {
-          sel->insert_src(i, stmt.second.impl());
-          sel->insert_src(i, pred);
+          srcs.insert(srcs.begin() + i, {pred, stmt.second.impl()});
           break;
         }
       }
-      if (i == sel->num_srcs()) {
+      if (i == srcs.size()) {
         assert(pred->size() == key->size());
-        assert(stmt.second.size() == sel->size());
-        sel->add_src(pred);
-        sel->add_src(stmt.second.impl());
+        assert(stmt.second.size() == def_value.size());
+        srcs.push_back(pred);
+        srcs.push_back(stmt.second.impl());
       }
     }
   } else {
     for (auto& stmt : stmts) {
       assert(stmt.first.size() == 1);
-      assert(stmt.second.size() == sel->size());
-      sel->add_src(stmt.first.impl());
-      sel->add_src(stmt.second.impl());
+      assert(stmt.second.size() == def_value.size());
+      srcs.push_back(stmt.first.impl());
+      srcs.push_back(stmt.second.impl());
     }
   }
-  sel->add_src(def_value.impl());
-  return sel;
+  srcs.push_back(def_value.impl());
+  return ctx_curr()->create_select(
+      def_value.size(), key, srcs, srcinfo_.name(), srcinfo_.sloc());
 }
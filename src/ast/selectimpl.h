@@ -39,6 +39,13 @@ protected:
              const std::string& name,
              const source_location& sloc);
 
+  selectimpl(context* ctx,
+             uint32_t size,
+             lnodeimpl* key,
+             const std::vector<lnodeimpl*>& srcs,
+             const std::string& name,
+             const source_location& sloc);
+
   bool has_key_;
 
   friend class context;
@@ -11,6 +11,7 @@
 #include "timeimpl.h"
 #include "context.h"
 #include "ordered_set.h"
+#include "nodeset.h"
 #include "interval.h"
 #include "mem.h"
 
@@ -69,28 +70,6 @@ struct cse_key_t {
   };
 };
 
-class node_tracker {
-public:
-  node_tracker(context* ctx) : ctx_(ctx) {
-    size_ = ctx->nodes().size();
-  }
-
-  size_t deleted() {
-    auto cur_size = ctx_->nodes().size();
-    auto count = (cur_size < size_) ? (size_ - cur_size) : 0;
-    size_ = cur_size;
-    return count;
-  }
-
-  size_t current() {
-    return size_;
-  }
-
-private:
-  context* ctx_;
-  size_t size_;
-};
-
 class node_deleter {
 public:
   node_deleter(context* ctx) : ctx_(ctx) {}
@@ -108,49 +87,137 @@ public:
 
 private:
 
-  void delete_node(lnodeimpl* node) {
-    if (deleted_.count(node))
-      return;
-
-    // gather source nodes
+  void delete_node(lnodeimpl* root) {
+    // track pending nodes by id, a node can be queued twice
+    std::vector<std::pair<lnodeimpl*, uint32_t>> pending{{root, root->id()}};
     std::vector<lnodeimpl*> srcs;
-    for (auto& src : node->srcs()) {
-      srcs.emplace_back(src.impl());
-    }
+    while (!pending.empty()) {
+      auto node = pending.back().first;
+      auto id = pending.back().second;
+      pending.pop_back();
+      if (deleted_.contains(id))
+        continue;
 
-    // delete node
-    ctx_->delete_node(node);
-    deleted_.emplace(node);
+      // gather source nodes
+      srcs.clear();
+      for (auto& src : node->srcs()) {
+        srcs.emplace_back(src.impl());
+      }
 
-    // delete unreferenced source nodes
-    for (auto src : srcs) {
-      if (deleted_.count(src)
-       || src->users() != nullptr)
-        continue;
-      this->delete_node(src);
+      // delete node
+      deleted_.insert(id);
+      ctx_->delete_node(node);
+
+      // delete unreferenced source nodes
+      for (auto src : srcs) {
+        if (deleted_.contains(src->id())
+         || src->users() != nullptr)
+          continue;
+        pending.emplace_back(src, src->id());
+      }
     }
   }
 
   std::vector<lnodeimpl*> nodes_;
-  std::unordered_set<lnodeimpl*> deleted_;
+  node_set deleted_;
   context* ctx_;
 };
 
+// depth-first traversal using an explicit stack.
+// enter(node, ret) is called when reaching a node, it returns false to skip
+// its sources, setting 'ret' as the visit result. leave(node, update) is
+// called after visiting the sources, with 'update' set if any source visit
+// returned true, and returns the node's visit result.
+class node_walker {
+public:
+
+  template <typename Enter, typename Leave>
+  bool walk(lnodeimpl* root, const Enter& enter, const Leave& leave) {
+    bool ret = false;
+    if (!enter(root, ret))
+      return ret;
+    stack_.push_back({root, 0, false});
+    for (;;) {
+      auto& frame = stack_.back();
+      auto node = frame.node;
+      if (frame.src < node->num_srcs()) {
+        auto src = node->src(frame.src++).impl();
+        bool src_ret = false;
+        if (enter(src, src_ret)) {
+          stack_.push_back({src, 0, false});
+        } else {
+          frame.update |= src_ret;
+        }
+      } else {
+        ret = leave(node, frame.update);
+        stack_.pop_back();
+        if (stack_.empty())
+          break;
+        stack_.back().update |= ret;
+      }
+    }
+    return ret;
+  }
+
+private:
+
+  struct frame_t {
+    lnodeimpl* node;
+    uint32_t src;
+    bool update;
+  };
+
+  std::vector<frame_t> stack_;
+};
+
 }
 }
 
 compiler::compiler(context* ctx) : ctx_(ctx) {}
 
 void compiler::optimize() {
-  size_t cfo_total(0), dce_total(0), cse_total(0), pip_total(0), pcx_total(0), bro_total(0), rpo_total(0);
+  profile_timer timer(profile_counter::optimize);
 
   CH_DBG(2, "compiling %s (#%d) ...\n", ctx_->name().c_str(), ctx_->id());
 
-  node_tracker tracker(ctx_);
-  auto orig_num_nodes = tracker.current();
+  struct pass_t {
+    const char* name;
+    bool (compiler::*run)();
+    bool idempotent; // reaches its own fixpoint in a single run
+  };
+
+  static const pass_t passes[] = {
+    {"DCE", &compiler::dead_code_elimination, true},
+    {"PIP", &compiler::prune_identity_proxies, true},
+    {"PCX", &compiler::proxies_coalescing, true},
+    {"CFO", &compiler::constant_folding, false},
+    {"CSE", &compiler::subexpressions_elimination, false},
+    {"BRO", &compiler::branch_coalescing, false},
+    {"RPO", &compiler::register_promotion, false},
+    {"BWN", &compiler::narrow_widths, false},
+  };
+  static constexpr uint32_t num_passes = sizeof(passes) / sizeof(pass_t);
+
+  auto& stats = ctx_->opt_stats();
+  auto start = std::chrono::steady_clock::now();
+  auto orig_num_nodes = ctx_->nodes().size();
+
+  auto run_pass = [&](const pass_t& pass)->bool {
+    auto& pass_stats = stats.pass(pass.name);
+    auto num_nodes = ctx_->nodes().size();
+    auto pass_start = std::chrono::steady_clock::now();
+    bool changed = (this->*pass.run)();
+    auto pass_end = std::chrono::steady_clock::now();
+    pass_stats.time += std::chrono::duration<double>(pass_end - pass_start).count();
+    pass_stats.nodes += int64_t(ctx_->nodes().size()) - int64_t(num_nodes);
+    ++pass_stats.runs;
+    if (changed) {
+      ++pass_stats.changes;
+    }
+    return changed;
+  };
 
-  this->dead_code_elimination();
-  dce_total = tracker.deleted();
+  run_pass(passes[0]);
 
   // run optimization passes
   bool changed = true;
@@ -159,21 +226,30 @@ void compiler::optimize() {
     changed = false;
   }
 
-  for (;changed;) {
-    changed = this->prune_identity_proxies();
-    pip_total += tracker.deleted();
-    changed |= this->proxies_coalescing();
-    pcx_total += tracker.deleted();
-    changed |= this->constant_folding();
-    cfo_total += tracker.deleted();
-    changed |= this->subexpressions_elimination();
-    cse_total += tracker.deleted();
-    changed |= this->branch_coalescing();
-    bro_total += tracker.deleted();
-    changed |= this->register_promotion();
-    rpo_total += tracker.deleted();
+  // the graph version is bumped on every change, a pass is skipped if it
+  // already ran on the current version.
+  uint32_t version = 1;
+  std::vector<uint32_t> pass_versions(num_passes, 0);
+  while (changed) {
+    changed = false;
+    ++stats.iterations;
+    for (uint32_t i = 1; i < num_passes; ++i) {
+      if (pass_versions[i] == version)
+        continue;
+      bool pass_changed = run_pass(passes[i]);
+      if (pass_changed) {
+        ++version;
+        changed = true;
+      }
+      pass_versions[i] = (pass_changed && !passes[i].idempotent) ? 0 : version;
+    }
   }
 
+  auto end = std::chrono::steady_clock::now();
+  stats.time += std::chrono::duration<double>(end - start).count();
+  stats.nodes_before += orig_num_nodes;
+  stats.nodes_after += ctx_->nodes().size();
+
 #ifndef NDEBUG
   // dump nodes
   if (platform::self().cflags() & ch_flags::dump_cfg) {
@@ -187,19 +263,14 @@ void compiler::optimize() {
       ctx_->debug_cfg(node, std::cout);
     }
   }
-#else
-  CH_UNUSED(orig_num_nodes, dce_total);
+
+  for (auto& pass_stats : stats.passes) {
+    CH_DBG(2, "*** %s: %u runs, %ld nodes, %f s\n", pass_stats.name.c_str(), pass_stats.runs, (long)pass_stats.nodes, pass_stats.time);
+  }
 #endif
 
-  CH_DBG(2, "*** deleted %lu DCE nodes\n", dce_total);
-  CH_DBG(2, "*** deleted %lu PIP nodes\n", pip_total);
-  CH_DBG(2, "*** deleted %lu PCX nodes\n", pcx_total);
-  CH_DBG(2, "*** deleted %lu CFO nodes\n", cfo_total);
-  CH_DBG(2, "*** deleted %lu CSE nodes\n", cse_total);
-  CH_DBG(2, "*** deleted %lu BRO nodes\n", bro_total);
-  CH_DBG(2, "*** deleted %lu RPO nodes\n", rpo_total);
   CH_DBG(2, "Before optimization: %lu\n", orig_num_nodes);
-  CH_DBG(2, "After optimization: %lu\n", tracker.current());
+  CH_DBG(2, "After optimization: %lu\n", ctx_->nodes().size());
 }
 
 bool compiler::dead_code_elimination() {
@@ -207,7 +278,8 @@ bool compiler::dead_code_elimination() {
 
   bool changed = false;
 
-  ordered_set<lnodeimpl*> live_nodes;
+  node_set live_nodes;
+  std::vector<lnodeimpl*> working_set;
   std::unordered_map<uint32_t, std::unordered_set<proxyimpl*>> proxy_users;
   std::unordered_map<proxyimpl*, std::unordered_map<uint32_t, interval_t>> used_proxy_sources;
   std::unordered_set<proxyimpl*> sparse_proxies;
@@ -313,31 +385,37 @@ bool compiler::dead_code_elimination() {
     return ctx_->create_bypass(node);
   };
 
+  //--
+  auto add_live_node = [&](lnodeimpl* node) {
+    if (live_nodes.insert(node->id())) {
+      working_set.push_back(node);
+    }
+  };
+
   // get permanent live nodes
   for (auto node : ctx_->inputs()) {
-    live_nodes.insert(node);
+    add_live_node(node);
   }
   for (auto node : ctx_->outputs()) {
-    live_nodes.insert(node);
+    add_live_node(node);
   }
   for (auto node : ctx_->taps()) {
-    live_nodes.insert(node);
+    add_live_node(node);
   }
   for (auto node : ctx_->gtaps()) {
     if (node->size() != 0)
       continue;
-    live_nodes.insert(node);
+    add_live_node(node);
   }
   for (auto node : ctx_->ext_nodes()) {
     if (nullptr == node->users())
       continue;
-    live_nodes.insert(node);
+    add_live_node(node);
   }
 
   // build live nodes set
-  std::list<lnodeimpl*> working_set(live_nodes.begin(), live_nodes.end());
-  while (!working_set.empty()) {
-    auto node = working_set.front();
+  for (size_t w = 0; w < working_set.size(); ++w) {
+    auto node = working_set[w];
     auto proxy = dynamic_cast<proxyimpl*>(node);
 
     auto use_info_it = (proxy != nullptr) ? used_proxy_sources.find(proxy) :
@@ -444,19 +522,18 @@ bool compiler::dead_code_elimination() {
       }
 
       // add to live list
-      auto ret = live_nodes.insert(src_impl);
-      if (ret.second || is_new_used_proxy_src) {
+      auto is_new_live_node = live_nodes.insert(src_impl->id());
+      if (is_new_live_node || is_new_used_proxy_src) {
         // we have a new live node, add it to working set
         working_set.push_back(src_impl);
 
-        if (ret.second
+        if (is_new_live_node
          && proxy
          && proxy->has_sparse_range()) {
           sparse_proxies.insert(proxy);
         }
       }
     }
-    working_set.pop_front();
   }
 
   // remove unused proxy sources
@@ -474,7 +551,7 @@ bool compiler::dead_code_elimination() {
   for (auto it = ctx_->nodes().begin(),
            end = ctx_->nodes().end(); it != end;) {
     auto node = *it;
-    if (0 == live_nodes.count(node)) {
+    if (!live_nodes.contains(node->id())) {
       it = ctx_->delete_node(it);
       changed = true;
     } else {
@@ -500,7 +577,8 @@ bool compiler::constant_folding() {
 
   CH_DBG(3, "Begin Compiler::CFO\n");
 
-  std::unordered_set<uint32_t> visited_nodes;
+  node_set visited_nodes;
+  node_walker walker;
   std::vector<lnodeimpl*> deleted_list;
   bool changed = false;
 
@@ -897,15 +975,11 @@ bool compiler::constant_folding() {
     return nullptr;
   };
 
-  std::function<void (lnodeimpl*)> dfs_visit = [&](lnodeimpl* node) {
-    if (visited_nodes.count(node->id()))
-      return;
-    visited_nodes.emplace(node->id());
-
-    for (auto& src : node->srcs()) {
-      dfs_visit(src.impl());
-    }
+  auto enter = [&](lnodeimpl* node, bool&) {
+    return visited_nodes.insert(node->id());
+  };
 
+  auto leave = [&](lnodeimpl* node, bool) {
     bool is_constant_all = true;
     bool is_constant_partial = false;
     for (auto& src : node->srcs()) {
@@ -973,6 +1047,11 @@ bool compiler::constant_folding() {
     default:
       break;
     }
+    return false;
+  };
+
+  auto dfs_visit = [&](lnodeimpl* node) {
+    walker.walk(node, enter, leave);
   };
 
   // visit output nodes
@@ -1010,20 +1089,17 @@ bool compiler::subexpressions_elimination() {
 
   CH_DBG(3, "Begin Compiler::CSE\n");
 
-  std::unordered_set<uint32_t> visited_nodes;
+  node_set visited_nodes;
+  node_walker walker;
   std::unordered_set<cse_key_t, cse_key_t::hash_type> cse_table;
   std::vector<lnodeimpl*> deleted_list;
   bool changed = false;
 
-  std::function<void (lnodeimpl*)> dfs_visit = [&](lnodeimpl* node) {
-    if (visited_nodes.count(node->id()))
-      return;
-    visited_nodes.emplace(node->id());
-
-    for (auto& src : node->srcs()) {
-      dfs_visit(src.impl());
-    }
+  auto enter = [&](lnodeimpl* node, bool&) {
+    return visited_nodes.insert(node->id());
+  };
 
+  auto leave = [&](lnodeimpl* node, bool) {
     switch (node->type()) {
     default:
       break;
@@ -1042,6 +1118,11 @@ bool compiler::subexpressions_elimination() {
       }
     } break;
     }
+    return false;
+  };
+
+  auto dfs_visit = [&](lnodeimpl* node) {
+    walker.walk(node, enter, leave);
   };
 
   // visit output nodes
@@ -1487,6 +1568,435 @@ bool compiler::register_promotion() {
   return changed;
 }
 
+bool compiler::narrow_widths() {
+  if (platform::self().cflags() & ch_flags::disable_bwn)
+    return false;
+
+  CH_DBG(3, "Begin Compiler::BWN\n");
+
+  node_set visited_nodes;
+  node_walker walker;
+  std::vector<lnodeimpl*> order;
+  std::unordered_map<uint32_t, uint32_t> order_index;
+  std::vector<lnodeimpl*> deleted_list;
+  bool changed = false;
+
+  // collect nodes in post-order, sources come before their users
+  // except for back-edges through sequential nodes.
+  auto enter = [&](lnodeimpl* node, bool&) {
+    return visited_nodes.insert(node->id());
+  };
+
+  auto leave = [&](lnodeimpl* node, bool) {
+    order_index[node->id()] = order.size();
+    order.push_back(node);
+    return false;
+  };
+
+  auto dfs_visit = [&](lnodeimpl* node) {
+    walker.walk(node, enter, leave);
+  };
+
+  for (auto node : ctx_->outputs()) {
+    dfs_visit(node);
+  }
+  for (auto node : ctx_->taps()) {
+    dfs_visit(node);
+  }
+  for (auto node : ctx_->gtaps()) {
+    if (node->size() != 0)
+      continue;
+    dfs_visit(node);
+  }
+  for (auto node : ctx_->ext_nodes()) {
+    dfs_visit(node);
+  }
+
+  auto num_nodes = order.size();
+
+  // nodes whose low bits only depend on their operands' low bits,
+  // they can be computed at a smaller width.
+  auto is_narrowable = [](lnodeimpl* node) {
+    switch (node->type()) {
+    case type_proxy:
+    case type_sel:
+      return true;
+    case type_op: {
+      auto alu = reinterpret_cast<opimpl*>(node);
+      switch (alu->op()) {
+      case ch_op::inv:
+      case ch_op::andb:
+      case ch_op::orb:
+      case ch_op::xorb:
+      case ch_op::neg:
+      case ch_op::add:
+      case ch_op::sub:
+      case ch_op::mul:
+        return true;
+      case ch_op::shl:
+        return (alu->src(0).size() == alu->size());
+      default:
+        return false;
+      }
+    }
+    default:
+      return false;
+    }
+  };
+
+  auto is_sel_value = [](selectimpl* sel, uint32_t index) {
+    auto n = sel->num_srcs();
+    if (index + 1 == n)
+      return true; // default value
+    return sel->has_key() ? (index != 0 && 0 == (index & 0x1))
+                          : (1 == (index & 0x1));
+  };
+
+  auto get_shift_amount = [](const lnode& src, uint32_t* out) {
+    auto impl = src.impl();
+    if (type_lit != impl->type())
+      return false;
+    auto& value = reinterpret_cast<litimpl*>(impl)->value();
+    auto msb = value.find_last();
+    if (msb >= 31) {
+      *out = std::numeric_limits<uint32_t>::max();
+    } else {
+      uint32_t amount = 0;
+      for (int i = msb; i >= 0; --i) {
+        amount = (amount << 1) | (value.at(i) ? 1 : 0);
+      }
+      *out = amount;
+    }
+    return true;
+  };
+
+  // forward pass: compute the number of low bits that may be non-zero,
+  // the remaining high bits are known zeros.
+  // sources reached through a back-edge keep their full size.
+  std::vector<uint32_t> active(num_nodes);
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    active[i] = order[i]->size();
+  }
+
+  auto active_of = [&](const lnode& src) {
+    return active[order_index.at(src.id())];
+  };
+
+  // active bits of an operand extended to the operation size
+  auto active_ext = [&](const lnode& src, uint32_t size, bool is_signed) {
+    auto bits = active_of(src);
+    if (is_signed && src.size() < size && bits == src.size())
+      return size;
+    return std::min(bits, size);
+  };
+
+  auto compute_active = [&](lnodeimpl* node)->uint32_t {
+    auto size = node->size();
+    switch (node->type()) {
+    case type_lit:
+      return reinterpret_cast<litimpl*>(node)->value().find_last() + 1;
+    case type_proxy: {
+      uint32_t bits = 0;
+      for (auto& range : reinterpret_cast<proxyimpl*>(node)->ranges()) {
+        auto src_bits = active_of(node->src(range.src_idx));
+        if (src_bits > range.src_offset) {
+          bits = std::max(bits, range.dst_offset + std::min(range.length, src_bits - range.src_offset));
+        }
+      }
+      return bits;
+    }
+    case type_sel: {
+      auto sel = reinterpret_cast<selectimpl*>(node);
+      uint32_t bits = 0;
+      for (uint32_t i = 0, n = sel->num_srcs(); i < n; ++i) {
+        if (is_sel_value(sel, i)) {
+          bits = std::max(bits, active_of(sel->src(i)));
+        }
+      }
+      return std::min(bits, size);
+    }
+    case type_op: {
+      auto alu = reinterpret_cast<opimpl*>(node);
+      bool is_signed = alu->is_signed();
+      switch (alu->op()) {
+      case ch_op::andb:
+        return std::min(active_ext(alu->src(0), size, is_signed),
+                        active_ext(alu->src(1), size, is_signed));
+      case ch_op::orb:
+      case ch_op::xorb:
+        return std::max(active_ext(alu->src(0), size, is_signed),
+                        active_ext(alu->src(1), size, is_signed));
+      case ch_op::add:
+        return std::min(std::max(active_ext(alu->src(0), size, is_signed),
+                                 active_ext(alu->src(1), size, is_signed)) + 1, size);
+      case ch_op::mul:
+        if (!is_signed) {
+          return std::min(active_ext(alu->src(0), size, false)
+                        + active_ext(alu->src(1), size, false), size);
+        }
+        break;
+      case ch_op::shl: {
+        uint32_t amount;
+        if (get_shift_amount(alu->src(1), &amount)) {
+          if (amount >= size)
+            return 0;
+          return std::min(active_ext(alu->src(0), size, false) + amount, size);
+        }
+        break;
+      }
+      case ch_op::shr: {
+        auto bits = active_of(alu->src(0));
+        if (is_signed && bits == alu->src(0).size())
+          break; // sign bit may be set
+        uint32_t amount;
+        if (get_shift_amount(alu->src(1), &amount)) {
+          bits = (bits > amount) ? (bits - amount) : 0;
+        }
+        return std::min(bits, size);
+      }
+      case ch_op::pad:
+        return active_ext(alu->src(0), size, is_signed);
+      default:
+        break;
+      }
+      return size;
+    }
+    default:
+      return size;
+    }
+  };
+
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    active[i] = compute_active(order[i]);
+  }
+
+  // backward pass: compute the number of low bits read by the users,
+  // narrowable nodes only demand the bits they are narrowed to.
+  std::vector<uint32_t> demand(num_nodes, 0);
+  std::vector<uint32_t> num_refs(num_nodes, 0);
+  std::vector<uint32_t> width(num_nodes);
+
+  auto require = [&](const lnode& src, uint32_t bits) {
+    auto j = order_index.at(src.id());
+    demand[j] = std::max(demand[j], std::min(bits, src.size()));
+    ++num_refs[j];
+  };
+
+  for (uint32_t i = num_nodes; i-- > 0;) {
+    auto node = order[i];
+    auto size = node->size();
+
+    // all users should have been visited,
+    // otherwise the unaccounted ones may read any bit.
+    uint32_t num_users = 0;
+    for (auto user = node->users(); user; user = user->next_user()) {
+      ++num_users;
+    }
+    if (num_users != num_refs[i]) {
+      demand[i] = size;
+    }
+
+    uint32_t bits = size;
+    if (is_narrowable(node)) {
+      bits = std::max<uint32_t>(1, std::min(active[i], demand[i]));
+    }
+    width[i] = bits;
+
+    if (!is_narrowable(node)) {
+      for (auto& src : node->srcs()) {
+        require(src, src.size());
+      }
+      continue;
+    }
+
+    switch (node->type()) {
+    case type_proxy: {
+      auto proxy = reinterpret_cast<proxyimpl*>(node);
+      for (auto& src : proxy->srcs()) {
+        require(src, 0);
+      }
+      for (auto& range : proxy->ranges()) {
+        if (range.dst_offset >= bits)
+          continue;
+        auto length = std::min(range.length, bits - range.dst_offset);
+        auto j = order_index.at(proxy->src(range.src_idx).id());
+        demand[j] = std::max(demand[j], range.src_offset + length);
+      }
+      break;
+    }
+    case type_sel: {
+      auto sel = reinterpret_cast<selectimpl*>(node);
+      for (uint32_t k = 0, n = sel->num_srcs(); k < n; ++k) {
+        auto& src = sel->src(k);
+        require(src, is_sel_value(sel, k) ? bits : src.size());
+      }
+      break;
+    }
+    case type_op: {
+      auto alu = reinterpret_cast<opimpl*>(node);
+      require(alu->src(0), bits);
+      if (alu->num_srcs() > 1) {
+        auto& src1 = alu->src(1);
+        require(src1, (ch_op::shl == alu->op()) ? src1.size() : bits);
+      }
+      break;
+    }
+    default:
+      assert(false);
+    }
+  }
+
+  // transform pass: replace narrowed nodes with a zero-extension
+  // of their narrow version.
+  std::unordered_map<uint32_t, lnodeimpl*> narrowed;
+
+  // return the node zero-extended by 'node', if any
+  auto zext_source = [&](lnodeimpl* node)->lnodeimpl* {
+    auto it = narrowed.find(node->id());
+    if (it != narrowed.end())
+      return it->second;
+    if (type_op == node->type()) {
+      auto alu = reinterpret_cast<opimpl*>(node);
+      if (ch_op::pad == alu->op()
+       && !alu->is_signed()) {
+        return alu->src(0).impl();
+      }
+    }
+    return nullptr;
+  };
+
+  // read proxy ranges from the zero-extended node when in range
+  auto range_source = [&](lnodeimpl* src, uint32_t offset, uint32_t length) {
+    auto zsrc = zext_source(src);
+    if (zsrc && offset + length <= zsrc->size())
+      return zsrc;
+    return src;
+  };
+
+  // return the low 'bits' of 'src',
+  // 'ext' allows returning a smaller node that is zero-extended.
+  auto narrow_source = [&](lnodeimpl* src, uint32_t bits, bool ext)->lnodeimpl* {
+    assert(src->size() >= bits);
+    auto zsrc = zext_source(src);
+    if (zsrc) {
+      if (zsrc->size() >= bits)
+        return zsrc->slice(0, bits, src->sloc());
+      if (ext)
+        return zsrc;
+      return ctx_->create_node<opimpl>(ch_op::pad, bits, false, zsrc, src->name(), src->sloc());
+    }
+    if (type_lit == src->type()) {
+      sdata_type tmp(bits);
+      auto src_data = reinterpret_cast<litimpl*>(src)->value().words();
+      bv_copy(tmp.words(), 0, src_data, 0, bits);
+      return ctx_->create_literal(tmp);
+    }
+    return src->slice(0, bits, src->sloc());
+  };
+
+  auto narrow_node = [&](lnodeimpl* node, uint32_t bits)->lnodeimpl* {
+    switch (node->type()) {
+    case type_proxy: {
+      auto proxy = reinterpret_cast<proxyimpl*>(node);
+      auto narrow = ctx_->create_node<proxyimpl>(bits, proxy->name(), proxy->sloc());
+      for (auto& range : proxy->ranges()) {
+        if (range.dst_offset >= bits)
+          continue;
+        auto length = std::min(range.length, bits - range.dst_offset);
+        auto src = proxy->src(range.src_idx).impl();
+        narrow->add_source(range.dst_offset, range_source(src, range.src_offset, length), range.src_offset, length);
+      }
+      return narrow;
+    }
+    case type_sel: {
+      auto sel = reinterpret_cast<selectimpl*>(node);
+      auto key = sel->has_key() ? sel->key().impl() : nullptr;
+      auto narrow = ctx_->create_node<selectimpl>(bits, key, sel->name(), sel->sloc());
+      for (uint32_t i = (key ? 1 : 0), n = sel->num_srcs(); i < n; ++i) {
+        auto src = sel->src(i).impl();
+        narrow->add_src(is_sel_value(sel, i) ? narrow_source(src, bits, false) : src);
+      }
+      return narrow;
+    }
+    case type_op: {
+      auto alu = reinterpret_cast<opimpl*>(node);
+      // unsigned operands smaller than the destination are zero-extended
+      bool ext = (op_flags::resize_dst == CH_OP_RESIZE(alu->op())) && !alu->is_signed();
+      auto src0 = alu->src(0).impl();
+      if (src0->size() >= bits) {
+        src0 = narrow_source(src0, bits, ext);
+      }
+      if (alu->num_srcs() > 1) {
+        auto src1 = alu->src(1).impl();
+        if (ch_op::shl != alu->op()
+         && src1->size() >= bits) {
+          src1 = narrow_source(src1, bits, ext);
+        }
+        return ctx_->create_node<opimpl>(alu->op(), bits, alu->is_signed(), src0, src1, alu->name(), alu->sloc());
+      }
+      return ctx_->create_node<opimpl>(alu->op(), bits, alu->is_signed(), src0, alu->name(), alu->sloc());
+    }
+    default:
+      assert(false);
+      return nullptr;
+    }
+  };
+
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    auto node = order[i];
+    auto size = node->size();
+    auto type = node->type();
+    if (nullptr == node->users()
+     || (type_op != type && type_proxy != type && type_sel != type))
+      continue;
+
+    if (0 == active[i]) {
+      // all bits are known zeros
+      node->replace_uses(ctx_->create_literal(sdata_type(size, 0)));
+      deleted_list.push_back(node);
+      changed = true;
+      continue;
+    }
+
+    if (width[i] == size) {
+      if (type_proxy == type) {
+        // bypass zero-extensions
+        auto proxy = reinterpret_cast<proxyimpl*>(node);
+        bool bypass = false;
+        for (auto& range : proxy->ranges()) {
+          auto src = proxy->src(range.src_idx).impl();
+          bypass |= (range_source(src, range.src_offset, range.length) != src);
+        }
+        if (bypass) {
+          node->replace_uses(narrow_node(node, size));
+          deleted_list.push_back(node);
+          changed = true;
+        }
+      }
+      continue;
+    }
+
+    auto narrow = narrow_node(node, width[i]);
+    auto ext = ctx_->create_node<opimpl>(ch_op::pad, size, false, narrow, node->name(), node->sloc());
+    node->replace_uses(ext);
+    narrowed[ext->id()] = narrow;
+    deleted_list.push_back(node);
+    changed = true;
+  }
+
+  // process deleted nodes
+  node_deleter deleter(ctx_);
+  for (auto node : deleted_list) {
+    if (nullptr == node->users())
+      deleter.add(node);
+  }
+  deleter.apply();
+
+  CH_DBG(3, "End Compiler::BWN\n");
+
+  return changed;
+}
+
 void compiler::create_merged_context(context* ctx, bool verbose_tracing) {
   //--
   std::list<std::string> node_path;
@@ -1725,48 +2235,64 @@ void compiler::create_merged_context(context* ctx, bool verbose_tracing) {
 }
 
 void compiler::build_eval_list(std::vector<lnodeimpl*>& eval_list) {
-  std::unordered_set<uint32_t> visited_nodes;
-  std::unordered_set<uint32_t> cyclic_nodes;
-  std::unordered_set<lnodeimpl*> update_list;
+  node_set visited_nodes;
+  node_set cyclic_nodes;
+  node_set update_nodes;
+  std::vector<lnodeimpl*> update_list;
   std::unordered_set<lnodeimpl*> uninitialized_regs;
+  node_walker walker;
 
   //--
-  std::function<bool (lnodeimpl*, lnodeimpl*, std::unordered_set<uint32_t>&)>
-      print_cycle =[&](lnodeimpl* node, lnodeimpl* target, std::unordered_set<uint32_t>& map)->bool {
-    if (map.count(node->id()))
-      return false;
-    map.insert(node->id());
-    if (node->type() == type_reg) {
-      map.insert(reinterpret_cast<regimpl*>(node)->next().id());
-    }
-    if (node == target)
+  auto print_cycle = [&](lnodeimpl* root, lnodeimpl* target, node_set& visited)->bool {
+    std::vector<std::pair<lnodeimpl*, uint32_t>> path;
+    auto enter = [&](lnodeimpl* node)->bool {
+      if (!visited.insert(node->id()))
+        return false;
+      if (node->type() == type_reg) {
+        visited.insert(reinterpret_cast<regimpl*>(node)->next().id());
+      }
+      path.emplace_back(node, 0);
       return true;
-    for (auto& src : node->srcs()) {
-      auto ret = print_cycle(src.impl(), target, map);
-      if (ret) {
-        std::cout << "  path: " << src.impl()->debug_info() << std::endl;
+    };
+    if (!enter(root))
+      return false;
+    while (!path.empty()) {
+      auto node = path.back().first;
+      if (node == target) {
+        // print the path back to the root
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+          std::cout << "  path: " << it->first->debug_info() << std::endl;
+        }
         return true;
       }
+      auto& src_idx = path.back().second;
+      if (src_idx < node->num_srcs()) {
+        enter(node->src(src_idx++).impl());
+      } else {
+        path.pop_back();
+      }
     }
     return false;
   };
 
   //--
-  std::function<bool (lnodeimpl*)> dfs_visit = [&](lnodeimpl* node)->bool {
-    if (visited_nodes.count(node->id())) {
+  auto enter = [&](lnodeimpl* node, bool& ret)->bool {
+    if (visited_nodes.contains(node->id())) {
       // if a node depends on an update node, it also needs to be updated.
-      return (update_list.count(node) != 0);
+      ret = update_nodes.contains(node->id());
+      return false;
     }
 
     // check for cycles
-    if (cyclic_nodes.count(node->id())) {
+    if (cyclic_nodes.contains(node->id())) {
       // handling register cycles
       if (is_snode_type(node->type())) {
         // Detect uninitialized registers
         if (type_reg == node->type()
          && !reinterpret_cast<regimpl*>(node)->has_init_data())
           uninitialized_regs.insert(node);
-        return true;
+        ret = true;
+        return false;
       }
       if (platform::self().cflags() & ch_flags::dump_cfg) {
         for (auto _node : eval_list) {
@@ -1777,27 +2303,24 @@ void compiler::build_eval_list(std::vector<lnodeimpl*>& eval_list) {
       }
       std::cout << "found a cycle on variable " << node->debug_info() << std::endl;
       {
-        std::unordered_set<uint32_t> visited;
+        node_set visited;
         for (auto& src : node->srcs()) {
-          auto ret = print_cycle(src.impl(), node, visited);
-          if (ret) {
-            std::cout << "  path: " << src.impl()->debug_info() << std::endl;
+          if (print_cycle(src.impl(), node, visited))
             break;
-          }
         }
       }
       throw std::domain_error(sstreamf() << "found a cycle on variable " << node->debug_info());
     }
     cyclic_nodes.insert(node->id());
+    return true;
+  };
 
-    // visit source nodes
-    bool update = false;
-    for (auto& src : node->srcs()) {
-      update |= dfs_visit(src.impl());
-    }
+  auto leave = [&](lnodeimpl* node, bool update)->bool {
     if (update) {
       // a cycle exists in dependent path, this node should be updated
-      update_list.insert(node);
+      if (update_nodes.insert(node->id())) {
+        update_list.push_back(node);
+      }
     }
 
     eval_list.push_back(node);
@@ -1806,6 +2329,10 @@ void compiler::build_eval_list(std::vector<lnodeimpl*>& eval_list) {
     return update;
   };
 
+  auto dfs_visit = [&](lnodeimpl* node) {
+    walker.walk(node, enter, leave);
+  };
+
   CH_DBG(2, "build evaluation list for %s (#%d) ...\n", ctx_->name().c_str(), ctx_->id());
 
   assert(0 == ctx_->modules().size());
@@ -1835,8 +2362,9 @@ void compiler::build_eval_list(std::vector<lnodeimpl*>& eval_list) {
 
   {
     // make a copy of the update list and empty it
-    std::unordered_set<lnodeimpl*> update_list2;
+    std::vector<lnodeimpl*> update_list2;
     std::swap(update_list2, update_list);
+    update_nodes.clear();
 
     // disable cycle detection for sequential nodes
     for (auto node : ctx_->snodes()) {
@@ -1896,29 +2424,38 @@ void compiler::build_eval_list(std::vector<lnodeimpl*>& eval_list) {
 }
 
 bool compiler::build_bypass_list(std::unordered_set<uint32_t>& out, context* ctx, uint32_t cd_id) {
-  std::unordered_set<uint32_t> visited_nodes;
+  node_set visited_nodes;
+  node_walker walker;
   bool has_data_nodes = false;
 
-  std::function<bool (lnodeimpl*)> dfs_visit = [&](lnodeimpl* node)->bool {
-    if (visited_nodes.count(node->id())) {
-      return (out.count(node->id()) != 0);
+  auto enter = [&](lnodeimpl* node, bool& ret)->bool {
+    if (!visited_nodes.insert(node->id())) {
+      ret = (out.count(node->id()) != 0);
+      return false;
     }
-    visited_nodes.emplace(node->id());
 
-    auto type = node->type();
-    bool changed = false;
-
-    if (is_snode_type(type)) {
-      if (cd_id == get_snode_cd(node)->id())
+    if (is_snode_type(node->type())) {
+      if (cd_id == get_snode_cd(node)->id()) {
+        ret = false;
         return false;
+      }
       // update changeset here in case there is a cycle with the source nodes
       out.emplace(node->id());
+    }
+    return true;
+  };
+
+  auto leave = [&](lnodeimpl* node, bool update)->bool {
+    auto type = node->type();
+    bool changed = update;
+
+    if (is_snode_type(type)) {
       changed = true;
     } else
     if (type_output == type
      || type_tap == type) {
-      // mark constant outputs as changed      
-      changed = (type_lit == node->src(0).impl()->type());
+      // mark constant outputs as changed
+      changed |= (type_lit == node->src(0).impl()->type());
     }
 
     switch (type) {
@@ -1927,12 +2464,8 @@ bool compiler::build_bypass_list(std::unordered_set<uint32_t>& out, context* ctx
     case type_time:
     case type_print:
       changed = true;
-      [[fallthrough]];
+      break;
     default:
-      // visit source nodes
-      for (auto& src : node->srcs()) {
-        changed |= dfs_visit(src.impl());
-      }
       break;
     }
 
@@ -1955,6 +2488,10 @@ bool compiler::build_bypass_list(std::unordered_set<uint32_t>& out, context* ctx
     return changed;
   };
 
+  auto dfs_visit = [&](lnodeimpl* node) {
+    walker.walk(node, enter, leave);
+  };
+
   // visit output nodes`
   for (auto node : ctx->outputs()) {
     dfs_visit(node);
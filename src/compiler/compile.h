@@ -36,6 +36,8 @@ protected:
 
   bool register_promotion();
 
+  bool narrow_widths();
+
   context* ctx_;
 };
 
@@ -4,7 +4,13 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
-#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Verifier.h>
@@ -17,9 +23,21 @@
 
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Config/llvm-config.h>
 
 #pragma GCC diagnostic pop
 
+#include <utime.h>
+#include <mutex>
+#include <unordered_set>
+#include <thread>
+
 #define	JIT_TYPE_BOOL   6
 extern const jit_type_t jit_type_bool;
 
@@ -69,6 +87,12 @@ public:
         return jit_type_int32;
       case 64:
         return jit_type_int64;
+      case 128:
+        return jit_type_int128;
+      case 192:
+        return jit_type_int192;
+      case 256:
+        return jit_type_int256;
       default:
         assert(false);
         return nullptr;
@@ -92,6 +116,9 @@ _jit_type jit_type_int16_def;
 _jit_type jit_type_int32_def;
 _jit_type jit_type_int64_def;
 _jit_type jit_type_ptr_def;
+_jit_type jit_type_int128_def;
+_jit_type jit_type_int192_def;
+_jit_type jit_type_int256_def;
 
 const jit_type_t jit_type_void  = &jit_type_void_def;
 const jit_type_t jit_type_bool  = &jit_type_bool_def;
@@ -100,6 +127,9 @@ const jit_type_t jit_type_int16 = &jit_type_int16_def;
 const jit_type_t jit_type_int32 = &jit_type_int32_def;
 const jit_type_t jit_type_int64 = &jit_type_int64_def;
 const jit_type_t jit_type_ptr   = &jit_type_ptr_def;
+const jit_type_t jit_type_int128 = &jit_type_int128_def;
+const jit_type_t jit_type_int192 = &jit_type_int192_def;
+const jit_type_t jit_type_int256 = &jit_type_int256_def;
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -197,62 +227,226 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+class _jit_cache {
+public:
+
+  _jit_cache(const std::string& dir, uint64_t max_size, const std::string& tag)
+    : dir_(dir)
+    , max_size_(max_size)
+    , tag_(tag)
+  {}
+
+  std::string key(const llvm::Module& module, llvm::TargetMachine* target) const {
+    // the key covers the module code, the client tag and the target
+    std::string ir;
+    {
+      llvm::raw_string_ostream os(ir);
+      module.print(os, nullptr);
+    }
+    llvm::MD5 md5;
+    md5.update(ir);
+    md5.update(tag_);
+    md5.update(target->getTargetTriple().str());
+    md5.update(target->getTargetCPU());
+    md5.update(target->getTargetFeatureString());
+    md5.update(LLVM_VERSION_STRING);
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    llvm::SmallString<32> digest;
+    llvm::MD5::stringifyResult(result, digest);
+    return "llvmcache-" + digest.str().str();
+  }
+
+  static bool is_key(const std::string& name) {
+    return (0 == name.compare(0, 10, "llvmcache-"));
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> load(const std::string& key) {
+    std::unique_ptr<llvm::MemoryBuffer> object;
+    auto path = this->path(key);
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (buffer) {
+      object = std::move(*buffer);
+      // refresh the access time for LRU pruning
+      utime(path.c_str(), nullptr);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    this->update_stats(key, (object != nullptr));
+    return object;
+  }
+
+  void store(const std::string& key, const llvm::MemoryBuffer& object) {
+    // write a temporary file first so that concurrent readers never see partial objects
+    int fd;
+    llvm::SmallString<128> tmp_path;
+    if (llvm::sys::fs::createUniqueFile(dir_ + "/llvmcache-%%%%%%.tmp", fd, tmp_path))
+      return;
+    {
+      llvm::raw_fd_ostream os(fd, true);
+      os << object.getBuffer();
+    }
+    if (llvm::sys::fs::rename(tmp_path, this->path(key))) {
+      llvm::sys::fs::remove(tmp_path);
+      return;
+    }
+    // enforce the size limit
+    std::lock_guard<std::mutex> lock(mutex_);
+    llvm::CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizeBytes = max_size_;
+    llvm::pruneCache(dir_, policy);
+  }
+
+private:
+
+  std::string path(const std::string& key) const {
+    return dir_ + "/" + key + ".o";
+  }
+
+  void update_stats(const std::string& key, bool hit) {
+    uint32_t hits = 0, misses = 0;
+    auto stats_path = dir_ + "/stats";
+    {
+      std::string label;
+      std::ifstream in(stats_path);
+      in >> label >> hits >> label >> misses;
+    }
+    if (hit) {
+      ++hits;
+    } else {
+      ++misses;
+    }
+    {
+      std::ofstream out(stats_path);
+      out << "hits: " << hits << std::endl;
+      out << "misses: " << misses << std::endl;
+    }
+    CH_DBG(1, "llvmjit: object cache %s '%s' (hits=%u, misses=%u)\n",
+           (hit ? "hit" : "miss"), key.c_str(), hits, misses);
+    CH_UNUSED(key);
+  }
+
+  std::string dir_;
+  uint64_t max_size_;
+  std::string tag_;
+  std::mutex mutex_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 class _jit_context {
 public:
 
-  _jit_context() : builder_(context_) {
-    jit_type_void_def.init(JIT_TYPE_VOID, llvm::Type::getVoidTy(context_));
-    jit_type_bool_def.init(JIT_TYPE_BOOL, llvm::Type::getInt1Ty(context_));
-    jit_type_int8_def.init(JIT_TYPE_INT8, llvm::Type::getInt8Ty(context_));
-    jit_type_int16_def.init(JIT_TYPE_INT16, llvm::Type::getInt16Ty(context_));
-    jit_type_int32_def.init(JIT_TYPE_INT32, llvm::Type::getInt32Ty(context_));
-    jit_type_int64_def.init(JIT_TYPE_INT64, llvm::Type::getInt64Ty(context_));
-    jit_type_ptr_def.init(JIT_TYPE_PTR, llvm::Type::getInt8PtrTy(context_));
+  _jit_context()
+    : tsctx_(std::make_unique<llvm::LLVMContext>())
+    , builder_(*tsctx_.getContext())
+    , module_(nullptr)
+    , num_threads_(0) {
+    auto& context = *tsctx_.getContext();
+    jit_type_void_def.init(JIT_TYPE_VOID, llvm::Type::getVoidTy(context));
+    jit_type_bool_def.init(JIT_TYPE_BOOL, llvm::Type::getInt1Ty(context));
+    jit_type_int8_def.init(JIT_TYPE_INT8, llvm::Type::getInt8Ty(context));
+    jit_type_int16_def.init(JIT_TYPE_INT16, llvm::Type::getInt16Ty(context));
+    jit_type_int32_def.init(JIT_TYPE_INT32, llvm::Type::getInt32Ty(context));
+    jit_type_int64_def.init(JIT_TYPE_INT64, llvm::Type::getInt64Ty(context));
+    jit_type_ptr_def.init(JIT_TYPE_PTR, llvm::Type::getInt8PtrTy(context));
+    jit_type_int128_def.init(JIT_TYPE_INT128, llvm::Type::getIntNTy(context, 128));
+    jit_type_int192_def.init(JIT_TYPE_INT192, llvm::Type::getIntNTy(context, 192));
+    jit_type_int256_def.init(JIT_TYPE_INT256, llvm::Type::getIntNTy(context, 256));
   }
 
   ~_jit_context() {}
 
   bool init() {
-    auto module = std::make_unique<llvm::Module>("llvmjit", context_);    
-    module_ = module.get();
+    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+      std::cerr << "Error: failed to detect host target; " << llvm::toString(jtmb.takeError()) << std::endl;
+      return false;
+    }
+    jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+
+    auto target = jtmb->createTargetMachine();
+    if (!target) {
+      std::cerr << "Error: failed to create target machine; " << llvm::toString(target.takeError()) << std::endl;
+      return false;
+    }
+    target_ = std::move(*target);
+    jtmb_ = std::make_unique<llvm::orc::JITTargetMachineBuilder>(std::move(*jtmb));
+    return true;
+  }
 
-    std::string error;
-    engine_ = llvm::EngineBuilder(std::move(module))
-                .setErrorStr(&error)
-                .setOptLevel(llvm::CodeGenOpt::Aggressive)
-                .setEngineKind(llvm::EngineKind::JIT)
-                .create();
-    if (!engine_) {
-      std::cerr << "Error: failed to create llvm::EngineBuilder; " << error << std::endl;
+  // the JIT is created on first use so that the thread count can be set
+  bool create_jit() {
+    // modules are optimized and compiled on the JIT's thread pool
+    auto num_threads = num_threads_ ? num_threads_ : std::thread::hardware_concurrency();
+    llvm::orc::LLJITBuilder builder;
+    builder.setJITTargetMachineBuilder(*jtmb_);
+    builder.setNumCompileThreads(std::max(1u, num_threads));
+  #if LLVM_VERSION_MAJOR < 11
+    builder.setCompileFunctionCreator([this](llvm::orc::JITTargetMachineBuilder jtmb)
+        -> llvm::Expected<llvm::orc::IRCompileLayer::CompileFunction> {
+      return [this, jtmb](llvm::Module& module) mutable {
+        return this->compile_module(jtmb, module);
+      };
+    });
+  #else
+    builder.setCompileFunctionCreator([this](llvm::orc::JITTargetMachineBuilder jtmb)
+        -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+      return std::make_unique<_jit_compiler>(this, std::move(jtmb));
+    });
+  #endif
+    auto jit = builder.create();
+    if (!jit) {
+      std::cerr << "Error: failed to create llvm::orc::LLJIT; " << llvm::toString(jit.takeError()) << std::endl;
       return false;
     }
+    jit_ = std::move(*jit);
+
+    // resolve external symbols from the host process
+    auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      jit_->getDataLayout().getGlobalPrefix());
+    if (!generator) {
+      std::cerr << "Error: failed to create symbol generator; " << llvm::toString(generator.takeError()) << std::endl;
+      return false;
+    }
+  #if LLVM_VERSION_MAJOR < 10
+    jit_->getMainJITDylib().setGenerator(std::move(*generator));
+  #else
+    jit_->getMainJITDylib().addGenerator(std::move(*generator));
+  #endif
 
-    module_->setDataLayout(engine_->getDataLayout());
-    target_ = engine_->getTargetMachine();
-    
     return true;
   }
 
   auto impl() {
-    return &context_;
+    return tsctx_.getContext();
   }
 
   auto target() const {
-    return target_;
+    return target_.get();
   }
 
-  auto module() const {
-    return module_;
-  }
-
-  auto engine() const {
-    return engine_;
+  auto& modules() const {
+    return modules_;
   }
 
   auto builder() {
     return &builder_;
   }
 
+  void set_threads(uint32_t num_threads) {
+    num_threads_ = num_threads;
+  }
+
+  void set_cache(const std::string& dir, uint64_t max_size, const std::string& tag) {
+    if (llvm::sys::fs::create_directories(dir)) {
+      std::cerr << "Error: failed to create cache directory " << dir << std::endl;
+      return;
+    }
+    cache_ = std::make_unique<_jit_cache>(dir, max_size, tag);
+  }
+
   int compile(llvm::Function* func) {
     {
       static llvm::raw_os_ostream os(std::cerr);
@@ -261,48 +455,235 @@ public:
         return 0;
       }
     }
-    {
-      llvm::legacy::FunctionPassManager fpm(module_);
-
-      fpm.add(llvm::createAggressiveDCEPass());
-      fpm.add(llvm::createPromoteMemoryToRegisterPass());
-      fpm.add(llvm::createConstantPropagationPass());
-
-      fpm.add(llvm::createInstructionCombiningPass());
-      fpm.add(llvm::createReassociatePass());
-      fpm.add(llvm::createNewGVNPass());
-      fpm.add(llvm::createCFGSimplificationPass());
-
-      fpm.add(llvm::createLoopSimplifyCFGPass());
-      fpm.add(llvm::createSROAPass());
-      fpm.add(llvm::createFlattenCFGPass());
-
-      fpm.add(llvm::createIndVarSimplifyPass());
-      fpm.add(llvm::createLICMPass());
-      fpm.add(llvm::createLowerSwitchPass());
-
-      fpm.doInitialization();
-      fpm.run(*func);
+    if (cache_) {
+      // cached objects replace the module when the code is finalized
+      auto& module = this->find_module(func->getParent());
+      auto key = cache_->key(*module.impl, target_.get());
+      module.object = cache_->load(key);
+      module.impl->setModuleIdentifier(key);
     }
     return 1;
   }
 
   void* closure(const std::string& name) {
-    return (void*)engine_->getFunctionAddress(name);
+    void* address = nullptr;
+    this->closures(&name, 1, &address);
+    return address;
+  }
+
+  // resolving all symbols in a single lookup lets the session materialize
+  // their modules concurrently on the compile threads.
+  bool closures(const std::string* names, uint32_t count, void** addresses) {
+    if (!this->finalize())
+      return false;
+    auto& es = jit_->getExecutionSession();
+  #if LLVM_VERSION_MAJOR < 11
+    for (uint32_t i = 0; i < count; ++i) {
+      auto symbol = jit_->lookup(names[i]);
+      if (!symbol) {
+        std::cerr << "Error: failed to resolve symbol " << names[i] << "; " << llvm::toString(symbol.takeError()) << std::endl;
+        return false;
+      }
+      addresses[i] = (void*)symbol->getAddress();
+    }
+    CH_UNUSED(es);
+  #else
+    llvm::orc::SymbolLookupSet lookup_set;
+    std::vector<llvm::orc::SymbolStringPtr> symbols(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      symbols[i] = jit_->mangleAndIntern(names[i]);
+      lookup_set.add(symbols[i]);
+    }
+    auto result = es.lookup(llvm::orc::makeJITDylibSearchOrder(&jit_->getMainJITDylib()),
+                            std::move(lookup_set));
+    if (!result) {
+      std::cerr << "Error: failed to resolve symbols; " << llvm::toString(result.takeError()) << std::endl;
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      addresses[i] = (void*)(*result)[symbols[i]].getAddress();
+    }
+  #endif
+    return true;
+  }
+
+  std::string function_name() const {
+    // the first function keeps the entry point name
+    if (functions_.empty())
+      return "eval";
+    return "eval" + std::to_string(functions_.size());
   }
 
   _jit_function* create_function(jit_type_t signature,
                                  const char* name,
                                  void* address = nullptr);
 
+  static void optimize(llvm::Module& module) {
+    llvm::legacy::FunctionPassManager fpm(&module);
+
+    fpm.add(llvm::createAggressiveDCEPass());
+    fpm.add(llvm::createPromoteMemoryToRegisterPass());
+    fpm.add(llvm::createConstantPropagationPass());
+
+    fpm.add(llvm::createInstructionCombiningPass());
+    fpm.add(llvm::createReassociatePass());
+    fpm.add(llvm::createNewGVNPass());
+    fpm.add(llvm::createCFGSimplificationPass());
+
+    fpm.add(llvm::createLoopSimplifyCFGPass());
+    fpm.add(llvm::createSROAPass());
+    fpm.add(llvm::createFlattenCFGPass());
+
+    fpm.add(llvm::createIndVarSimplifyPass());
+    fpm.add(llvm::createLICMPass());
+    fpm.add(llvm::createLowerSwitchPass());
+
+    fpm.doInitialization();
+    for (auto& func : module) {
+      if (!func.isDeclaration()) {
+        fpm.run(func);
+      }
+    }
+    fpm.doFinalization();
+  }
+
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+  compile_module(llvm::orc::JITTargetMachineBuilder& jtmb, llvm::Module& module) {
+    // runs on the compile threads, each module owns its LLVM context
+    auto target = jtmb.createTargetMachine();
+    if (!target)
+      return target.takeError();
+
+    _jit_context::optimize(module);
+
+    llvm::SmallVector<char, 0> buffer;
+    {
+      llvm::raw_svector_ostream os(buffer);
+      llvm::legacy::PassManager pm;
+      llvm::MCContext* mc;
+      if ((*target)->addPassesToEmitMC(pm, mc, os)) {
+        return llvm::make_error<llvm::StringError>("target does not support code emission",
+                                                   llvm::inconvertibleErrorCode());
+      }
+      pm.run(module);
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> object(new llvm::SmallVectorMemoryBuffer(std::move(buffer)));
+    if (cache_ && _jit_cache::is_key(module.getModuleIdentifier())) {
+      cache_->store(module.getModuleIdentifier(), *object);
+    }
+    return llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>(std::move(object));
+  }
+
 private:
 
-  llvm::LLVMContext context_;
+  struct module_t {
+    std::unique_ptr<llvm::Module> impl;
+    std::unique_ptr<llvm::MemoryBuffer> object;
+  };
+
+#if LLVM_VERSION_MAJOR >= 11
+  class _jit_compiler : public llvm::orc::IRCompileLayer::IRCompiler {
+  public:
+    _jit_compiler(_jit_context* ctx, llvm::orc::JITTargetMachineBuilder jtmb)
+      : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(jtmb.getOptions()))
+      , ctx_(ctx)
+      , jtmb_(std::move(jtmb))
+    {}
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module) override {
+      return ctx_->compile_module(jtmb_, module);
+    }
+
+  private:
+    _jit_context* ctx_;
+    llvm::orc::JITTargetMachineBuilder jtmb_;
+  };
+#endif
+
+  module_t& find_module(llvm::Module* module) {
+    for (auto& m : modules_) {
+      if (m.impl.get() == module)
+        return m;
+    }
+    assert(false);
+    return modules_.back();
+  }
+
+  bool finalize() {
+    if (!jit_ && !this->create_jit())
+      return false;
+    auto& jd = jit_->getMainJITDylib();
+
+    // bind native functions
+    if (!symbols_.empty()) {
+      llvm::orc::MangleAndInterner mangle(jit_->getExecutionSession(), jit_->getDataLayout());
+      llvm::orc::SymbolMap symbols;
+      for (auto& symbol : symbols_) {
+        if (!bound_.insert(symbol.first).second)
+          continue;
+        symbols[mangle(symbol.first)] = llvm::JITEvaluatedSymbol(
+          llvm::pointerToJITTargetAddress(symbol.second), llvm::JITSymbolFlags::Exported);
+      }
+      symbols_.clear();
+      if (!symbols.empty()) {
+        if (auto err = jd.define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+          std::cerr << "Error: failed to define native symbols; " << llvm::toString(std::move(err)) << std::endl;
+          return false;
+        }
+      }
+    }
+
+    // modules sharing a context are compiled serially,
+    // so give each module its own context when there are many.
+    bool split = (modules_.size() > 1);
+
+    for (auto& module : modules_) {
+      llvm::Error err = llvm::Error::success();
+      if (module.object) {
+        err = jit_->addObjectFile(std::move(module.object));
+      } else if (split) {
+        llvm::SmallVector<char, 0> buffer;
+        {
+          llvm::raw_svector_ostream os(buffer);
+          llvm::WriteBitcodeToFile(*module.impl, os);
+        }
+        auto context = std::make_unique<llvm::LLVMContext>();
+        auto clone = llvm::parseBitcodeFile(
+          llvm::MemoryBufferRef(llvm::StringRef(buffer.data(), buffer.size()),
+                                module.impl->getModuleIdentifier()), *context);
+        if (!clone) {
+          err = clone.takeError();
+        } else {
+          err = jit_->addIRModule(llvm::orc::ThreadSafeModule(std::move(*clone), std::move(context)));
+        }
+      } else {
+        err = jit_->addIRModule(llvm::orc::ThreadSafeModule(std::move(module.impl), tsctx_));
+      }
+      if (err) {
+        std::cerr << "Error: failed to add module; " << llvm::toString(std::move(err)) << std::endl;
+        return false;
+      }
+    }
+    modules_.clear();
+    module_ = nullptr;
+
+    return true;
+  }
+
+  llvm::orc::ThreadSafeContext tsctx_;
   llvm::IRBuilder<> builder_;
+  std::unique_ptr<llvm::TargetMachine> target_;
+  std::unique_ptr<llvm::orc::JITTargetMachineBuilder> jtmb_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+  std::unique_ptr<_jit_cache> cache_;
+  std::vector<module_t> modules_;
   llvm::Module* module_;
-  llvm::ExecutionEngine* engine_;
-  llvm::TargetMachine* target_;
+  std::unordered_map<std::string, void*> symbols_;
+  std::unordered_set<std::string> bound_;
+  std::unordered_map<std::string, std::unique_ptr<_jit_function>> natives_;
   std::unordered_map<std::string, std::unique_ptr<_jit_function>> functions_;
+  uint32_t num_threads_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -312,6 +693,7 @@ public:
   _jit_function(_jit_context* ctx, llvm::Function* impl, void* address)
     : ctx_(ctx)
     , impl_(impl)
+    , name_(impl->getName().str())
     , args_(impl->arg_size())
     , cur_label_(jit_label_undefined) {
     int i = 0;
@@ -320,9 +702,7 @@ public:
       args_[i] = std::make_unique<_jit_value>(&arg, type);
       ++i;
     }
-    if (address) {
-      ctx->engine()->addGlobalMapping(impl, address);
-    } else {
+    if (!address) {
       auto bb = this->create_block(&cur_label_);
       ctx->builder()->SetInsertPoint(bb);
     }
@@ -336,6 +716,10 @@ public:
     return impl_;
   }
 
+  auto& name() const {
+    return name_;
+  }
+
   auto arg(unsigned int index) const {
     return args_[index].get();
   }
@@ -438,6 +822,7 @@ public:
 private:
   _jit_context* ctx_;
   llvm::Function* impl_;
+  std::string name_;
   std::vector<std::unique_ptr<_jit_value>> args_;
   std::vector<std::unique_ptr<_jit_value>> variables_;
   std::unordered_map<jit_label_t, llvm::BasicBlock*> basicblocks_;
@@ -449,9 +834,23 @@ private:
 _jit_function* _jit_context::create_function(jit_type_t signature,
                                              const char* name,
                                              void* address) {
-  auto it = functions_.find(name);
-  if (it != functions_.end())
-    return it->second.get();
+  if (address) {
+    // native functions are declared once per module
+    auto it = natives_.find(name);
+    if (it != natives_.end())
+      return it->second.get();
+  } else {
+    auto it = functions_.find(name);
+    if (it != functions_.end())
+      return it->second.get();
+    // each function is compiled in its own module
+    auto module = std::make_unique<llvm::Module>("llvmjit", *tsctx_.getContext());
+    module->setDataLayout(target_->createDataLayout());
+    module->setTargetTriple(target_->getTargetTriple().str());
+    module_ = module.get();
+    modules_.push_back({std::move(module), nullptr});
+    natives_.clear();
+  }
   auto j_sig = reinterpret_cast<_jit_signature*>(signature);
   std::vector<llvm::Type*> args(j_sig->arg_types().size());
   for (unsigned i = 0; i < j_sig->arg_types().size(); ++i) {
@@ -463,7 +862,12 @@ _jit_function* _jit_context::create_function(jit_type_t signature,
                                      name,
                                      module_);
   auto jfunc = new _jit_function(this, func, address);
-  functions_.emplace(name, jfunc);
+  if (address) {
+    symbols_[name] = address;
+    natives_.emplace(name, jfunc);
+  } else {
+    functions_.emplace(name, jfunc);
+  }
   return jfunc;
 }
 
@@ -504,10 +908,22 @@ void jit_context_build_end(jit_context_t context) {
   CH_UNUSED(context);
 }
 
+void jit_context_set_cache(jit_context_t context,
+                           const char* dir,
+                           jit_nuint max_size,
+                           const char* tag) {
+  context->set_cache(dir, max_size, tag);
+}
+
+void jit_context_set_threads(jit_context_t context, unsigned int num_threads) {
+  context->set_threads(num_threads);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 jit_function_t jit_function_create(jit_context_t context, jit_type_t signature) {
-  return context->create_function(signature, "eval");
+  auto name = context->function_name();
+  return context->create_function(signature, name.c_str());
 }
 
 int jit_function_compile(jit_function_t func) {
@@ -517,7 +933,19 @@ int jit_function_compile(jit_function_t func) {
 
 void *jit_function_to_closure(jit_function_t func) {
   auto ctx = func->ctx();
-  return ctx->closure("eval");
+  return ctx->closure(func->name());
+}
+
+int jit_functions_to_closures(jit_function_t* funcs, unsigned int num_funcs, void** closures) {
+  if (0 == num_funcs)
+    return 1;
+  auto ctx = funcs[0]->ctx();
+  std::vector<std::string> names(num_funcs);
+  for (unsigned int i = 0; i < num_funcs; ++i) {
+    assert(funcs[i]->ctx() == ctx);
+    names[i] = funcs[i]->name();
+  }
+  return ctx->closures(names.data(), num_funcs, closures);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -558,6 +986,12 @@ jit_nuint jit_type_get_size(jit_type_t type) {
     return 8;
   case JIT_TYPE_PTR:
     return 8;
+  case JIT_TYPE_INT128:
+    return 16;
+  case JIT_TYPE_INT192:
+    return 24;
+  case JIT_TYPE_INT256:
+    return 32;
   default:
     assert(false);
   }
@@ -596,6 +1030,10 @@ jit_value_t jit_value_create_int_constant(jit_function_t func,
     return func->create_value(builder->getInt64(const_value));
   case JIT_TYPE_PTR:
     return func->create_value(builder->getInt64(const_value));
+  case JIT_TYPE_INT128:
+  case JIT_TYPE_INT192:
+  case JIT_TYPE_INT256:
+    return func->create_value(llvm::ConstantInt::get(type->impl(), const_value));
   default:
     assert(false);
   }
@@ -999,6 +1437,10 @@ jit_value_t jit_insn_load_relative(jit_function_t func,
     auto idx = builder->getInt32(offset);
     addr = builder->CreateInBoundsGEP(jit_type_int8->impl(), addr, idx);
   }
+  auto ptype = type->impl()->getPointerTo();
+  if (ptype != addr->getType()) {
+    addr = builder->CreatePointerCast(addr, ptype);
+  }
   auto value = builder->CreateLoad(type->impl(), addr);
   return func->create_value(value);
 }
@@ -1330,7 +1772,7 @@ int jit_dump_ast(FILE *stream, jit_function_t func, const char *name) {
   std::stringstream ss;
   {
     llvm::raw_os_ostream os(ss);
-    auto module = func->ctx()->module();
+    auto module = func->impl()->getParent();
     module->print(os, nullptr);
   }
   fprintf(stream, "%s", ss.str().c_str());
@@ -1341,9 +1783,10 @@ int jit_dump_asm(FILE *stream, jit_function_t func, const char *name) {
   CH_UNUSED(name);
   llvm::SmallVector<char, 0> sv;
   {
-    auto ctx = func->ctx();
-    auto module = ctx->module();
-    auto target = ctx->target();
+    // code generation is deferred to the JIT, so emit from an optimized copy
+    auto target = func->ctx()->target();
+    auto module = llvm::CloneModule(*func->impl()->getParent());
+    _jit_context::optimize(*module);
     llvm::legacy::PassManager pass;
     llvm::raw_svector_ostream os(sv);
     if (target->addPassesToEmitFile(
@@ -74,12 +74,20 @@ typedef enum {
 #define	JIT_TYPE_INT64		 4
 #define	JIT_TYPE_PTR			 5
 
+// wide integer types, only available with the LLVM backend
+#define	JIT_TYPE_INT128		 7
+#define	JIT_TYPE_INT192		 8
+#define	JIT_TYPE_INT256		 9
+
 extern const jit_type_t jit_type_void;
 extern const jit_type_t jit_type_int8;
 extern const jit_type_t jit_type_int16;
 extern const jit_type_t jit_type_int32;
 extern const jit_type_t jit_type_int64;
 extern const jit_type_t jit_type_ptr;
+extern const jit_type_t jit_type_int128;
+extern const jit_type_t jit_type_int192;
+extern const jit_type_t jit_type_int256;
 
 jit_type_t jit_type_create_signature(jit_abi_t abi, jit_type_t return_type, jit_type_t *args, unsigned int num_args, int incref);
 void jit_type_free(jit_type_t type);
@@ -95,6 +103,12 @@ void jit_context_destroy(jit_context_t context);
 void jit_context_build_start(jit_context_t context);
 void jit_context_build_end(jit_context_t context);
 
+// Enables a persistent object cache, 'tag' is mixed into the cache keys.
+void jit_context_set_cache(jit_context_t context, const char* dir, jit_nuint max_size, const char* tag);
+
+// Sets the number of compile threads (0 = all cores), must precede the first compile.
+void jit_context_set_threads(jit_context_t context, unsigned int num_threads);
+
 //
 // Function API
 //
@@ -103,6 +117,9 @@ jit_function_t jit_function_create(jit_context_t context, jit_type_t signature);
 int jit_function_compile(jit_function_t func);
 void *jit_function_to_closure(jit_function_t func);
 
+// Resolves the closures of several functions of a context, compiling them concurrently.
+int jit_functions_to_closures(jit_function_t* funcs, unsigned int num_funcs, void** closures);
+
 //
 // Value API
 //
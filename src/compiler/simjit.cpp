@@ -20,6 +20,8 @@
   #include "libjit.h"
 #endif
 #include "compile.h"
+#include "workerpool.h"
+#include <mutex>
 
 namespace ch::internal::simjit {
 
@@ -32,6 +34,10 @@ static constexpr uint32_t WORD_SIZE = bitwidth_v<block_type>;
 static constexpr uint32_t WORD_MASK = WORD_SIZE - 1;
 static constexpr block_type WORD_MAX = std::numeric_limits<block_type>::max();
 static constexpr uint32_t INLINE_THRESHOLD = 8;
+static constexpr uint32_t ACT_CONE_SIZE = 32;
+static constexpr uint32_t CACHE_LINE_SIZE = 64;
+static constexpr uint32_t WIDE_SIZE = 256;
+static constexpr uint32_t WIDE_SELECT_CASES = 8;
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -162,6 +168,21 @@ static jit_type_t to_native_type(uint32_t size) {
   return to_value_type(native_size);
 }
 
+#ifdef LLVMJIT
+// integer type covering the words of a signal up to WIDE_SIZE bits
+static jit_type_t to_wide_type(uint32_t size) {
+  assert(size > 64 && size <= WIDE_SIZE);
+  switch (ceildiv(size, 64)) {
+  case 2:
+    return jit_type_int128;
+  case 3:
+    return jit_type_int192;
+  default:
+    return jit_type_int256;
+  }
+}
+#endif
+
 static uint32_t to_native_or_word_size(uint32_t size) {
   auto native_size = to_native_size(size);
   if (native_size <= WORD_SIZE)
@@ -230,8 +251,20 @@ static void error_handler(int error_code) {
 }
 
 class Compiler;
+struct sim_ctx_t;
+struct sim_state_t;
+
+void init_sdata(const sim_ctx_t* sim_ctx, 
+                const sim_state_t* state, 
+                sdata_type* data, 
+                lnodeimpl* node);
 
-void init_sdata(const Compiler* cp, sdata_type* data, lnodeimpl* node);
+void init_lane(const sim_ctx_t* sim_ctx,
+               sim_state_t* state,
+               const sim_state_t& src,
+               context* ctx,
+               const sim_lanes& lanes,
+               uint32_t lane);
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -288,7 +321,7 @@ struct print_data_t {
     return size;
   }
 
-  void init(printimpl* node, const Compiler* cp) {
+  void init(printimpl* node, const sim_ctx_t* sim_ctx, const sim_state_t* state) {
     auto buf = reinterpret_cast<uint8_t*>(this) + sizeof(print_data_t);
 
     auto fmt_len = node->format().size() + 1;
@@ -305,7 +338,7 @@ struct print_data_t {
     srcs = reinterpret_cast<sdata_type*>(buf);
     uint32_t pred = node->has_pred() ? 1 : 0;
     for (uint32_t i = 0, n = node->num_srcs() - pred; i < n; ++i) {
-      init_sdata(cp, &srcs[i], node->src(i + pred).impl());
+      init_sdata(sim_ctx, state, &srcs[i], node->src(i + pred).impl());
     }
   }
 };
@@ -333,7 +366,7 @@ struct assert_data_t {
     return size;
   }
 
-  void init(assertimpl* node, const Compiler* cp) {
+  void init(assertimpl* node, const sim_ctx_t* sim_ctx, const sim_state_t* state) {
     auto buf = reinterpret_cast<uint8_t*>(this) + sizeof(print_data_t);
 
     auto msg_len = node->message().size() + 1;
@@ -355,7 +388,7 @@ struct assert_data_t {
 
     column = node->sloc().column();
 
-    init_sdata(cp, &time, node->time().impl());
+    init_sdata(sim_ctx, state, &time, node->time().impl());
   }
 };
 
@@ -371,6 +404,17 @@ extern "C" void assert_data_eval(assert_data_t* self) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// the state buffer starts on a cache line so that the layout offsets hold
+static uint8_t* alloc_vars(uint32_t size) {
+  return new (std::align_val_t(CACHE_LINE_SIZE)) uint8_t[size];
+}
+
+static void free_vars(uint8_t* vars) {
+  if (vars) {
+    ::operator delete[](vars, std::align_val_t(CACHE_LINE_SIZE));
+  }
+}
+
 struct sim_state_t {
   block_type** ports;
   uint8_t* vars;
@@ -387,7 +431,7 @@ struct sim_state_t {
   {}
 
   ~sim_state_t() {
-    delete [] vars;
+    free_vars(vars);
     delete [] ports;
   #ifndef NDEBUG
     delete [] dbg;
@@ -397,29 +441,72 @@ struct sim_state_t {
 
 typedef int (*pfn_entry)(sim_state_t*);
 
-struct sim_ctx_t {
-  sim_ctx_t()
-  #ifdef JIT_BACKEND_INTERP
-    : j_func(nullptr) {
-  #else
-    : entry(nullptr) {
-  #endif
-    j_ctx = jit_context_create();
+struct cd_data_t {
+  int prev_value;
+
+  static uint32_t size() {
+    return sizeof(cd_data_t);
+  }
+
+  void init() {
+    this->prev_value = 0;
   }
+};
+
+struct snode_t {
+  uint32_t id;
+  uint32_t type;
+  uint32_t addr;
+  uint32_t size;
+  uint32_t length;
+};
+
+struct sim_ctx_t : public refcounted {
+  sim_ctx_t()
+    : lanes(nullptr)
+    , num_lanes(1)
+    , vars_size(0)
+    , ports_size(0)
+    , act_addr(0)
+    , num_cones(0)
+    , resync_addr(0)
+    , bypass(false)
+    , resync(false)
+    , cancelled(false)
+    , j_ctx(nullptr)
+    , origin(nullptr)
+  {}
 
   ~sim_ctx_t() {
+    delete [] lanes;
     if (j_ctx) {
       jit_context_destroy(j_ctx);
     }
+    if (origin) {
+      origin->release();
+    }
   }
 
   sim_state_t state;
+  sim_state_t* lanes; // states of lanes 1..num_lanes-1
+  uint32_t num_lanes;
 #ifdef JIT_BACKEND_INTERP
-  jit_function_t j_func;
+  std::vector<jit_function_t> j_funcs; // region functions in evaluation order
 #else
-  pfn_entry entry;
+  std::vector<pfn_entry> entries;      // region functions in evaluation order
 #endif
+  std::vector<snode_t> snodes;         // sequential state in vars
+  alloc_map_t addr_map;                // node addresses in vars and ports
+  uint32_t vars_size;
+  uint32_t ports_size;
+  uint32_t act_addr;                   // dirty flags of combinational cones
+  uint32_t num_cones;
+  uint32_t resync_addr;                // forces the bypassed logic to run
+  bool bypass;                         // clock-path bypass in use
+  bool resync;
+  std::atomic<bool> cancelled;
   jit_context_t j_ctx;  
+  const sim_ctx_t* origin;             // owner of the code of a forked context
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -460,40 +547,55 @@ private:
     std::vector<uint32_t> nodes;
   };
 
-  struct cd_data_t {
-    int prev_value;
-
-    static uint32_t size() {
-      return sizeof(cd_data_t);
-    }
+  struct region_t {
+    uint32_t begin;
+    std::vector<lnodeimpl*> imports;
+  };
 
-    void init() {
-      this->prev_value = 0;
-    }
+  struct cone_t {
+    uint32_t begin;
+    uint32_t end;
+    bool always;                    // reads state changing every cycle
+    std::vector<uint32_t> users;    // consumer cones
+    std::vector<uint32_t> exports;  // scalars read outside the cone
+    uint32_t flag_addr;
   };
 
   sim_ctx_t*      sim_ctx_;
-  alloc_map_t     addr_map_;
+  sim_state_t*    init_state_;
+  alloc_map_t&    addr_map_;
+  alloc_map_t     spill_map_;
+  std::unordered_map<uint32_t, jit_type_t> spill_types_;
+  std::vector<region_t> regions_;
+  std::vector<cone_t> cones_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> act_map_;
+  alloc_map_t     shadow_map_;
+  std::vector<ioportimpl*> act_inputs_;
+  jit_label_t     l_cone_;
+  bool            act_enable_;
   var_map_t       input_map_;
   var_map_t       scalar_map_;  
   jit_label_t     l_bypass_;
   bypass_set_t    bypass_nodes_;
   bool            bypass_enable_;
+  uint32_t        bypass_cd_;
   sblock_t        sblock_;
   jit_type_t      word_type_;
   jit_function_t  j_func_;
+  std::vector<jit_function_t> j_funcs_;
   jit_value_t     j_vars_;
   jit_value_t     j_ports_;
   uint32_t        vars_size_;
   uint32_t        ports_size_;
+#ifdef LLVMJIT
+  bool            wide_enable_;
+#endif
 #ifndef NDEBUG
   jit_value_t     j_dbg_;
   uint32_t        dbg_off_;
 #endif
   std::vector<uint8_t*> meta_allocs_;
 
-  friend void init_sdata(const Compiler* Cp, sdata_type* data, lnodeimpl* node);
-
   friend class SrcMarker;
 
   void* create_meta_allocation(size_t size) {
@@ -506,6 +608,7 @@ private:
     jit_type_t params[1] = {jit_type_ptr};
     auto j_sig = jit_type_create_signature(jit_abi_cdecl, jit_type_int32, params, 1, 1);
     j_func_ = jit_function_create(sim_ctx_->j_ctx, j_sig);
+    j_funcs_.push_back(j_func_);
     jit_type_free(j_sig);
     auto j_state = jit_value_get_param(j_func_, 0);
     j_vars_ = jit_insn_load_relative(j_func_, j_state, offsetof(sim_state_t, vars), jit_type_ptr);
@@ -655,6 +758,12 @@ private:
     }
 
     auto need_resize = node->should_resize_opds();
+
+  #ifdef LLVMJIT
+    if (!is_scalar && this->emit_wide_op(node))
+      return;
+  #endif
+
     auto j_src0 = this->emit_op_operand(node, 0, is_scalar, need_resize);
     auto j_src1 = this->emit_op_operand(node, 1, is_scalar, need_resize);
 
@@ -1398,6 +1507,11 @@ private:
     auto j_ntype = to_native_type(dst_width);
     auto l = node->num_srcs() - 1;
 
+  #ifdef LLVMJIT
+    if (!is_scalar && this->emit_wide_select(node))
+      return;
+  #endif
+
     jit_value_t j_dst = nullptr;
     if (is_scalar) {
       j_dst = jit_value_create(j_func_, j_ntype);
@@ -1550,20 +1664,370 @@ private:
 
     jit_insn_store_relative(j_func_, j_vars_, addr, j_clk);
 
+    // save the edge flag before the bypass branch for later regions
+    this->emit_spill(node, j_changed);
+
+    // activity tracking already skips logic that did not change.
+    // a reloaded state, e.g. after the swap from the interpreter,
+    // evaluates the bypassed logic once through the resync flag.
     auto bypass_enable = (1 == node->ctx()->cdomains().size())
+                       && !act_enable_
                        && 0 == (platform::self().cflags() & ch_flags::disable_cpb)
                        && ch::internal::compiler::build_bypass_list(bypass_nodes_, node->ctx(), node->id());
+    scalar_map_[node->id()] = j_changed;
     if (bypass_enable) {      
-      jit_label_t l_skip(jit_label_undefined);
-      jit_insn_branch_if_not(j_func_, j_changed, &l_skip);
-      l_bypass_ = l_skip;
+      this->emit_bypass_branch(j_changed);
       bypass_enable_ = true;
+      sim_ctx_->bypass = true;
+      bypass_cd_ = node->id();
     } else {
-      scalar_map_[node->id()] = j_changed;
       bypass_enable_ = false;
     }
   }
 
+  void emit_bypass_branch(jit_value_t j_changed) {
+    // a reloaded state also needs the bypassed logic to be evaluated
+    jit_label_t l_enter(jit_label_undefined);
+    l_bypass_ = jit_label_undefined;
+    jit_insn_branch_if(j_func_, j_changed, &l_enter);
+    auto j_resync = jit_insn_load_relative(j_func_, j_vars_, sim_ctx_->resync_addr, jit_type_int32);
+    jit_insn_branch_if_not(j_func_, j_resync, &l_bypass_);
+    jit_insn_label(j_func_, &l_enter);
+  }
+
+  void partition_nodes(const std::vector<lnodeimpl*>& eval_list) {
+    regions_.push_back({0, {}});
+
+    auto region_size = platform::self().jit_region_size();
+    if (0 == region_size || eval_list.size() <= region_size)
+      return;
+
+    std::unordered_map<uint32_t, uint32_t> node_regions;
+    for (uint32_t i = 0, n = eval_list.size(); i < n; ++i) {
+      auto region = i / region_size;
+      if (region == regions_.size()) {
+        regions_.push_back({i, {}});
+      }
+      // nodes can be listed more than once, use the first definition
+      node_regions.emplace(eval_list[i]->id(), region);
+    }
+
+    for (uint32_t region = 1; region < regions_.size(); ++region) {
+      auto& imports = regions_[region].imports;
+      std::unordered_set<uint32_t> visited;
+      auto end = (region + 1 < regions_.size()) ? regions_[region + 1].begin : eval_list.size();
+      for (auto i = regions_[region].begin; i < end; ++i) {
+        auto node = eval_list[i];
+        auto import = [&](lnodeimpl* src) {
+          if (visited.count(src->id()))
+            return;
+          auto type = src->type();
+          if (type_reg == type
+           || type_msrport == type
+           || type_time == type) {
+            // scalar state is preloaded from memory by every region
+            if (src->size() > WORD_SIZE)
+              return;
+          } else {
+            if (src == node || node_regions[src->id()] >= region)
+              return;
+            switch (type) {
+            case type_lit:
+            case type_input:
+            case type_udfout:
+              // re-emitted locally
+              break;
+            case type_cd:
+              spill_map_[src->id()] = 0;
+              break;
+            case type_op:
+            case type_sel:
+            case type_proxy:
+            case type_marport:
+            case type_mwport:
+              if (src->size() > WORD_SIZE)
+                return;
+              spill_map_[src->id()] = 0;
+              break;
+            default:
+              return;
+            }
+          }
+          visited.insert(src->id());
+          imports.push_back(src);
+        };
+        import(node);
+        for (auto& src : node->srcs()) {
+          import(src.impl());
+        }
+      }
+    }
+
+    // edge flags are needed to resume bypassed code in later regions
+    for (auto node : eval_list) {
+      if (type_cd == node->type()) {
+        spill_map_[node->id()] = 0;
+      }
+    }
+  }
+
+  void partition_cones(const std::vector<lnodeimpl*>& eval_list) {
+    auto ctx = eval_list.back()->ctx();
+    act_enable_ = (0 == (platform::self().cflags() & ch_flags::disable_act))
+               && ctx->udfs().empty();
+    if (!act_enable_)
+      return;
+
+    auto is_cone_type = [](lnodetype type) {
+      switch (type) {
+      case type_op:
+      case type_sel:
+      case type_proxy:
+      case type_marport:
+      case type_output:
+      case type_tap:
+        return true;
+      default:
+        return false;
+      }
+    };
+
+    auto add_unique = [](std::vector<uint32_t>& list, uint32_t value) {
+      if (std::find(list.begin(), list.end(), value) == list.end()) {
+        list.push_back(value);
+      }
+    };
+
+    // group consecutive combinational nodes into cones
+    std::unordered_map<uint32_t, uint32_t> node_cones;
+    bool open = false;
+    uint32_t region = 0;
+    for (uint32_t i = 0, n = eval_list.size(); i < n; ++i) {
+      auto node = eval_list[i];
+      if (region + 1 < regions_.size()
+       && regions_[region + 1].begin == i) {
+        ++region;
+        open = false;
+      }
+      auto type = node->type();
+      if (type_lit == type)
+        continue;
+      if (!is_cone_type(type)) {
+        open = false;
+        continue;
+      }
+      if (!open || (i - cones_.back().begin) >= ACT_CONE_SIZE) {
+        cones_.push_back({i, i + 1, false, {}, {}, 0});
+        open = true;
+      }
+      uint32_t index = cones_.size() - 1;
+      auto& cone = cones_.back();
+      cone.end = i + 1;
+      for (auto& src : node->srcs()) {
+        switch (src.impl()->type()) {
+        case type_lit:
+          break;
+        case type_time:
+          cone.always = true;
+          break;
+        case type_input:
+        case type_reg:
+        case type_msrport:
+        case type_mem:
+          add_unique(act_map_[src.id()], index);
+          break;
+        default: {
+          auto it = node_cones.find(src.id());
+          if (it == node_cones.end() || cones_[it->second].always) {
+            cone.always = true;
+          } else if (it->second != index) {
+            add_unique(cones_[it->second].users, index);
+          }
+        } break;
+        }
+      }
+      node_cones[node->id()] = index;
+    }
+
+    // cones evaluated every cycle need no change tracking
+    for (auto it = act_map_.begin(); it != act_map_.end();) {
+      auto& users = it->second;
+      users.erase(std::remove_if(users.begin(), users.end(),
+                                 [&](uint32_t index) { return cones_[index].always; }),
+                  users.end());
+      it = users.empty() ? act_map_.erase(it) : std::next(it);
+    }
+
+    // guarded cones only define their scalars when dirty,
+    // values read outside of them are reloaded from spill slots.
+    node_cones.clear();
+    uint32_t index = 0;
+    for (uint32_t i = 0, n = eval_list.size(); i < n; ++i) {
+      auto node = eval_list[i];
+      while (index < cones_.size() && cones_[index].end <= i) {
+        ++index;
+      }
+      bool in_cone = (index < cones_.size() && cones_[index].begin <= i);
+      for (auto& src : node->srcs()) {
+        auto it = node_cones.find(src.id());
+        if (it == node_cones.end()
+         || (in_cone && it->second == index))
+          continue;
+        auto& producer = cones_[it->second];
+        if (producer.always || src.size() > WORD_SIZE)
+          continue;
+        add_unique(producer.exports, src.id());
+        spill_map_[src.id()] = 0;
+      }
+      if (in_cone && is_cone_type(node->type())) {
+        node_cones[node->id()] = index;
+      }
+    }
+  }
+
+  void begin_cone(uint32_t index) {
+    auto& cone = cones_[index];
+    if (cone.always)
+      return;
+    __source_marker();
+    auto j_dirty = jit_insn_load_relative(j_func_, j_vars_, cone.flag_addr, jit_type_int32);
+    l_cone_ = jit_label_undefined;
+    jit_insn_branch_if_not(j_func_, j_dirty, &l_cone_);
+    auto j_zero = this->emit_constant(0, jit_type_int32);
+    jit_insn_store_relative(j_func_, j_vars_, cone.flag_addr, j_zero);
+    this->emit_mark_cones(cone.users);
+  }
+
+  void end_cone(uint32_t index) {
+    auto& cone = cones_[index];
+    if (cone.always)
+      return;
+    jit_insn_label(j_func_, &l_cone_);
+    for (auto id : cone.exports) {
+      if (spill_types_.count(id)) {
+        this->emit_unspill(id);
+      }
+    }
+  }
+
+  void emit_mark_cones(const std::vector<uint32_t>& cones) {
+    auto j_one = this->emit_constant(1, jit_type_int32);
+    for (auto index : cones) {
+      auto& cone = cones_[index];
+      if (cone.always)
+        continue;
+      jit_insn_store_relative(j_func_, j_vars_, cone.flag_addr, j_one);
+    }
+  }
+
+  void emit_act_update(lnodeimpl* node, jit_value_t j_changed) {
+    auto it = act_map_.find(node->id());
+    if (it == act_map_.end())
+      return;
+    if (j_changed) {
+      jit_label_t l_skip(jit_label_undefined);
+      jit_insn_branch_if_not(j_func_, j_changed, &l_skip);
+      this->emit_mark_cones(it->second);
+      jit_insn_label(j_func_, &l_skip);
+    } else {
+      this->emit_mark_cones(it->second);
+    }
+  }
+
+  void emit_act_inputs() {
+    __source_marker();
+    for (auto node : act_inputs_) {
+      auto dst_width = node->size();
+      auto addr = addr_map_.at(node->id());
+      auto shadow_addr = shadow_map_.at(node->id());
+      auto j_src_ptr = jit_insn_load_relative(j_func_, j_ports_, addr * sizeof(block_type*), jit_type_ptr);
+      jit_label_t l_skip(jit_label_undefined);
+      if (dst_width <= WORD_SIZE) {
+        auto j_xtype = to_native_or_word_type(dst_width);
+        auto j_value = jit_insn_load_relative(j_func_, j_src_ptr, 0, j_xtype);
+        auto j_shadow = jit_insn_load_relative(j_func_, j_vars_, shadow_addr, j_xtype);
+        auto j_eq = jit_insn_eq(j_func_, j_value, j_shadow);
+        jit_insn_branch_if(j_func_, j_eq, &l_skip);
+        jit_insn_store_relative(j_func_, j_vars_, shadow_addr, j_value);
+      } else {
+        auto j_shadow_ptr = jit_insn_add_relative(j_func_, j_vars_, shadow_addr);
+        auto j_eq = this->emit_eq_vector(j_src_ptr, dst_width, j_shadow_ptr, dst_width, false);
+        jit_insn_branch_if(j_func_, j_eq, &l_skip);
+        this->emit_memcpy(j_shadow_ptr, j_src_ptr, __align_word_size(dst_width));
+      }
+      this->emit_mark_cones(act_map_.at(node->id()));
+      jit_insn_label(j_func_, &l_skip);
+    }
+  }
+
+  void begin_region(uint32_t region) {
+    this->create_function();
+    scalar_map_.clear();
+    input_map_.clear();
+
+    for (auto node : regions_[region].imports) {
+      switch (node->type()) {
+      case type_lit:
+        this->emit_node(reinterpret_cast<litimpl*>(node));
+        break;
+      case type_input:
+      case type_udfout:
+        this->emit_node_input(reinterpret_cast<ioportimpl*>(node));
+        break;
+      case type_reg:
+      case type_msrport:
+      case type_time:
+        this->emit_preload(node);
+        break;
+      default:
+        this->emit_unspill(node);
+        break;
+      }
+    }
+
+    if (bypass_enable_) {
+      // resume the bypass branch of the previous region
+      auto j_changed = this->emit_unspill(bypass_cd_);
+      this->emit_bypass_branch(j_changed);
+    }
+  }
+
+  void end_region() {
+    if (sblock_.cd) {
+      this->flush_sblock();
+    }
+    if (bypass_enable_) {
+      jit_insn_label_tight(j_func_, &l_bypass_);
+    }
+    auto j_zero = this->emit_constant(0, jit_type_int32);
+    jit_insn_return(j_func_, j_zero);
+  }
+
+  void emit_spill(lnodeimpl* node, jit_value_t j_value) {
+    auto it = spill_map_.find(node->id());
+    if (it == spill_map_.end())
+      return;
+    if (get_value_size(j_value) > to_native_size(node->size())) {
+      // packed slots only hold the native type
+      j_value = this->emit_cast(j_value, to_native_type(node->size()));
+    }
+    spill_types_[node->id()] = jit_value_get_type(j_value);
+    jit_insn_store_relative(j_func_, j_vars_, it->second, j_value);
+  }
+
+  jit_value_t emit_unspill(uint32_t id) {
+    auto j_type = spill_types_.at(id);
+    auto j_value = jit_insn_load_relative(j_func_, j_vars_, spill_map_.at(id), j_type);
+    scalar_map_[id] = j_value;
+    return j_value;
+  }
+
+  void emit_unspill(lnodeimpl* node) {
+    if (0 == spill_types_.count(node->id()))
+      return;
+    this->emit_unspill(node->id());
+  }
+
   void resolve_branch(lnodeimpl* node) {
     if (sblock_.cd
      && ((0 != (platform::self().cflags() & ch_flags::disable_snc)
@@ -1591,27 +2055,25 @@ private:
 
     jit_label_t l_exit(jit_label_undefined);
 
-    // emit clock domain
+    // emit clock domain, the bypass branch can also be entered to resync
     bool merged_cd_enable = false;
-    if (!bypass_enable_) {
-      if (!sblock_.reset) {
-        auto it = sblock_.nodes.begin();
-        auto end = sblock_.nodes.end();
-        auto enable = get_snode_enable(*it++);
-        if (enable) {
-          merged_cd_enable = true;
-          while (it != end) {
-            if (get_snode_enable(*it++) != enable) {
-              merged_cd_enable = false;
-              break;
-            }
+    if (!sblock_.reset) {
+      auto it = sblock_.nodes.begin();
+      auto end = sblock_.nodes.end();
+      auto enable = get_snode_enable(*it++);
+      if (enable) {
+        merged_cd_enable = true;
+        while (it != end) {
+          if (get_snode_enable(*it++) != enable) {
+            merged_cd_enable = false;
+            break;
           }
         }
       }
-      if (!merged_cd_enable) {
-        auto j_cd = scalar_map_.at(sblock_.cd->id());
-        jit_insn_branch_if_not(j_func_, j_cd, &l_exit);
-      }
+    }
+    if (!merged_cd_enable) {
+      auto j_cd = scalar_map_.at(sblock_.cd->id());
+      jit_insn_branch_if_not(j_func_, j_cd, &l_exit);
     }
 
     if (sblock_.reset) {
@@ -1803,6 +2265,8 @@ private:
         this->emit_memcpy(j_dst_ptr, j_init_ptr, ceildiv(dst_width, 8));
       }
     }
+
+    this->emit_act_update(node, nullptr);
   }
 
   void emit_snode_value(regimpl* node) {
@@ -1816,10 +2280,15 @@ private:
 
     jit_value_t j_dst = nullptr;
     jit_value_t j_next = nullptr;
+    jit_value_t j_prev = nullptr;
+    jit_value_t j_changed = nullptr;
 
     if (is_scalar) {
       j_dst = scalar_map_.at(node->id());
       j_next = scalar_map_.at(node->next().id());
+      if (act_map_.count(node->id())) {
+        j_prev = jit_insn_load(j_func_, j_dst);
+      }
     }
 
     if (node->is_pipe()) {
@@ -1838,6 +2307,9 @@ private:
           jit_insn_store_relative(j_func_, j_vars_, dst_addr, j_pipe);
           auto j_pipe_n = this->emit_cast(j_pipe, j_ntype);
           jit_insn_store(j_func_, j_dst, j_pipe_n);
+          if (j_prev) {
+            j_changed = jit_insn_ne(j_func_, j_prev, j_pipe_n);
+          }
 
           // pipe <- next
           auto j_next_x = this->emit_cast(j_next, j_xtype);
@@ -1850,6 +2322,9 @@ private:
           auto j_pipe_0_x = this->emit_cast(j_pipe_0_n, j_xtype);
           jit_insn_store_relative(j_func_, j_vars_, dst_addr, j_pipe_0_x);
           jit_insn_store(j_func_, j_dst, j_pipe_0_n);
+          if (j_prev) {
+            j_changed = jit_insn_ne(j_func_, j_prev, j_pipe_0_n);
+          }
 
           // pipe >>= dst_width
           auto j_shift = this->emit_constant(dst_width, jit_type_int32);
@@ -1886,6 +2361,9 @@ private:
             auto j_data_x = this->emit_cast(j_data_n, j_xtype);
             jit_insn_store_relative(j_func_, j_vars_, dst_addr, j_data_x);
             jit_insn_store(j_func_, j_dst, j_data_n);
+            if (j_prev) {
+              j_changed = jit_insn_ne(j_func_, j_prev, j_data_n);
+            }
 
             // push next data
             this->emit_store_array_scalar(j_pipe_ptr, pipe_width, j_pipe_index, j_next, dst_width);
@@ -1912,12 +2390,22 @@ private:
         auto j_next_x = this->emit_cast(j_next, j_xtype);
         jit_insn_store_relative(j_func_, j_vars_, dst_addr, j_next_x);
         jit_insn_store(j_func_, j_dst, j_next);        
+        if (j_prev) {
+          j_changed = jit_insn_ne(j_func_, j_prev, j_next);
+        }
       } else {
         auto j_dst_ptr = jit_insn_add_relative(j_func_, j_vars_, dst_addr);
         auto j_next_ptr = this->emit_pointer_address(node->next().impl());
+        if (act_map_.count(node->id())) {
+          auto j_eq = this->emit_eq_vector(j_dst_ptr, dst_width, j_next_ptr, dst_width, false);
+          j_changed = jit_insn_to_not_bool(j_func_, j_eq);
+        }
         this->emit_memcpy(j_dst_ptr, j_next_ptr, ceildiv(dst_width, 8));
       }
     }
+
+    // wide pipe stages are not compared
+    this->emit_act_update(node, j_changed);
   }
 
   void emit_node(marportimpl* node) {
@@ -1954,6 +2442,7 @@ private:
 
     auto dst_width = node->size();
     bool is_scalar = (dst_width <= WORD_SIZE);
+    jit_value_t j_changed = nullptr;
 
     auto j_src_addr = scalar_map_.at(node->addr().id());
   #ifndef NDEBUG
@@ -1971,11 +2460,17 @@ private:
       auto j_src_n = this->emit_cast(j_src, j_ntype);
       auto j_src_x = this->emit_cast(j_src_n, j_xtype);
       jit_insn_store_relative(j_func_, j_vars_, dst_addr, j_src_x);
+      if (act_map_.count(node->id())) {
+        auto j_prev = jit_insn_load(j_func_, j_dst);
+        j_changed = jit_insn_ne(j_func_, j_prev, j_src_n);
+      }
       jit_insn_store(j_func_, j_dst, j_src_n);
     } else {
       auto j_dst_ptr = this->emit_pointer_address(node);
       this->emit_load_array_vector(j_dst_ptr, dst_width, j_array_ptr, j_src_addr);
     }
+
+    this->emit_act_update(node, j_changed);
   }
 
   void emit_node(mwportimpl* node) {
@@ -2004,6 +2499,8 @@ private:
       auto j_wdata_ptr = this->emit_pointer_address(node->wdata().impl());
       this->emit_store_array_vector(j_array_ptr, j_dst_addr, j_wdata_ptr, data_width);
     }
+
+    this->emit_act_update(node->mem(), nullptr);
   }
 
   void emit_node(timeimpl* node) {
@@ -2190,13 +2687,43 @@ private:
 
   /////////////////////////////////////////////////////////////////////////////
 
-  void allocate_nodes(context* ctx) {
+  void allocate_nodes(const std::vector<lnodeimpl*>& eval_list) {
+    auto ctx = eval_list.back()->ctx();
+    auto layout = (0 == (platform::self().cflags() & ch_flags::disable_lay));
     std::vector<const_alloc_t> constants;
+    std::unordered_set<uint32_t> visited;
+    std::unordered_map<uint32_t, uint32_t> fanouts;
     uint32_t consts_size = 0;
     uint32_t var_addr = 0;    
     uint32_t port_addr = 0;
 
-    for (auto node : ctx->nodes()) {
+    if (layout) {
+      for (auto node : eval_list) {
+        for (auto& src : node->srcs()) {
+          ++fanouts[src.id()];
+        }
+      }
+    }
+
+    struct slot_t {
+      lnodeimpl* node;
+      uint32_t bytes;
+    };
+    std::vector<slot_t> scalars;
+    std::vector<slot_t> vectors;
+
+    auto place = [&](lnodeimpl* node, uint32_t bytes) {
+      if (layout) {
+        (bytes > sizeof(block_type) ? vectors : scalars).push_back({node, bytes});
+      } else {
+        addr_map_[node->id()] = var_addr;
+        var_addr += bytes;
+      }
+    };
+
+    auto allocate = [&](lnodeimpl* node) {
+      if (!visited.insert(node->id()).second)
+        return;
       auto dst_width = node->size();
       auto type = node->type();
       switch (type) {
@@ -2214,45 +2741,37 @@ private:
         addr_map_[node->id()] = port_addr++;
         break;
       case type_cd:
-        addr_map_[node->id()] = var_addr;
-        var_addr += __align_word_size(cd_data_t::size() * 8);
+        place(node, __align_word_size(cd_data_t::size() * 8));
         break;
       case type_reg: {
-        addr_map_[node->id()] = var_addr;
         auto reg = reinterpret_cast<regimpl*>(node);
-        var_addr += __align_word_size(reg->size());
+        auto bytes = __align_word_size(reg->size());
         if (reg->is_pipe()) {
           auto pipe_width = (reg->length() - 1) * reg->size();
-          var_addr += __align_word_size(pipe_width);
+          bytes += __align_word_size(pipe_width);
           if (pipe_width > WORD_SIZE) {
-            var_addr += sizeof(uint32_t); // pipe index
+            bytes += sizeof(uint32_t); // pipe index
           }
         }
+        place(node, bytes);
       } break;
       case type_mem:
       case type_msrport:
-        addr_map_[node->id()] = var_addr;
-        var_addr += __align_word_size(dst_width);
+      case type_time:
+        place(node, __align_word_size(dst_width));
         break;
-      case type_time: {
-        addr_map_[node->id()] = var_addr;
-        var_addr += __align_word_size(dst_width);
-      } break;
       case type_assert: {
-        addr_map_[node->id()] = var_addr;
         auto a = reinterpret_cast<assertimpl*>(node);
-        var_addr += __align_word_size(assert_data_t::size(a) * 8);
+        place(node, __align_word_size(assert_data_t::size(a) * 8));
       } break;
       case type_print: {
-        addr_map_[node->id()] = var_addr;
         auto p = reinterpret_cast<printimpl*>(node);
-        var_addr += __align_word_size(print_data_t::size(p) * 8);
+        place(node, __align_word_size(print_data_t::size(p) * 8));
       } break;
       case type_udfc:
       case type_udfs: {
-        addr_map_[node->id()] = var_addr;
         auto u = reinterpret_cast<udfimpl*>(node);
-        var_addr += __align_word_size(udf_data_t::size(u) * 8);
+        place(node, __align_word_size(udf_data_t::size(u) * 8));
       } break;      
       case type_op:
       case type_sel:
@@ -2261,25 +2780,144 @@ private:
       case type_mwport:
         // only allocate nodes with size bigger than WORD_SIZE bits
         if (dst_width > WORD_SIZE) {
-          addr_map_[node->id()] = var_addr;
-          var_addr += __align_word_size(dst_width);
+          place(node, __align_word_size(dst_width));
         }
         break;
       }
+    };
+
+    if (layout) {
+      // lay out state in evaluation order, the operands of a node
+      // are placed together ahead of their first reader.
+      for (auto node : eval_list) {
+        for (auto& src : node->srcs()) {
+          allocate(src.impl());
+        }
+        allocate(node);
+      }
+    }
+    for (auto node : ctx->nodes()) {
+      allocate(node);
+    }
+
+    if (layout) {
+      // word-sized values are packed ahead of the vectors, a vector never
+      // straddles a cache line it fits in and shared ones start a new line.
+      for (auto& slot : scalars) {
+        addr_map_[slot.node->id()] = var_addr;
+        var_addr += slot.bytes;
+      }
+      for (auto& slot : vectors) {
+        auto offset = var_addr % CACHE_LINE_SIZE;
+        if (offset) {
+          if (slot.bytes <= CACHE_LINE_SIZE) {
+            if (offset + slot.bytes > CACHE_LINE_SIZE) {
+              var_addr += CACHE_LINE_SIZE - offset;
+            }
+          } else if (fanouts[slot.node->id()] > 1) {
+            var_addr += CACHE_LINE_SIZE - offset;
+          }
+        }
+        addr_map_[slot.node->id()] = var_addr;
+        var_addr += slot.bytes;
+      }
+    }
+
+    // register sequential state for save/restore
+    for (auto node : ctx->nodes()) {
+      auto type = node->type();
+      switch (type) {
+      case type_cd:
+        sim_ctx_->snodes.push_back({node->id(), type, addr_map_.at(node->id()), 1, 1});
+        break;
+      case type_reg: {
+        auto reg = reinterpret_cast<regimpl*>(node);
+        sim_ctx_->snodes.push_back({node->id(), type, addr_map_.at(node->id()), reg->size(), reg->length()});
+      } break;
+      case type_mem:
+      case type_msrport:
+      case type_time:
+        sim_ctx_->snodes.push_back({node->id(), type, addr_map_.at(node->id()), node->size(), 1});
+        break;
+      default:
+        break;
+      }
+    }
+
+    // allocate spill slots for scalars crossing region boundaries,
+    // scalars of up to 32 bits share a word.
+    auto spill_addr = var_addr;
+    uint32_t half_addr = 0;
+    visited.clear();
+    auto spill = [&](lnodeimpl* node) {
+      auto it = spill_map_.find(node->id());
+      if (it == spill_map_.end()
+       || !visited.insert(node->id()).second)
+        return;
+      if (layout && to_native_size(node->size()) < WORD_SIZE) {
+        if (half_addr) {
+          it->second = half_addr;
+          half_addr = 0;
+        } else {
+          it->second = var_addr;
+          half_addr = var_addr + sizeof(block_type) / 2;
+          var_addr += __align_word_size(WORD_SIZE);
+        }
+      } else {
+        it->second = var_addr;
+        var_addr += __align_word_size(WORD_SIZE);
+      }
+    };
+    if (layout) {
+      for (auto node : eval_list) {
+        spill(node);
+      }
+    }
+    for (auto node : ctx->nodes()) {
+      spill(node);
+    }
+
+    // allocate cone flags and last input values
+    auto act_addr = var_addr;
+    for (uint32_t i = 0, n = cones_.size(); i < n; ++i) {
+      cones_[i].flag_addr = act_addr + i * sizeof(int32_t);
+    }
+    var_addr += __align_word_size(cones_.size() * 32);
+    for (auto node : ctx->nodes()) {
+      if (type_input == node->type() && act_map_.count(node->id())) {
+        act_inputs_.push_back(reinterpret_cast<ioportimpl*>(node));
+        shadow_map_[node->id()] = var_addr;
+        var_addr += __align_word_size(node->size());
+      }
     }
+    sim_ctx_->act_addr = act_addr;
+    sim_ctx_->num_cones = cones_.size();
+
+    // set when a state reload invalidates bypassed values
+    sim_ctx_->resync_addr = var_addr;
+    var_addr += __align_word_size(32);
 
     auto vars_size = var_addr + consts_size;
     if (vars_size) {
-      sim_ctx_->state.vars = new uint8_t[vars_size];
+      sim_ctx_->state.vars = alloc_vars(vars_size);
       vars_size_= vars_size;
+      sim_ctx_->vars_size = vars_size;
+      std::fill(sim_ctx_->state.vars + spill_addr, sim_ctx_->state.vars + var_addr, 0);
       if (consts_size) {
         this->init_constants(constants, var_addr, consts_size);
       }
     }
 
+    if (sim_ctx_->num_cones) {
+      // all cones are evaluated in the first cycle
+      auto flags = reinterpret_cast<int32_t*>(sim_ctx_->state.vars + sim_ctx_->act_addr);
+      std::fill_n(flags, sim_ctx_->num_cones, 1);
+    }
+
     if (port_addr) {
       sim_ctx_->state.ports = new block_type*[port_addr];
       ports_size_ = port_addr;
+      sim_ctx_->ports_size = port_addr;
     }
 
   #ifndef NDEBUG
@@ -2289,6 +2927,21 @@ private:
     this->init_variables(ctx);
   }
 
+  void allocate_lanes(context* ctx, const sim_lanes& lanes) {
+    auto num_lanes = lanes.count();
+    if (num_lanes <= 1)
+      return;
+
+    // additional lanes share the compiled function and clone the initial
+    // state of lane 0, only their port bindings and metadata differ.
+    sim_ctx_->lanes = new sim_state_t[num_lanes - 1];
+    sim_ctx_->num_lanes = num_lanes;
+
+    for (uint32_t i = 1; i < num_lanes; ++i) {
+      init_lane(sim_ctx_, &sim_ctx_->lanes[i - 1], sim_ctx_->state, ctx, lanes, i);
+    }
+  }
+
   uint32_t alloc_constant(litimpl* lit, std::vector<const_alloc_t>& constants) {
     auto dst_width = lit->size();
     if (dst_width <= WORD_SIZE)
@@ -2339,8 +2992,6 @@ private:
     __source_marker();
     for (auto node : ctx->nodes()) {
       auto dst_width = node->size();      
-      auto j_ntype = to_native_type(dst_width);
-      auto j_xtype = to_native_or_word_type(dst_width);
       auto type = node->type();
 
       switch (type) {
@@ -2376,15 +3027,7 @@ private:
             *reinterpret_cast<uint32_t*>(sim_ctx_->state.vars + pipe_index_addr) = 0;
           }
         }
-        if (dst_width <= WORD_SIZE) {
-          // preload scalar value
-          auto j_var = jit_value_create(j_func_, j_ntype);
-          auto addr = addr_map_.at(node->id());
-          auto j_dst = jit_insn_load_relative(j_func_, j_vars_, addr, j_xtype);
-          auto j_dst_n = this->emit_cast(j_dst, j_ntype);
-          jit_insn_store(j_func_, j_var, j_dst_n);
-          scalar_map_[node->id()] = j_var;
-        }
+        this->emit_preload(node);
       } break;
       case type_mem: {
         auto addr = addr_map_.at(node->id());
@@ -2399,33 +3042,22 @@ private:
       case type_msrport: {
         auto addr = addr_map_.at(node->id());
         bv_init(reinterpret_cast<block_type*>(sim_ctx_->state.vars + addr), dst_width);
-        if (dst_width <= WORD_SIZE) {          
-          // preload scalar value
-          auto j_var = jit_value_create(j_func_, j_ntype);
-          auto j_dst = jit_insn_load_relative(j_func_, j_vars_, addr, j_xtype);
-          auto j_dst_n = this->emit_cast(j_dst, j_ntype);
-          jit_insn_store(j_func_, j_var, j_dst_n);
-          scalar_map_[node->id()] = j_var;
-        }
+        this->emit_preload(node);
       } break;
       case type_time: {
         auto addr = addr_map_.at(node->id());
         bv_reset(reinterpret_cast<block_type*>(sim_ctx_->state.vars + addr), dst_width);        
-        if (dst_width <= WORD_SIZE) {
-          // preload scalar value
-          auto j_dst = jit_insn_load_relative(j_func_, j_vars_, addr, j_xtype);
-          scalar_map_[node->id()] = j_dst;
-        }
+        this->emit_preload(node);
       } break;
       case type_assert: {
         auto addr = addr_map_.at(node->id());
         auto a = reinterpret_cast<assertimpl*>(node);
-        reinterpret_cast<assert_data_t*>(sim_ctx_->state.vars + addr)->init(a, this);
+        reinterpret_cast<assert_data_t*>(sim_ctx_->state.vars + addr)->init(a, sim_ctx_, init_state_);
       } break;
       case type_print: {
         auto addr = addr_map_.at(node->id());
         auto p = reinterpret_cast<printimpl*>(node);
-        reinterpret_cast<print_data_t*>(sim_ctx_->state.vars + addr)->init(p, this);
+        reinterpret_cast<print_data_t*>(sim_ctx_->state.vars + addr)->init(p, sim_ctx_, init_state_);
       } break;
       case type_udfc:
       case type_udfs: {
@@ -2447,6 +3079,26 @@ private:
     }
   }
 
+  void emit_preload(lnodeimpl* node) {
+    auto dst_width = node->size();
+    if (dst_width > WORD_SIZE)
+      return;
+    // preload scalar value
+    auto j_ntype = to_native_type(dst_width);
+    auto j_xtype = to_native_or_word_type(dst_width);
+    auto addr = addr_map_.at(node->id());
+    if (type_time == node->type()) {
+      auto j_dst = jit_insn_load_relative(j_func_, j_vars_, addr, j_xtype);
+      scalar_map_[node->id()] = j_dst;
+    } else {
+      auto j_var = jit_value_create(j_func_, j_ntype);
+      auto j_dst = jit_insn_load_relative(j_func_, j_vars_, addr, j_xtype);
+      auto j_dst_n = this->emit_cast(j_dst, j_ntype);
+      jit_insn_store(j_func_, j_var, j_dst_n);
+      scalar_map_[node->id()] = j_var;
+    }
+  }
+
   void init_constants(const std::vector<const_alloc_t>& constants,
                       uint32_t offset,
                       uint32_t size) {    
@@ -2489,6 +3141,264 @@ private:
     return j_ret;
   }
 
+#ifdef LLVMJIT
+  // lowers an operator on signals up to WIDE_SIZE bits to native integer code,
+  // returns false if the operator is left to the word-array code.
+  bool emit_wide_op(opimpl* node) {
+    __source_marker();
+    if (!wide_enable_)
+      return false;
+
+    auto op = node->op();
+    switch (op) {
+    case ch_op::eq:
+    case ch_op::ne:
+    case ch_op::lt:
+    case ch_op::gt:
+    case ch_op::le:
+    case ch_op::ge:
+    case ch_op::notl:
+    case ch_op::andl:
+    case ch_op::orl:
+    case ch_op::inv:
+    case ch_op::andb:
+    case ch_op::orb:
+    case ch_op::xorb:
+    case ch_op::andr:
+    case ch_op::orr:
+    case ch_op::shl:
+    case ch_op::shr:
+    case ch_op::neg:
+    case ch_op::add:
+    case ch_op::sub:
+    case ch_op::mul:
+    case ch_op::pad:
+      break;
+    default:
+      return false;
+    }
+
+    // the shift amount is read as a 32-bit value like on the word-array path
+    auto is_shift = (op_flags::shift == CH_OP_CLASS(op));
+    auto num_opds = is_shift ? 1 : node->num_srcs();
+    auto width = node->size();
+    for (uint32_t i = 0; i < num_opds; ++i) {
+      width = std::max(width, node->src(i).size());
+    }
+    if (width > WIDE_SIZE)
+      return false;
+
+    // reductions and logical operators ignore the sign
+    auto is_signed = node->is_signed();
+    switch (op) {
+    case ch_op::notl:
+    case ch_op::andl:
+    case ch_op::orl:
+    case ch_op::andr:
+    case ch_op::orr:
+      is_signed = false;
+      break;
+    default:
+      break;
+    }
+
+    auto j_type = to_wide_type(width);
+    auto j_src0 = this->emit_load_wide(node->src(0).impl(), j_type, is_signed);
+    jit_value_t j_src1 = nullptr;
+    if (is_shift) {
+      auto j_amount = this->emit_op_operand(node, 1, false, false);
+      j_src1 = jit_insn_convert(j_func_, j_amount, j_type, 0);
+    } else if (node->num_srcs() > 1) {
+      j_src1 = this->emit_load_wide(node->src(1).impl(), j_type, is_signed);
+    }
+
+    auto j_zero = this->emit_constant(0, j_type);
+    jit_value_t j_dst;
+    switch (op) {
+    default:
+      assert(false);
+    case ch_op::eq:
+      j_dst = jit_insn_eq(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::ne:
+      j_dst = jit_insn_ne(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::lt:
+      j_dst = is_signed ? jit_insn_slt(j_func_, j_src0, j_src1) : jit_insn_ult(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::gt:
+      j_dst = is_signed ? jit_insn_sgt(j_func_, j_src0, j_src1) : jit_insn_ugt(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::le:
+      j_dst = is_signed ? jit_insn_sle(j_func_, j_src0, j_src1) : jit_insn_ule(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::ge:
+      j_dst = is_signed ? jit_insn_sge(j_func_, j_src0, j_src1) : jit_insn_uge(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::notl:
+      j_dst = jit_insn_eq(j_func_, j_src0, j_zero);
+      break;
+    case ch_op::andl: {
+      auto j_src0_b = jit_insn_ne(j_func_, j_src0, j_zero);
+      auto j_src1_b = jit_insn_ne(j_func_, j_src1, j_zero);
+      j_dst = jit_insn_and(j_func_, j_src0_b, j_src1_b);
+    } break;
+    case ch_op::orl:
+      j_dst = jit_insn_ne(j_func_, jit_insn_or(j_func_, j_src0, j_src1), j_zero);
+      break;
+    case ch_op::inv:
+      j_dst = jit_insn_not(j_func_, j_src0);
+      break;
+    case ch_op::andb:
+      j_dst = jit_insn_and(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::orb:
+      j_dst = jit_insn_or(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::xorb:
+      j_dst = jit_insn_xor(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::andr: {
+      auto j_ones = this->emit_wide_mask(node->src(0).size(), j_type);
+      j_dst = jit_insn_eq(j_func_, j_src0, j_ones);
+    } break;
+    case ch_op::orr:
+      j_dst = jit_insn_ne(j_func_, j_src0, j_zero);
+      break;
+    case ch_op::shl:
+    case ch_op::shr: {
+      // shifting by the type width or more is undefined in the IR
+      auto j_max = this->emit_constant(get_type_size(j_type), j_type);
+      auto j_overflow = jit_insn_uge(j_func_, j_src1, j_max);
+      jit_value_t j_shifted, j_fill;
+      if (ch_op::shl == op) {
+        j_shifted = jit_insn_shl(j_func_, j_src0, j_src1);
+        j_fill = j_zero;
+      } else if (is_signed) {
+        j_shifted = jit_insn_sshr(j_func_, j_src0, j_src1);
+        auto j_msb = this->emit_constant(get_type_size(j_type) - 1, j_type);
+        j_fill = jit_insn_sshr(j_func_, j_src0, j_msb);
+      } else {
+        j_shifted = jit_insn_ushr(j_func_, j_src0, j_src1);
+        j_fill = j_zero;
+      }
+      j_dst = jit_insn_select(j_func_, j_overflow, j_fill, j_shifted);
+    } break;
+    case ch_op::neg:
+      j_dst = jit_insn_sub(j_func_, j_zero, j_src0);
+      break;
+    case ch_op::add:
+      j_dst = jit_insn_add(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::sub:
+      j_dst = jit_insn_sub(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::mul:
+      j_dst = jit_insn_mul(j_func_, j_src0, j_src1);
+      break;
+    case ch_op::pad:
+      j_dst = j_src0;
+      break;
+    }
+
+    this->emit_store_wide(node, j_dst);
+    return true;
+  }
+
+  // lowers a multiplexer up to WIDE_SIZE bits to a chain of selects,
+  // returns false if it is left to the branching code.
+  bool emit_wide_select(selectimpl* node) {
+    __source_marker();
+    if (!wide_enable_)
+      return false;
+
+    auto dst_width = node->size();
+    auto l = node->num_srcs() - 1;
+    if (dst_width > WIDE_SIZE
+     || l / 2 > WIDE_SELECT_CASES)
+      return false;
+
+    auto key_size = node->has_key() ? node->key().size() : 0;
+    if (key_size > WIDE_SIZE)
+      return false;
+    auto j_ktype = (key_size > WORD_SIZE) ? to_wide_type(key_size) : nullptr;
+    jit_value_t j_key = nullptr;
+    if (j_ktype) {
+      j_key = this->emit_load_wide(node->key().impl(), j_ktype, false);
+    } else if (node->has_key()) {
+      j_key = scalar_map_.at(node->key().id());
+    }
+
+    // later cases are applied first so that the earliest match wins
+    auto j_type = to_wide_type(dst_width);
+    auto j_dst = this->emit_load_wide(node->src(l).impl(), j_type, false);
+    int start = node->has_key() ? 1 : 0;
+    for (int i = l - 2; i >= start; i -= 2) {
+      jit_value_t j_pred;
+      if (node->has_key()) {
+        auto j_val = j_ktype ? this->emit_load_wide(node->src(i).impl(), j_ktype, false)
+                             : scalar_map_.at(node->src(i).id());
+        j_pred = jit_insn_eq(j_func_, j_key, j_val);
+      } else {
+        j_pred = scalar_map_.at(node->src(i).id());
+      }
+      auto j_src = this->emit_load_wide(node->src(i + 1).impl(), j_type, false);
+      j_dst = jit_insn_select(j_func_, j_pred, j_src, j_dst);
+    }
+
+    this->emit_store_wide(node, j_dst);
+    return true;
+  }
+
+  // loads a signal into a wide integer, extending it from its size
+  jit_value_t emit_load_wide(lnodeimpl* node, jit_type_t j_type, bool is_signed) {
+    auto size = node->size();
+    jit_value_t j_value;
+    auto it = scalar_map_.find(node->id());
+    if (it != scalar_map_.end()) {
+      j_value = it->second;
+    } else if (size <= WORD_SIZE) {
+      j_value = this->emit_load_scalar_relative(node, 0, to_native_or_word_type(size));
+    } else {
+      j_value = this->emit_load_scalar_relative(node, 0, to_wide_type(size));
+    }
+    j_value = jit_insn_convert(j_func_, j_value, j_type, 0);
+    auto type_size = get_type_size(j_type);
+    if (is_signed && size < type_size) {
+      auto j_shift = this->emit_constant(type_size - size, j_type);
+      auto j_tmp = jit_insn_shl(j_func_, j_value, j_shift);
+      j_value = jit_insn_sshr(j_func_, j_tmp, j_shift);
+    }
+    return j_value;
+  }
+
+  // stores a wide integer into a signal, dropping the bits above its size
+  void emit_store_wide(lnodeimpl* node, jit_value_t j_value) {
+    auto size = node->size();
+    if (size <= WORD_SIZE) {
+      scalar_map_[node->id()] = jit_insn_convert(j_func_, j_value, to_native_type(size), 0);
+      this->emit_clear_extra_bits(node);
+      return;
+    }
+    auto j_type = to_wide_type(size);
+    auto j_dst = jit_insn_convert(j_func_, j_value, j_type, 0);
+    auto type_size = get_type_size(j_type);
+    if (size < type_size) {
+      auto j_mask = this->emit_wide_mask(size, j_type);
+      j_dst = jit_insn_and(j_func_, j_dst, j_mask);
+    }
+    this->emit_store_scalar_relative(node, 0, j_dst);
+  }
+
+  // all ones in the low 'size' bits
+  jit_value_t emit_wide_mask(uint32_t size, jit_type_t j_type) {
+    auto j_zero = this->emit_constant(0, j_type);
+    auto j_ones = jit_insn_not(j_func_, j_zero);
+    auto j_shift = this->emit_constant(get_type_size(j_type) - size, j_type);
+    return jit_insn_ushr(j_func_, j_ones, j_shift);
+  }
+#endif
+
   jit_value_t emit_xorr_scalar(jit_value_t j_value, uint32_t width) {
     __source_marker();
 
@@ -3155,11 +4065,19 @@ public:
 
   Compiler(sim_ctx_t* ctx)
     : sim_ctx_(ctx)
+    , init_state_(&ctx->state)
+    , addr_map_(ctx->addr_map)
+    , l_cone_(jit_label_undefined)
+    , act_enable_(false)
     , l_bypass_(jit_label_undefined)
     , bypass_enable_(false)
+    , bypass_cd_(0)
     , word_type_(to_value_type(WORD_SIZE))
     , vars_size_(0)
     , ports_size_(0)
+  #ifdef LLVMJIT
+    , wide_enable_(0 == (platform::self().cflags() & ch_flags::disable_wid))
+  #endif
   #ifndef NDEBUG
     , dbg_off_(0)
   #endif
@@ -3171,19 +4089,39 @@ public:
     }
   }
 
-  void build(const std::vector<lnodeimpl*>& eval_list) {
+  void build(const std::vector<lnodeimpl*>& eval_list, const sim_lanes& lanes) {
     // begin build
     jit_context_build_start(sim_ctx_->j_ctx);
 
+    // split the eval list into regions
+    this->partition_nodes(eval_list);
+
+    // group combinational logic into activity cones
+    this->partition_cones(eval_list);
+
     // create JIT function
     this->create_function();
 
     // allocate objects
-    this->allocate_nodes(eval_list.back()->ctx());
+    this->allocate_nodes(eval_list);
+
+    // detect input changes
+    this->emit_act_inputs();
 
     // lower all nodes
-    for (auto node : eval_list) {
+    uint32_t region = 0;
+    uint32_t cone = 0;
+    for (uint32_t i = 0, n = eval_list.size(); i < n; ++i) {
+      auto node = eval_list[i];
+      if (region + 1 < regions_.size()
+       && regions_[region + 1].begin == i) {
+        this->end_region();
+        this->begin_region(++region);
+      }
       this->resolve_branch(node);
+      if (cone < cones_.size() && cones_[cone].begin == i) {
+        this->begin_cone(cone);
+      }
       switch (node->type()) {
       default:
         assert(false);
@@ -3241,11 +4179,23 @@ public:
       case type_mem:
         break;
       }
+      if (type_cd != node->type()) {
+        auto it = scalar_map_.find(node->id());
+        if (it != scalar_map_.end()) {
+          this->emit_spill(node, it->second);
+        }
+      }
+      if (cone < cones_.size() && cones_[cone].end == i + 1) {
+        this->end_cone(cone++);
+      }
     }
 
     // create bypass label
     this->resolve_branch(nullptr);
 
+    // allocate additional lanes
+    this->allocate_lanes(eval_list.back()->ctx(), lanes);
+
     // return 0
     auto j_zero = this->emit_constant(0, jit_type_int32);
     jit_insn_return(j_func_, j_zero);
@@ -3253,13 +4203,37 @@ public:
     // dump JIT assembly code
     if (platform::self().cflags() & ch_flags::dump_ast) {
       auto file = fopen("simjit.ast", "w");
-      jit_dump_ast(file, j_func_, "simjit");
+      for (auto j_func : j_funcs_) {
+        jit_dump_ast(file, j_func, "simjit");
+      }
       fclose(file);
     }
 
-    // compile function
-    if (!jit_function_compile(j_func_))
-      exit(1);
+  #ifdef LLVMJIT
+    jit_context_set_threads(sim_ctx_->j_ctx, platform::self().jit_threads());
+
+    // enable object cache
+    auto& cache_dir = platform::self().jit_cache_dir();
+    if (!cache_dir.empty()) {
+      auto tag = stringf("cflags=%d", static_cast<int>(platform::self().cflags()));
+      jit_context_set_cache(sim_ctx_->j_ctx,
+                            cache_dir.c_str(),
+                            platform::self().jit_cache_size(),
+                            tag.c_str());
+    }
+  #endif
+
+    // abort if the simulator no longer needs this build
+    if (sim_ctx_->cancelled) {
+      jit_context_build_end(sim_ctx_->j_ctx);
+      return;
+    }
+
+    // compile functions
+    for (auto j_func : j_funcs_) {
+      if (!jit_function_compile(j_func))
+        exit(1);
+    }
 
     // end build
     jit_context_build_end(sim_ctx_->j_ctx);
@@ -3267,15 +4241,30 @@ public:
     // dump JIT assembly code
     if (platform::self().cflags() & ch_flags::dump_asm) {
       auto file = fopen("simjit.asm", "w");
-      jit_dump_asm(file, j_func_, "simjit");
+      for (auto j_func : j_funcs_) {
+        jit_dump_asm(file, j_func, "simjit");
+      }
       fclose(file);
     }
 
   #ifdef JIT_BACKEND_INTERP
-    sim_ctx_->j_func = j_func_;
+    sim_ctx_->j_funcs = j_funcs_;
   #else
-    // get closure
-    sim_ctx_->entry = reinterpret_cast<pfn_entry>(jit_function_to_closure(j_func_));
+    // get closures
+  #ifdef LLVMJIT
+    // a single lookup compiles the region functions in parallel
+    std::vector<void*> closures(j_funcs_.size());
+    if (!jit_functions_to_closures(j_funcs_.data(), j_funcs_.size(), closures.data()))
+      exit(1);
+    for (auto closure : closures) {
+      sim_ctx_->entries.push_back(reinterpret_cast<pfn_entry>(closure));
+    }
+  #else
+    for (auto j_func : j_funcs_) {
+      auto entry = reinterpret_cast<pfn_entry>(jit_function_to_closure(j_func));
+      sim_ctx_->entries.push_back(entry);
+    }
+  #endif
   #endif
   }
 };
@@ -3306,54 +4295,293 @@ SrcMarker::~SrcMarker() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void init_sdata(const Compiler* Cp, sdata_type* data, lnodeimpl* node) {
+void init_sdata(const sim_ctx_t* sim_ctx, 
+                const sim_state_t* state, 
+                sdata_type* data, 
+                lnodeimpl* node) {
   block_type* value = nullptr;
-  auto it = Cp->addr_map_.find(node->id());
-  if (it != Cp->addr_map_.end()) {
+  auto it = sim_ctx->addr_map.find(node->id());
+  if (it != sim_ctx->addr_map.end()) {
     auto addr = it->second;
     switch (node->type()) {
     case type_input:
     case type_udfout:
-      assert(addr < Cp->ports_size_);
-      value = Cp->sim_ctx_->state.ports[addr];
+      assert(addr < sim_ctx->ports_size);
+      value = state->ports[addr];
       break;
     default:
-      assert(addr < Cp->vars_size_);
-      value = reinterpret_cast<block_type*>(Cp->sim_ctx_->state.vars + addr);
+      assert(addr < sim_ctx->vars_size);
+      value = reinterpret_cast<block_type*>(state->vars + addr);
       break;
     }
   }
   data->emplace(value, node->size());
 }
 
+void init_lane(const sim_ctx_t* sim_ctx,
+               sim_state_t* state,
+               const sim_state_t& src,
+               context* ctx,
+               const sim_lanes& lanes,
+               uint32_t lane) {
+  if (sim_ctx->vars_size) {
+    state->vars = alloc_vars(sim_ctx->vars_size);
+    std::copy_n(src.vars, sim_ctx->vars_size, state->vars);
+  }
+  if (sim_ctx->ports_size) {
+    state->ports = new block_type*[sim_ctx->ports_size];
+  }
+#ifndef NDEBUG
+  state->dbg = new char[4096];
+  std::copy_n(src.dbg, 4096, state->dbg);
+#endif
+
+  // metadata pointing into the state is rebuilt
+  for (auto node : ctx->nodes()) {
+    switch (node->type()) {
+    case type_input:
+    case type_output:
+    case type_tap: {
+      auto addr = sim_ctx->addr_map.at(node->id());
+      auto ioport = reinterpret_cast<ioportimpl*>(node);
+      state->ports[addr] = lanes.port(lane, ioport)->words();
+    } break;
+    case type_assert: {
+      auto addr = sim_ctx->addr_map.at(node->id());
+      auto a = reinterpret_cast<assertimpl*>(node);
+      reinterpret_cast<assert_data_t*>(state->vars + addr)->init(a, sim_ctx, state);
+    } break;
+    case type_print: {
+      auto addr = sim_ctx->addr_map.at(node->id());
+      auto p = reinterpret_cast<printimpl*>(node);
+      reinterpret_cast<print_data_t*>(state->vars + addr)->init(p, sim_ctx, state);
+    } break;
+    default:
+      break;
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
-driver::driver() {
+driver::driver(uint32_t num_threads)
+  : pool_(nullptr)
+  , num_threads_(num_threads) {
   sim_ctx_ = new sim_ctx_t();
+  sim_ctx_->acquire();
 }
 
 driver::~driver() {
-  delete sim_ctx_;
+  delete pool_;
+  sim_ctx_->release();
 }
 
-void driver::initialize(const std::vector<lnodeimpl*>& eval_list) {
+void driver::initialize(const std::vector<lnodeimpl*>& eval_list,
+                        const sim_lanes& lanes) {
+  // JIT contexts share global type bindings, builds are serialized
+  static std::mutex s_mutex;
+  std::lock_guard<std::mutex> lock(s_mutex);
+  profile_timer timer(profile_counter::jit);
+  sim_ctx_->j_ctx = jit_context_create();
   Compiler compiler(sim_ctx_);
-  compiler.build(eval_list);
+  compiler.build(eval_list, lanes);
+
+  // lanes are independent, they are spread over the worker threads.
+  // prints stay on one thread to keep their output in lane order.
+  auto ctx = eval_list.back()->ctx();
+  bool has_prints = std::any_of(ctx->gtaps().begin(), ctx->gtaps().end(), [](lnodeimpl* node) {
+    return (type_print == node->type());
+  });
+  num_threads_ = has_prints ? 1 : std::min(num_threads_, lanes.count());
+  if (num_threads_ > 1) {
+    pool_ = new worker_pool(num_threads_);
+  }
 }
 
-void driver::eval() {
-  int ret;
+void driver::cancel() {
+  sim_ctx_->cancelled = true;
+}
+
+sim_driver* driver::fork(const std::vector<lnodeimpl*>& eval_list,
+                         const sim_lanes& lanes) const {
+  // the fork runs the compiled functions on a copy of each lane state
+  auto sim = new driver(num_threads_);
+  auto sim_ctx = sim->sim_ctx_;
+  sim_ctx->origin = sim_ctx_->origin ? sim_ctx_->origin : sim_ctx_;
+  sim_ctx->origin->acquire();
 #ifdef JIT_BACKEND_INTERP
-  void* arg = &sim_ctx_->state;
-  void* args[1] = {&arg};
-  jit_int j_ret;
-  jit_function_apply(sim_ctx_->j_func, args, &j_ret);
-  ret = static_cast<int>(j_ret);
+  sim_ctx->j_funcs = sim_ctx_->j_funcs;
 #else
-  ret = (sim_ctx_->entry)(&sim_ctx_->state);
+  sim_ctx->entries = sim_ctx_->entries;
 #endif
-  if (ret) {
-    error_handler(ret);
+  sim_ctx->snodes      = sim_ctx_->snodes;
+  sim_ctx->addr_map    = sim_ctx_->addr_map;
+  sim_ctx->vars_size   = sim_ctx_->vars_size;
+  sim_ctx->ports_size  = sim_ctx_->ports_size;
+  sim_ctx->act_addr    = sim_ctx_->act_addr;
+  sim_ctx->num_cones   = sim_ctx_->num_cones;
+  sim_ctx->resync_addr = sim_ctx_->resync_addr;
+  sim_ctx->bypass      = sim_ctx_->bypass;
+  sim_ctx->resync      = sim_ctx_->resync;
+
+  auto ctx = eval_list.back()->ctx();
+  init_lane(sim_ctx, &sim_ctx->state, sim_ctx_->state, ctx, lanes, 0);
+  auto num_lanes = sim_ctx_->num_lanes;
+  if (num_lanes > 1) {
+    sim_ctx->lanes = new sim_state_t[num_lanes - 1];
+    sim_ctx->num_lanes = num_lanes;
+    for (uint32_t i = 1; i < num_lanes; ++i) {
+      init_lane(sim_ctx, &sim_ctx->lanes[i - 1], sim_ctx_->lanes[i - 1], ctx, lanes, i);
+    }
+  }
+  return sim;
+}
+
+void driver::save_state(uint32_t lane, sim_state& state) const {
+  auto vars = (0 == lane) ? sim_ctx_->state.vars : sim_ctx_->lanes[lane - 1].vars;
+  for (auto& snode : sim_ctx_->snodes) {
+    auto src = reinterpret_cast<const block_type*>(vars + snode.addr);
+    auto& data = state[snode.id];
+    switch (snode.type) {
+    case type_cd: {
+      auto cd_data = reinterpret_cast<const cd_data_t*>(vars + snode.addr);
+      data = sdata_type(1, cd_data->prev_value ? 1 : 0);
+    } break;
+    case type_reg: {
+      // stages are saved in pop order after the register value
+      data = sdata_type(snode.size * snode.length);
+      bv_copy(data.words(), src, snode.size);
+      auto n = snode.length - 1;
+      if (n) {
+        auto pipe_width = n * snode.size;
+        auto pipe_addr = snode.addr + __align_word_size(snode.size);
+        auto pipe = reinterpret_cast<const block_type*>(vars + pipe_addr);
+        uint32_t index = 0;
+        if (pipe_width > WORD_SIZE) {
+          index = *reinterpret_cast<const uint32_t*>(vars + pipe_addr + __align_word_size(pipe_width));
+        }
+        for (uint32_t k = 0; k < n; ++k) {
+          auto i = (pipe_width > WORD_SIZE) ? ((index + n - k) % n) : k;
+          bv_copy(data.words(), (k + 1) * snode.size, pipe, i * snode.size, snode.size);
+        }
+      }
+    } break;
+    default:
+      data = sdata_type(snode.size);
+      bv_copy(data.words(), src, snode.size);
+      break;
+    }
+  }
+}
+
+void driver::load_state(uint32_t lane, const sim_state& state) {
+  auto vars = (0 == lane) ? sim_ctx_->state.vars : sim_ctx_->lanes[lane - 1].vars;
+  for (auto& snode : sim_ctx_->snodes) {
+    auto it = state.find(snode.id);
+    if (it == state.end())
+      continue;
+    auto& data = it->second;
+    auto dst = reinterpret_cast<block_type*>(vars + snode.addr);
+    switch (snode.type) {
+    case type_cd: {
+      auto cd_data = reinterpret_cast<cd_data_t*>(vars + snode.addr);
+      cd_data->prev_value = static_cast<int>(data.word(0) & 0x1);
+    } break;
+    case type_reg: {
+      // the stages follow the value in the same words
+      bv_copy(dst, 0, data.words(), 0, snode.size);
+      auto n = snode.length - 1;
+      if (n) {
+        auto pipe_width = n * snode.size;
+        auto pipe_addr = snode.addr + __align_word_size(snode.size);
+        auto pipe = reinterpret_cast<block_type*>(vars + pipe_addr);
+        for (uint32_t k = 0; k < n; ++k) {
+          auto i = (pipe_width > WORD_SIZE) ? (n - 1 - k) : k;
+          bv_copy(pipe, i * snode.size, data.words(), (k + 1) * snode.size, snode.size);
+        }
+        if (pipe_width > WORD_SIZE) {
+          *reinterpret_cast<uint32_t*>(vars + pipe_addr + __align_word_size(pipe_width)) = n - 1;
+        }
+      }
+    } break;
+    default:
+      bv_copy(dst, data.words(), snode.size);
+      break;
+    }
+  }
+
+  if (sim_ctx_->num_cones) {
+    // cached combinational values are stale
+    auto flags = reinterpret_cast<int32_t*>(vars + sim_ctx_->act_addr);
+    std::fill_n(flags, sim_ctx_->num_cones, 1);
+  }
+
+  if (sim_ctx_->bypass) {
+    // bypassed values are stale until the next clock edge
+    *reinterpret_cast<int32_t*>(vars + sim_ctx_->resync_addr) = 1;
+    sim_ctx_->resync = true;
+  }
+}
+
+void driver::dump_stats(std::ostream& out) const {
+  out << "ch-stats: simulation threads = " << num_threads_ << std::endl;
+}
+
+static void eval_lane(sim_ctx_t* sim_ctx, sim_state_t* state) {
+#ifdef JIT_BACKEND_INTERP
+  for (auto j_func : sim_ctx->j_funcs) {
+    void* arg = state;
+    void* args[1] = {&arg};
+    jit_int j_ret;
+    jit_function_apply(j_func, args, &j_ret);
+    auto ret = static_cast<int>(j_ret);
+    if (ret) {
+      error_handler(ret);
+    }
+  }
+#else
+  for (auto entry : sim_ctx->entries) {
+    auto ret = entry(state);
+    if (ret) {
+      error_handler(ret);
+    }
+  }
+#endif
+}
+
+void driver::eval() {
+  if (pool_) {
+    // each thread runs every num_threads-th lane through the same functions
+    std::exception_ptr error;
+    std::mutex mutex;
+    pool_->run([&](uint32_t tid) {
+      try {
+        for (uint32_t i = tid, n = sim_ctx_->num_lanes; i < n; i += num_threads_) {
+          eval_lane(sim_ctx_, (0 == i) ? &sim_ctx_->state : &sim_ctx_->lanes[i - 1]);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    });
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  } else {
+    // lanes run back to back through the same functions
+    eval_lane(sim_ctx_, &sim_ctx_->state);
+    for (uint32_t i = 1, n = sim_ctx_->num_lanes; i < n; ++i) {
+      eval_lane(sim_ctx_, &sim_ctx_->lanes[i - 1]);
+    }
+  }
+  if (sim_ctx_->resync) {
+    *reinterpret_cast<int32_t*>(sim_ctx_->state.vars + sim_ctx_->resync_addr) = 0;
+    for (uint32_t i = 1, n = sim_ctx_->num_lanes; i < n; ++i) {
+      *reinterpret_cast<int32_t*>(sim_ctx_->lanes[i - 1].vars + sim_ctx_->resync_addr) = 0;
+    }
+    sim_ctx_->resync = false;
   }
 }
 
@@ -9,17 +9,32 @@ struct sim_ctx_t;
 class driver : public sim_driver {
 public:
 
-  driver();
+  explicit driver(uint32_t num_threads = 1);
 
   ~driver() override;
 
-  void initialize(const std::vector<lnodeimpl*>& eval_list) override;
+  void initialize(const std::vector<lnodeimpl*>& eval_list,
+                  const sim_lanes& lanes) override;
 
   void eval() override;  
 
+  sim_driver* fork(const std::vector<lnodeimpl*>& eval_list,
+                   const sim_lanes& lanes) const override;
+
+  void save_state(uint32_t lane, sim_state& state) const override;
+
+  void load_state(uint32_t lane, const sim_state& state) override;
+
+  void dump_stats(std::ostream& out) const override;
+
+  // aborts a build running on another thread
+  void cancel();
+
 private:
 
   sim_ctx_t* sim_ctx_;
+  worker_pool* pool_;
+  uint32_t num_threads_;
 };
 
 }
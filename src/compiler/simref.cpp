@@ -15,21 +15,86 @@
 #include "udfimpl.h"
 #include "udf.h"
 #include "compile.h"
+#include "workerpool.h"
+#include <cstddef>
+#include <numeric>
 
 using namespace ch::internal;
 //using namespace ch::internal::simref;
 
 namespace ch::internal::simref {
 
+struct instr_base;
+
+using eval_fn_t = void (*)(instr_base*);
+
 struct instr_base {
 
-  instr_base() {}
+  instr_base() : eval_fn_(nullptr) {}
 
   virtual ~instr_base() {}
 
-  virtual void destroy() = 0;
+  virtual void save_state(sdata_type&) const {}
+
+  virtual void load_state(const sdata_type&) {}
+
+  eval_fn_t eval_fn() const {
+    return eval_fn_;
+  }
+
+protected:
+
+  // bind the instruction's concrete eval() to a direct call
+  template <typename T>
+  static T* bind(T* instr) {
+    instr->eval_fn_ = [](instr_base* self) {
+      static_cast<T*>(self)->T::eval();
+    };
+    return instr;
+  }
+
+  eval_fn_t eval_fn_;
+};
+
+// bump allocator keeping the instructions and their data contiguous
+class instr_arena {
+public:
+
+  instr_arena() : cur_(nullptr), end_(nullptr) {}
+
+  ~instr_arena() {
+    for (auto chunk : chunks_) {
+      ::operator delete(chunk);
+    }
+  }
+
+  void* alloc(size_t size) {
+    size = (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    if (size > size_t(end_ - cur_)) {
+      auto chunk_size = std::max(size, CHUNK_SIZE);
+      cur_ = reinterpret_cast<uint8_t*>(::operator new(chunk_size));
+      end_ = cur_ + chunk_size;
+      chunks_.push_back(cur_);
+    }
+    auto ptr = cur_;
+    cur_ += size;
+    memset(ptr, 0, size);
+    return ptr;
+  }
+
+private:
+
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  std::vector<uint8_t*> chunks_;
+  uint8_t* cur_;
+  uint8_t* end_;
+};
 
-  virtual void eval() = 0;
+// threaded code entry
+struct instr_code_t {
+  eval_fn_t fn;
+  instr_base* instr;
 };
 
 using data_map_t  = std::unordered_map<uint32_t, const block_type*>;
@@ -43,7 +108,7 @@ using node_map_t  = std::unordered_map<uint32_t, uint32_t>;
 class instr_proxy_base : public instr_base {
 public:
 
-  static instr_proxy_base* create(proxyimpl* node, data_map_t& map);
+  static instr_proxy_base* create(proxyimpl* node, data_map_t& map, instr_arena& arena);
 
 protected:
 
@@ -67,12 +132,7 @@ template <bool is_scalar>
 class instr_slice : public instr_proxy_base {
 public:
 
-  void destroy() override {
-    this->~instr_slice();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if constexpr (is_scalar) {
       bv_slice_vector_small(dst_, dst_size_, src_data_, src_offset_);
     } else {
@@ -101,12 +161,7 @@ template <bool is_scalar>
 class instr_proxy : public instr_proxy_base {
 public:
 
-  void destroy() override {
-    this->~instr_proxy();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if constexpr (is_scalar) {
       if (dst_size_ <= bitwidth_v<block_type>) {
         block_type dst_block = 0;
@@ -156,7 +211,7 @@ private:
   friend class instr_proxy_base;
 };
 
-instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
+instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size = node->size();
   uint32_t dst_nblocks = ceildiv(dst_size, bitwidth_v<block_type>);
   uint32_t dst_bytes = sizeof(block_type) * dst_nblocks;
@@ -164,7 +219,7 @@ instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
 
   if (1 == num_ranges
    && node->range(0).length == dst_size) {
-    auto buf = new uint8_t[__aligned_sizeof(instr_slice<false>) + dst_bytes]();
+    auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_slice<false>) + dst_bytes));
     auto buf_cur = buf + __aligned_sizeof(instr_slice<false>);
     auto dst = (block_type*)buf_cur;
     map[node->id()] = dst;
@@ -177,9 +232,9 @@ instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
 
     bool is_scalar = (dst_size <= bitwidth_v<block_type>);
     if (is_scalar) {
-      return new (buf) instr_slice<true>(dst, dst_size, map.at(src.id()) + src_idx, src_lsb);
+      return bind(new (buf) instr_slice<true>(dst, dst_size, map.at(src.id()) + src_idx, src_lsb));
     } else {
-      return new (buf) instr_slice<false>(dst, dst_size, map.at(src.id()) + src_idx, src_lsb);
+      return bind(new (buf) instr_slice<false>(dst, dst_size, map.at(src.id()) + src_idx, src_lsb));
     }
   } else {
     uint32_t range_bytes = 0;
@@ -187,7 +242,7 @@ instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
       range_bytes += __aligned_sizeof(instr_proxy_base::range_t);
     }
 
-    auto buf = new uint8_t[__aligned_sizeof(instr_proxy<false>) + dst_bytes + range_bytes]();
+    auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_proxy<false>) + dst_bytes + range_bytes));
     auto buf_cur = buf + __aligned_sizeof(instr_proxy<false>);
     auto dst = (block_type*)buf_cur;
     map[node->id()] = dst;
@@ -211,9 +266,9 @@ instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
     }
 
     if (is_scalar) {
-      return new (buf) instr_proxy<true>(dst, dst_size, ranges, num_ranges);
+      return bind(new (buf) instr_proxy<true>(dst, dst_size, ranges, num_ranges));
     } else {
-      return new (buf) instr_proxy<false>(dst, dst_size, ranges, num_ranges);
+      return bind(new (buf) instr_proxy<false>(dst, dst_size, ranges, num_ranges));
     }
   }
 }
@@ -223,7 +278,7 @@ instr_proxy_base* instr_proxy_base::create(proxyimpl* node, data_map_t& map) {
 class instr_output_base : public instr_base {
 public:
 
-  static instr_output_base* create(ioportimpl* node, data_map_t& map);
+  static instr_output_base* create(ioportimpl* node, block_type* dst, data_map_t& map, instr_arena& arena);
 
 protected:
 
@@ -242,11 +297,7 @@ template <bool is_scalar>
 class instr_output : public instr_output_base {
 public:
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     if constexpr (is_scalar) {
       bv_copy_scalar(dst_, src_);
     } else {
@@ -263,14 +314,13 @@ private:
   friend class instr_output_base;
 };
 
-instr_output_base* instr_output_base::create(ioportimpl* node, data_map_t& map) {
-  auto dst  = node->value()->words();
+instr_output_base* instr_output_base::create(ioportimpl* node, block_type* dst, data_map_t& map, instr_arena& arena) {
   auto src  = map.at(node->src(0).id());
   auto size = node->size();
   if (size <= bitwidth_v<block_type>) {
-    return new instr_output<true>(dst, src, size);
+    return bind(new (arena.alloc(sizeof(instr_output<true>))) instr_output<true>(dst, src, size));
   } else {
-    return new instr_output<false>(dst, src, size);
+    return bind(new (arena.alloc(sizeof(instr_output<false>))) instr_output<false>(dst, src, size));
   }
 }
 
@@ -279,7 +329,7 @@ instr_output_base* instr_output_base::create(ioportimpl* node, data_map_t& map)
 class instr_op_base : public instr_base {
 public:
 
-  static instr_op_base* create(opimpl* node, data_map_t& map);
+  static instr_op_base* create(opimpl* node, data_map_t& map, instr_arena& arena);
 
 protected:
 
@@ -306,15 +356,10 @@ protected:
 };
 
 template <ch_op op, bool is_signed, bool is_scalar, bool resize_opds>
-class instr_op : instr_op_base {
+class instr_op : public instr_op_base {
 public:
 
-  void destroy() override {
-    this->~instr_op();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     //--
     using bit_accessor_t = StaticBitAccessor<block_type, resize_opds, is_signed>;
 
@@ -524,7 +569,7 @@ private:
   friend class instr_op_base;
 };
 
-instr_op_base* instr_op_base::create(opimpl* node, data_map_t& map) {
+instr_op_base* instr_op_base::create(opimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size = node->size();
   bool is_signed = node->is_signed();
 
@@ -554,7 +599,7 @@ instr_op_base* instr_op_base::create(opimpl* node, data_map_t& map) {
 
   uint32_t dst_bytes = sizeof(block_type) * ceildiv(dst_size, bitwidth_v<block_type>);
 
-  auto buf = new uint8_t[__aligned_sizeof(instr_op_base) + dst_bytes]();
+  auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_op_base) + dst_bytes));
   auto buf_cur = buf + __aligned_sizeof(instr_op_base);
   auto dst = (block_type*)buf_cur;
   map[node->id()] = dst;
@@ -565,29 +610,29 @@ instr_op_base* instr_op_base::create(opimpl* node, data_map_t& map) {
     if (is_scalar) { \
       if (sign_enable && is_signed) { \
         if (resize_enable && resize_opds) { \
-          return new (buf) instr_op<op, true, true, true>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, true, true, true>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } else { \
-          return new (buf) instr_op<op, true, true, false>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, true, true, false>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         }  \
       } else { \
         if (resize_enable && resize_opds) { \
-          return new (buf) instr_op<op, false, true, true>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, false, true, true>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } else { \
-          return new (buf) instr_op<op, false, true, false>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, false, true, false>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } \
       } \
     } else { \
       if (sign_enable && is_signed) { \
         if (resize_enable && resize_opds) { \
-          return new (buf) instr_op<op, true, false, true>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, true, false, true>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } else { \
-          return new (buf) instr_op<op, true, false, false>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, true, false, false>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         }  \
       } else { \
         if (resize_enable && resize_opds) { \
-          return new (buf) instr_op<op, false, false, true>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, false, false, true>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } else { \
-          return new (buf) instr_op<op, false, false, false>(dst, dst_size, src0, src0_size, src1, src1_size); \
+          return bind(new (buf) instr_op<op, false, false, false>(dst, dst_size, src0, src0_size, src1, src1_size)); \
         } \
       } \
     }
@@ -629,7 +674,7 @@ instr_op_base* instr_op_base::create(opimpl* node, data_map_t& map) {
 class instr_select_base : public instr_base {
 public:
 
-  static instr_select_base* create(selectimpl* node, data_map_t& map);
+  static instr_select_base* create(selectimpl* node, data_map_t& map, instr_arena& arena);
 
 protected:
 
@@ -651,12 +696,7 @@ template <bool is_scalar>
 class instr_select : public instr_select_base {
 public:
 
-  void destroy() override {
-    this->~instr_select();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     auto *src = srcs_, *last = srcs_last_;
     for (;src < last; src += 2) {
       if (static_cast<bool>(**src)) {
@@ -685,12 +725,7 @@ template <bool is_scalar>
 class instr_case : public instr_select_base {
 public:
 
-  void destroy() override {
-    this->~instr_case();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     auto *key = srcs_, *src = srcs_ + 1, *last = srcs_last_;
     for (;src < last; src += 2) {
       if constexpr (is_scalar) {
@@ -726,7 +761,7 @@ private:
   friend class instr_select_base;
 };
 
-instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map) {
+instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size = node->size();
   uint32_t dst_nblocks = ceildiv(dst_size, bitwidth_v<block_type>);
   uint32_t dst_bytes = sizeof(block_type) * dst_nblocks;
@@ -739,7 +774,7 @@ instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map)
     uint32_t key_size = node->src(0).size();
     is_scalar &= key_size <= bitwidth_v<block_type>;
 
-    auto buf = new uint8_t[__aligned_sizeof(instr_case<false>) + dst_bytes + src_bytes]();
+    auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_case<false>) + dst_bytes + src_bytes));
     auto buf_cur = buf + __aligned_sizeof(instr_case<false>);
     auto dst = (block_type*)buf_cur;
     map[node->id()] = dst;
@@ -752,12 +787,12 @@ instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map)
     }
 
     if (is_scalar) {
-      return new (buf) instr_case<true>(dst, dst_size, srcs, num_srcs, key_size);
+      return bind(new (buf) instr_case<true>(dst, dst_size, srcs, num_srcs, key_size));
     } else {
-      return new (buf) instr_case<false>(dst, dst_size, srcs, num_srcs, key_size);
+      return bind(new (buf) instr_case<false>(dst, dst_size, srcs, num_srcs, key_size));
     }
   } else {
-    auto buf = new uint8_t[__aligned_sizeof(instr_select<false>) + dst_bytes + src_bytes]();
+    auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_select<false>) + dst_bytes + src_bytes));
     auto buf_cur = buf + __aligned_sizeof(instr_select<false>);
     auto dst = (block_type*)buf_cur;
     map[node->id()] = dst;
@@ -770,9 +805,9 @@ instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map)
     }
 
     if (is_scalar) {
-      return new (buf) instr_select<true>(dst, dst_size, srcs, num_srcs);
+      return bind(new (buf) instr_select<true>(dst, dst_size, srcs, num_srcs));
     } else {
-      return new (buf) instr_select<false>(dst, dst_size, srcs, num_srcs);
+      return bind(new (buf) instr_select<false>(dst, dst_size, srcs, num_srcs));
     }
   }
 }
@@ -782,20 +817,24 @@ instr_select_base* instr_select_base::create(selectimpl* node, data_map_t& map)
 class instr_cd : public instr_base {
 public:
 
-  static instr_cd* create(cdimpl* node, data_map_t& map) {
-    return new instr_cd(node, map);
+  static instr_cd* create(cdimpl* node, data_map_t& map, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_cd))) instr_cd(node, map));
   }
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     auto clk = static_cast<bool>(clk_[0]);
     dst_ = (clk ^ prev_clk_) && (clk ^ neg_edge_);
     prev_clk_ = clk;
   }
 
+  void save_state(sdata_type& state) const override {
+    state = sdata_type(1, prev_clk_ ? 1 : 0);
+  }
+
+  void load_state(const sdata_type& state) override {
+    prev_clk_ = static_cast<bool>(state.word(0) & 0x1);
+  }
+
 private:
 
   instr_cd(cdimpl* node, data_map_t& map)
@@ -817,7 +856,16 @@ private:
 class instr_reg_base : public instr_base {
 public:
 
-  static instr_reg_base* create(regimpl* node, data_map_t& map);
+  static instr_reg_base* create(regimpl* node, data_map_t& map, instr_arena& arena);
+
+  void save_state(sdata_type& state) const override {
+    state = sdata_type(size_);
+    bv_copy(state.words(), dst_, size_);
+  }
+
+  void load_state(const sdata_type& state) override {
+    bv_copy(dst_, state.words(), size_);
+  }
 
   void init(regimpl* node, data_map_t& map) {
     cd_       = map.at(node->cd().id());
@@ -852,12 +900,7 @@ template <bool is_scalar, bool has_init, bool has_enable>
 class instr_reg : public instr_reg_base {
 public:
 
-  void destroy() override {
-    this->~instr_reg();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if (!static_cast<bool>(cd_[0]))
       return;
 
@@ -905,12 +948,7 @@ template <bool is_scalar, bool has_init, bool has_enable>
 class instr_pipe : public instr_reg_base {
 public:
 
-  void destroy() override {
-    this->~instr_pipe();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if (!static_cast<bool>(cd_[0]))
       return;
 
@@ -955,6 +993,28 @@ public:
     }
   }
 
+  void save_state(sdata_type& state) const override {
+    // stages are saved in pop order after the register value
+    state = sdata_type(size_ + pipe_size_);
+    bv_copy(state.words(), dst_, size_);
+    uint32_t n = pipe_size_ / size_;
+    for (uint32_t k = 0; k < n; ++k) {
+      auto i = is_scalar ? k : ((idx_ / size_) + n - k) % n;
+      bv_copy(state.words(), (k + 1) * size_, pipe_, i * size_, size_);
+    }
+  }
+
+  void load_state(const sdata_type& state) override {
+    // the stages follow the value in the same words
+    bv_copy(dst_, 0, state.words(), 0, size_);
+    uint32_t n = pipe_size_ / size_;
+    for (uint32_t k = 0; k < n; ++k) {
+      auto i = is_scalar ? k : (n - 1 - k);
+      bv_copy(pipe_, i * size_, state.words(), (k + 1) * size_, size_);
+    }
+    idx_ = pipe_size_ - size_;
+  }
+
 protected:
 
   instr_pipe(block_type* dst, uint32_t size, block_type* pipe, uint32_t pipe_size)
@@ -971,7 +1031,7 @@ protected:
   friend class instr_reg_base;
 };
 
-instr_reg_base* instr_reg_base::create(regimpl* node, data_map_t& map) {
+instr_reg_base* instr_reg_base::create(regimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size  = node->size();
   uint32_t nblocks   = ceildiv(dst_size, bitwidth_v<block_type>);
   uint32_t dst_bytes = sizeof(block_type) * nblocks;
@@ -984,10 +1044,10 @@ instr_reg_base* instr_reg_base::create(regimpl* node, data_map_t& map) {
     is_scalar &= (pipe_size <= bitwidth_v<block_type>);
 
     uint32_t pipe_bytes = sizeof(block_type) * ceildiv(pipe_size, bitwidth_v<block_type>);
-    buf = new uint8_t[__aligned_sizeof(instr_pipe<false, false, false>) + dst_bytes + pipe_bytes]();
+    buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_pipe<false, false, false>) + dst_bytes + pipe_bytes));
     buf_cur = buf + __aligned_sizeof(instr_pipe<false, false, false>);
   } else {
-    buf = new uint8_t[__aligned_sizeof(instr_reg<false, false, false>) + dst_bytes]();
+    buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_reg<false, false, false>) + dst_bytes));
     buf_cur = buf + __aligned_sizeof(instr_reg<false, false, false>);
   }
 
@@ -1003,29 +1063,29 @@ instr_reg_base* instr_reg_base::create(regimpl* node, data_map_t& map) {
     if (is_scalar) {
       if (node->has_init_data()) {
         if (node->has_enable()) {
-          return new (buf) instr_reg<true, true, true>(dst, dst_size);
+          return bind(new (buf) instr_reg<true, true, true>(dst, dst_size));
         } else {
-          return new (buf) instr_reg<true, true, false>(dst, dst_size);
+          return bind(new (buf) instr_reg<true, true, false>(dst, dst_size));
         }
       } else {
         if (node->has_enable()) {
-          return new (buf) instr_reg<true, false, true>(dst, dst_size);
+          return bind(new (buf) instr_reg<true, false, true>(dst, dst_size));
         } else {
-          return new (buf) instr_reg<true, false, false>(dst, dst_size);
+          return bind(new (buf) instr_reg<true, false, false>(dst, dst_size));
         }
       }
     } else {
       if (node->has_init_data()) {
         if (node->has_enable()) {
-          return new (buf) instr_reg<false, true, true>(dst, dst_size);
+          return bind(new (buf) instr_reg<false, true, true>(dst, dst_size));
         } else {
-          return new (buf) instr_reg<false, true, false>(dst, dst_size);
+          return bind(new (buf) instr_reg<false, true, false>(dst, dst_size));
         }
       } else {
         if (node->has_enable()) {
-          return new (buf) instr_reg<false, false, true>(dst, dst_size);
+          return bind(new (buf) instr_reg<false, false, true>(dst, dst_size));
         } else {
-          return new (buf) instr_reg<false, false, false>(dst, dst_size);
+          return bind(new (buf) instr_reg<false, false, false>(dst, dst_size));
         }
       }
     }
@@ -1033,29 +1093,29 @@ instr_reg_base* instr_reg_base::create(regimpl* node, data_map_t& map) {
     if (is_scalar) {
       if (node->has_init_data()) {
         if (node->has_enable()) {
-          return new (buf) instr_pipe<true, true, true>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<true, true, true>(dst, dst_size, pipe, pipe_size));
         } else {
-          return new (buf) instr_pipe<true, true, false>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<true, true, false>(dst, dst_size, pipe, pipe_size));
         }
       } else {
         if (node->has_enable()) {
-          return new (buf) instr_pipe<true, false, true>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<true, false, true>(dst, dst_size, pipe, pipe_size));
         } else {
-          return new (buf) instr_pipe<true, false, false>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<true, false, false>(dst, dst_size, pipe, pipe_size));
         }
       }
     } else {
       if (node->has_init_data()) {
         if (node->has_enable()) {
-          return new (buf) instr_pipe<false, true, true>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<false, true, true>(dst, dst_size, pipe, pipe_size));
         } else {
-          return new (buf) instr_pipe<false, true, false>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<false, true, false>(dst, dst_size, pipe, pipe_size));
         }
       } else {
         if (node->has_enable()) {
-          return new (buf) instr_pipe<false, false, true>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<false, false, true>(dst, dst_size, pipe, pipe_size));
         } else {
-          return new (buf) instr_pipe<false, false, false>(dst, dst_size, pipe, pipe_size);
+          return bind(new (buf) instr_pipe<false, false, false>(dst, dst_size, pipe, pipe_size));
         }
       }
     }
@@ -1115,7 +1175,7 @@ protected:
 class instr_marport_base : public instr_mport_base {
 public:
 
-  static instr_marport_base* create(marportimpl* node, data_map_t& map) ;
+  static instr_marport_base* create(marportimpl* node, data_map_t& map, instr_arena& arena) ;
 
 protected:
 
@@ -1131,12 +1191,7 @@ template <bool is_scalar>
 class instr_marport : public instr_marport_base {
 public:
 
-  void destroy() override {
-    this->~instr_marport();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     auto addr = bv_cast<uint32_t>(addr_, addr_size_);
     auto src_offset = addr * data_size_;
     auto src_idx = src_offset / bitwidth_v<block_type>;
@@ -1157,12 +1212,12 @@ private:
   friend class instr_marport_base;
 };
 
-instr_marport_base* instr_marport_base::create(marportimpl* node, data_map_t& map) {
+instr_marport_base* instr_marport_base::create(marportimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size  = node->size();
   uint32_t nblocks   = ceildiv(dst_size, bitwidth_v<block_type>);
   uint32_t dst_bytes = sizeof(block_type) * nblocks;
 
-  auto buf = new uint8_t[__aligned_sizeof(instr_marport_base) + dst_bytes]();
+  auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_marport_base) + dst_bytes));
   auto buf_cur = buf + __aligned_sizeof(instr_marport_base);
   auto dst = (block_type*)buf_cur;
   map[node->id()] = dst;
@@ -1171,9 +1226,9 @@ instr_marport_base* instr_marport_base::create(marportimpl* node, data_map_t& ma
   instr_marport_base* instr;
   bool is_scalar = (dst_size <= bitwidth_v<block_type>);
   if (is_scalar) {
-    instr = new (buf) instr_marport<true>(dst, dst_size);
+    instr = bind(new (buf) instr_marport<true>(dst, dst_size));
   } else {
-    instr = new (buf) instr_marport<false>(dst, dst_size);
+    instr = bind(new (buf) instr_marport<false>(dst, dst_size));
   }
   instr->init(node, map);
   return instr;
@@ -1184,7 +1239,7 @@ instr_marport_base* instr_marport_base::create(marportimpl* node, data_map_t& ma
 class instr_msrport_base : public instr_mport_base {
 public:
 
-  static instr_msrport_base* create(msrportimpl* node, data_map_t& map) ;
+  static instr_msrport_base* create(msrportimpl* node, data_map_t& map, instr_arena& arena) ;
 
   void init(msrportimpl* node, data_map_t& map) {
     instr_mport_base::init(node, map);
@@ -1203,6 +1258,15 @@ protected:
     , enable_(nullptr)
   {}
 
+  void save_state(sdata_type& state) const override {
+    state = sdata_type(data_size_);
+    bv_copy(state.words(), dst_, data_size_);
+  }
+
+  void load_state(const sdata_type& state) override {
+    bv_copy(dst_, state.words(), data_size_);
+  }
+
   block_type* dst_;
   const block_type* cd_;
   const block_type* enable_;
@@ -1212,12 +1276,7 @@ template <bool is_scalar>
 class instr_msrport : public instr_msrport_base {
 public:
 
-  void destroy() override {
-    this->~instr_msrport();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if (!static_cast<bool>(cd_[0])
      || (enable_ && !static_cast<bool>(enable_[0])))
       return;
@@ -1241,12 +1300,12 @@ private:
   friend class instr_msrport_base;
 };
 
-instr_msrport_base* instr_msrport_base::create(msrportimpl* node, data_map_t& map) {
+instr_msrport_base* instr_msrport_base::create(msrportimpl* node, data_map_t& map, instr_arena& arena) {
   uint32_t dst_size  = node->size();
   uint32_t nblocks   = ceildiv(dst_size, bitwidth_v<block_type>);
   uint32_t dst_bytes = sizeof(block_type) * nblocks;
 
-  auto buf = new uint8_t[__aligned_sizeof(instr_msrport_base) + dst_bytes]();
+  auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_msrport_base) + dst_bytes));
   auto buf_cur = buf + __aligned_sizeof(instr_msrport_base);
   auto dst = (block_type*)buf_cur;
   map[node->id()] = dst;
@@ -1254,9 +1313,9 @@ instr_msrport_base* instr_msrport_base::create(msrportimpl* node, data_map_t& ma
 
   bool is_scalar = (dst_size <= bitwidth_v<block_type>);
   if (is_scalar) {
-    return new (buf) instr_msrport<true>(dst, dst_size);
+    return bind(new (buf) instr_msrport<true>(dst, dst_size));
   } else {
-    return new (buf) instr_msrport<false>(dst, dst_size);
+    return bind(new (buf) instr_msrport<false>(dst, dst_size));
   }
 }
 
@@ -1265,7 +1324,7 @@ instr_msrport_base* instr_msrport_base::create(msrportimpl* node, data_map_t& ma
 class instr_mwport_base : public instr_mport_base {
 public:
 
-  static instr_mwport_base* create(mwportimpl* node, data_map_t& map) ;
+  static instr_mwport_base* create(mwportimpl* node, data_map_t& map, instr_arena& arena) ;
 
 protected:
 
@@ -1296,12 +1355,7 @@ template <bool is_scalar>
 class instr_mwport : public instr_mwport_base {
 public:
 
-  void destroy() override {
-    this->~instr_mwport();
-    ::operator delete [](this);
-  }
-
-  void eval() override {
+  void eval() {
     if (!static_cast<bool>(cd_[0])
      || (enable_ && bv_is_zero(enable_, enable_size_)))
       return;
@@ -1358,15 +1412,15 @@ private:
   friend class instr_mwport_base;
 };
 
-instr_mwport_base* instr_mwport_base::create(mwportimpl* node, data_map_t& map) {
-  auto buf = new uint8_t[__aligned_sizeof(instr_mwport_base)]();
+instr_mwport_base* instr_mwport_base::create(mwportimpl* node, data_map_t& map, instr_arena& arena) {
+  auto buf = reinterpret_cast<uint8_t*>(arena.alloc(__aligned_sizeof(instr_mwport_base)));
   auto data_size = node->mem()->data_width();
   auto is_scalar = (data_size <= bitwidth_v<block_type>);
   instr_mwport_base* instr;
   if (is_scalar) {
-    instr = new (buf) instr_mwport<true>(data_size);
+    instr = bind(new (buf) instr_mwport<true>(data_size));
   } else {
-    instr = new (buf) instr_mwport<false>(data_size);
+    instr = bind(new (buf) instr_mwport<false>(data_size));
   }
   instr->init(node, map);
   return instr;
@@ -1377,16 +1431,21 @@ instr_mwport_base* instr_mwport_base::create(mwportimpl* node, data_map_t& map)
 class instr_time : public instr_base {
 public:
 
-  static instr_time* create(timeimpl* node, data_map_t& map) {
-    return new instr_time(node, map);
+  static instr_time* create(timeimpl* node, data_map_t& map, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_time))) instr_time(node, map));
+  }
+
+  void eval() {
+    dst_ = ++tick_;
   }
 
-  void destroy() override {
-    delete this;
+  void save_state(sdata_type& state) const override {
+    state = dst_;
   }
 
-  void eval() override {
-    dst_ = ++tick_;
+  void load_state(const sdata_type& state) override {
+    bv_copy(dst_.words(), state.words(), dst_.size());
+    tick_ = static_cast<ch_tick>(dst_);
   }
 
 private:
@@ -1406,15 +1465,11 @@ private:
 class instr_assert : public instr_base {
 public:
 
-  static instr_assert* create(assertimpl* node, data_map_t& map) {
-    return new instr_assert(node, map);
+  static instr_assert* create(assertimpl* node, data_map_t& map, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_assert))) instr_assert(node, map));
   }
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     if ((pred_ && !static_cast<bool>(pred_[0]))
       || static_cast<bool>(cond_[0]))
       return;
@@ -1447,15 +1502,11 @@ private:
 class instr_print : public instr_base {
 public:
 
-  static instr_print* create(printimpl* node, data_map_t& map) {
-    return new instr_print(node, map);
+  static instr_print* create(printimpl* node, data_map_t& map, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_print))) instr_print(node, map));
   }
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     if (pred_ && !static_cast<bool>(pred_[0]))
       return;
     auto str = to_string(format_.c_str(), srcs_.data(), enum_strings_.data());
@@ -1492,15 +1543,11 @@ private:
 class instr_udfc : public instr_base {
 public:
 
-  static instr_udfc* create(udfcimpl* node) {
-    return new instr_udfc(node);
-  }
-
-  void destroy() override {
-    delete this;
+  static instr_udfc* create(udfcimpl* node, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_udfc))) instr_udfc(node));
   }
 
-  void eval() override {
+  void eval() {
     udf_->eval();
   }
 
@@ -1520,8 +1567,8 @@ private:
 class instr_udfs : public instr_base {
 public:
 
-  static instr_udfs* create(udfsimpl* node) {
-    return new instr_udfs(node);
+  static instr_udfs* create(udfsimpl* node, instr_arena& arena) {
+    return bind(new (arena.alloc(sizeof(instr_udfs))) instr_udfs(node));
   }
 
   void init(udfsimpl* node, data_map_t& map) {
@@ -1529,11 +1576,7 @@ public:
     reset_ = map.at(node->reset().id());
   }
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     if (!static_cast<bool>(cd_[0]))
       return;
     if (static_cast<bool>(reset_[0])) {
@@ -1563,7 +1606,7 @@ private:
 class instr_udfin_base : public instr_base {
 public:
 
-  static instr_udfin_base* create(udfportimpl* node, data_map_t& map);
+  static instr_udfin_base* create(udfportimpl* node, data_map_t& map, instr_arena& arena);
 
 protected:
 
@@ -1582,11 +1625,7 @@ template <bool is_scalar>
 class instr_udfin : public instr_udfin_base {
 public:
 
-  void destroy() override {
-    delete this;
-  }
-
-  void eval() override {
+  void eval() {
     if constexpr (is_scalar) {
       bv_copy_scalar(dst_, src_);
     } else {
@@ -1603,14 +1642,14 @@ private:
   friend class instr_udfin_base;
 };
 
-instr_udfin_base* instr_udfin_base::create(udfportimpl* node, data_map_t& map) {
+instr_udfin_base* instr_udfin_base::create(udfportimpl* node, data_map_t& map, instr_arena& arena) {
   auto dst  = node->value()->words();
   auto src  = map.at(node->src(0).id());
   auto size = node->size();
   if (size <= bitwidth_v<block_type>) {
-    return new instr_udfin<true>(dst, src, size);
+    return bind(new (arena.alloc(sizeof(instr_udfin<true>))) instr_udfin<true>(dst, src, size));
   } else {
-    return new instr_udfin<false>(dst, src, size);
+    return bind(new (arena.alloc(sizeof(instr_udfin<false>))) instr_udfin<false>(dst, src, size));
   }
 }
 
@@ -1620,8 +1659,9 @@ struct sim_ctx_t {
   sim_ctx_t() {}
 
   ~sim_ctx_t() {
+    // the arena releases the memory
     for (auto instr : instrs) {
-      instr->destroy();
+      instr->~instr_base();
     }
     for (auto constant : constants) {
       free(constant.first);
@@ -1629,17 +1669,30 @@ struct sim_ctx_t {
   }
 
   std::vector<std::pair<block_type*, uint32_t>> constants;
+  instr_arena arena;
   std::vector<instr_base*> instrs;
+  std::vector<instr_code_t> code;
+  std::unordered_map<uint32_t, instr_base*> snodes;
+  std::unordered_map<uint32_t, std::pair<block_type*, uint32_t>> mems;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
 class Compiler {
 public:
-  Compiler(sim_ctx_t* ctx) : sim_ctx_(ctx) {}
+  Compiler(sim_ctx_t* ctx, const sim_lanes& lanes, uint32_t lane)
+    : sim_ctx_(ctx)
+    , lanes_(lanes)
+    , lane_(lane)
+  {}
 
   ~Compiler() {}
 
+  // nodes of the generated instructions in evaluation order
+  const auto& instr_nodes() const {
+    return instr_nodes_;
+  }
+
   void build(const std::vector<lnodeimpl*>& eval_list) {
     data_map_t data_map;
     instr_map_t instr_map;
@@ -1655,20 +1708,20 @@ public:
 
     auto sys_time = ctx->sys_time();
     if (sys_time) {
-      instr_map[sys_time->id()] = instr_time::create(reinterpret_cast<timeimpl*>(sys_time), data_map);
+      instr_map[sys_time->id()] = instr_time::create(reinterpret_cast<timeimpl*>(sys_time), data_map, sim_ctx_->arena);
     }
 
     // lower synchronous nodes
     for (auto node : ctx->snodes()) {
       switch (node->type()) {
       case type_reg:
-        instr_map[node->id()] = instr_reg_base::create(reinterpret_cast<regimpl*>(node), data_map);
+        instr_map[node->id()] = instr_reg_base::create(reinterpret_cast<regimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_msrport:
-        instr_map[node->id()] = instr_msrport_base::create(reinterpret_cast<msrportimpl*>(node), data_map);
+        instr_map[node->id()] = instr_msrport_base::create(reinterpret_cast<msrportimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_udfs:
-        instr_map[node->id()] = instr_udfs::create(reinterpret_cast<udfsimpl*>(node));
+        instr_map[node->id()] = instr_udfs::create(reinterpret_cast<udfsimpl*>(node), sim_ctx_->arena);
         break;
       default:
         break;
@@ -1682,54 +1735,55 @@ public:
       default:
         assert(false);
       case type_proxy:
-        instr = instr_proxy_base::create(reinterpret_cast<proxyimpl*>(node), data_map);
+        instr = instr_proxy_base::create(reinterpret_cast<proxyimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_input: {
         auto input = reinterpret_cast<inputimpl*>(node);
-        data_map[node->id()] = input->value()->words();
+        data_map[node->id()] = this->port_data(input);
       } break;
       case type_output: {
         auto output = reinterpret_cast<outputimpl*>(node);
         data_map[node->id()] = data_map.at(output->src(0).id());
-        instr = instr_output_base::create(output, data_map);
+        instr = instr_output_base::create(output, this->port_data(output), data_map, sim_ctx_->arena);
       } break;
       case type_op:
-        instr = instr_op_base::create(reinterpret_cast<opimpl*>(node), data_map);
+        instr = instr_op_base::create(reinterpret_cast<opimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_sel:
-        instr = instr_select_base::create(reinterpret_cast<selectimpl*>(node), data_map);
+        instr = instr_select_base::create(reinterpret_cast<selectimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_cd:
-        instr = instr_cd::create(reinterpret_cast<cdimpl*>(node), data_map);
+        instr = instr_cd::create(reinterpret_cast<cdimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_reg:
         instr = instr_map.at(node->id());
         reinterpret_cast<instr_reg_base*>(instr)->init(reinterpret_cast<regimpl*>(node), data_map);
         break;
       case type_marport:
-        instr = instr_marport_base::create(reinterpret_cast<marportimpl*>(node), data_map);
+        instr = instr_marport_base::create(reinterpret_cast<marportimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_msrport:
         instr = instr_map.at(node->id());
         reinterpret_cast<instr_msrport_base*>(instr)->init(reinterpret_cast<msrportimpl*>(node), data_map);
         break;        
       case type_mwport:
-        instr = instr_mwport_base::create(reinterpret_cast<mwportimpl*>(node), data_map);
-        break;
-      case type_tap:
-        instr = instr_output_base::create(reinterpret_cast<tapimpl*>(node), data_map);
+        instr = instr_mwport_base::create(reinterpret_cast<mwportimpl*>(node), data_map, sim_ctx_->arena);
         break;
+      case type_tap: {
+        auto tap = reinterpret_cast<tapimpl*>(node);
+        instr = instr_output_base::create(tap, this->port_data(tap), data_map, sim_ctx_->arena);
+      } break;
       case type_time:
         instr = instr_map.at(node->id());
         break;
       case type_assert:
-        instr = instr_assert::create(reinterpret_cast<assertimpl*>(node), data_map);
+        instr = instr_assert::create(reinterpret_cast<assertimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_print:
-        instr = instr_print::create(reinterpret_cast<printimpl*>(node), data_map);
+        instr = instr_print::create(reinterpret_cast<printimpl*>(node), data_map, sim_ctx_->arena);
         break;
       case type_udfc:
-        instr = instr_udfc::create(reinterpret_cast<udfcimpl*>(node));
+        instr = instr_udfc::create(reinterpret_cast<udfcimpl*>(node), sim_ctx_->arena);
         break;
       case type_udfs:
         instr = instr_map.at(node->id());
@@ -1738,7 +1792,7 @@ public:
       case type_udfin: {
         auto udfin = reinterpret_cast<udfportimpl*>(node);
         data_map[node->id()] = data_map.at(udfin->src(0).id());
-        instr = instr_udfin_base::create(udfin, data_map);
+        instr = instr_udfin_base::create(udfin, data_map, sim_ctx_->arena);
       } break;
       case type_udfout: {
         auto udfout = reinterpret_cast<udfportimpl*>(node);
@@ -1753,12 +1807,43 @@ public:
         instr_map[node->id()] = instr;
         node_map[sim_ctx_->instrs.size()] = node->id();
         sim_ctx_->instrs.emplace_back(instr);
+        instr_nodes_.push_back(node);
+      }
+    }
+
+    // flatten the instructions into threaded code
+    sim_ctx_->code.reserve(sim_ctx_->instrs.size());
+    for (auto instr : sim_ctx_->instrs) {
+      sim_ctx_->code.push_back({instr->eval_fn(), instr});
+    }
+
+    // register sequential state
+    for (auto node : eval_list) {
+      switch (node->type()) {
+      case type_cd:
+      case type_reg:
+      case type_msrport:
+      case type_time:
+        sim_ctx_->snodes[node->id()] = instr_map.at(node->id());
+        break;
+      default:
+        break;
+      }
+    }
+    for (auto node : ctx->mems()) {
+      auto it = data_map.find(node->id());
+      if (it != data_map.end()) {
+        sim_ctx_->mems[node->id()] = {const_cast<block_type*>(it->second), node->size()};
       }
     }
   }
 
 private:
 
+  block_type* port_data(ioportimpl* node) const {
+    return lanes_.port(lane_, node)->words();
+  }
+
   void setup_constants(context* ctx, data_map_t& data_map) {
     for (auto node : ctx->literals())  {
       auto lit = reinterpret_cast<litimpl*>(node);
@@ -1799,27 +1884,303 @@ private:
   }
 
   sim_ctx_t* sim_ctx_;
+  const sim_lanes& lanes_;
+  uint32_t lane_;
+  std::vector<lnodeimpl*> instr_nodes_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
-driver::driver() {
-  sim_ctx_ = new sim_ctx_t();
+struct sim_sched_t {
+  struct phase_t {
+    std::vector<std::vector<uint32_t>> threads; // instructions of each thread
+    std::vector<uint32_t> serial;               // order sensitive instructions
+    uint64_t cost;                              // cost of the slowest thread
+  };
+
+  std::vector<phase_t> phases;
+  std::vector<uint64_t> loads;
+  uint32_t num_clusters;
+};
+
+static void build_schedule(sim_sched_t* sched,
+                           const std::vector<lnodeimpl*>& instr_nodes,
+                           uint32_t num_threads) {
+  uint32_t num_instrs = instr_nodes.size();
+
+  // split the instructions into phases at register boundaries, the eval list
+  // computes the next state, updates the registers, then computes outputs.
+  std::vector<uint32_t> phases(num_instrs);
+  uint32_t num_phases = 1;
+  for (uint32_t i = 0; i < num_instrs; ++i) {
+    if (i != 0
+     && is_snode_type(instr_nodes[i]->type()) != is_snode_type(instr_nodes[i-1]->type())) {
+      ++num_phases;
+    }
+    phases[i] = num_phases - 1;
+  }
+
+  // cluster the instructions connected within a phase
+  std::vector<uint32_t> parents(num_instrs);
+  std::iota(parents.begin(), parents.end(), 0);
+  auto find = [&](uint32_t i) {
+    while (parents[i] != i) {
+      parents[i] = parents[parents[i]];
+      i = parents[i];
+    }
+    return i;
+  };
+  auto unite = [&](uint32_t a, uint32_t b) {
+    if (phases[a] == phases[b]) {
+      parents[find(a)] = find(b);
+    }
+  };
+
+  // readers and writers of a node must stay ordered, including registers
+  // that are read before their update within the same phase.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> node_instrs;
+  for (uint32_t i = 0; i < num_instrs; ++i) {
+    node_instrs[instr_nodes[i]->id()].push_back(i);
+  }
+
+  std::vector<bool> serial(num_instrs, false);
+  std::unordered_map<uint32_t, uint32_t> mem_instrs;
+  for (uint32_t i = 0; i < num_instrs; ++i) {
+    auto node = instr_nodes[i];
+    switch (node->type()) {
+    case type_time:
+    case type_assert:
+    case type_print:
+      serial[i] = true;
+      break;
+    case type_marport:
+    case type_msrport:
+    case type_mwport: {
+      // ports of the same memory share its storage
+      auto mem = reinterpret_cast<memportimpl*>(node)->mem();
+      auto it = mem_instrs.find(mem->id());
+      if (it != mem_instrs.end()) {
+        unite(i, it->second);
+      }
+      mem_instrs[mem->id()] = i;
+    } [[fallthrough]];
+    default:
+      for (auto& src : node->srcs()) {
+        auto it = node_instrs.find(src.id());
+        if (it != node_instrs.end()) {
+          for (auto j : it->second) {
+            unite(i, j);
+          }
+        }
+      }
+      break;
+    }
+  }
+
+  // assign the largest clusters first to the least loaded thread
+  std::unordered_map<uint32_t, uint64_t> cluster_costs;
+  for (uint32_t i = 0; i < num_instrs; ++i) {
+    if (serial[i])
+      continue;
+    auto cost = 1 + ceildiv(instr_nodes[i]->size(), bitwidth_v<block_type>);
+    cluster_costs[find(i)] += cost;
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t>> clusters;
+  for (auto& cluster : cluster_costs) {
+    clusters.emplace_back(cluster.second, cluster.first);
+  }
+  std::sort(clusters.begin(), clusters.end(), std::greater<>());
+
+  sched->phases.resize(num_phases);
+  sched->loads.assign(num_threads, 0);
+  sched->num_clusters = clusters.size();
+
+  std::vector<std::vector<uint64_t>> phase_loads(num_phases, std::vector<uint64_t>(num_threads, 0));
+  std::unordered_map<uint32_t, uint32_t> cluster_threads;
+  for (auto& cluster : clusters) {
+    auto& loads = phase_loads[phases[cluster.second]];
+    auto tid = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    loads[tid] += cluster.first;
+    sched->loads[tid] += cluster.first;
+    cluster_threads[cluster.second] = tid;
+  }
+
+  for (uint32_t p = 0; p < num_phases; ++p) {
+    auto& phase = sched->phases[p];
+    phase.threads.resize(num_threads);
+    phase.cost = *std::max_element(phase_loads[p].begin(), phase_loads[p].end());
+  }
+
+  for (uint32_t i = 0; i < num_instrs; ++i) {
+    auto& phase = sched->phases[phases[i]];
+    if (serial[i]) {
+      phase.serial.push_back(i);
+    } else {
+      phase.threads[cluster_threads.at(find(i))].push_back(i);
+    }
+  }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+driver::driver(uint32_t num_threads)
+  : sched_(nullptr)
+  , pool_(nullptr)
+  , num_threads_(num_threads)
+{}
+
 driver::~driver() {
-  delete sim_ctx_;
+  delete pool_;
+  delete sched_;
+  for (auto sim_ctx : sim_ctxs_) {
+    delete sim_ctx;
+  }
+}
+
+void driver::initialize(const std::vector<lnodeimpl*>& eval_list,
+                        const sim_lanes& lanes) {
+  // each lane gets its own instruction stream bound to the lane's buffers
+  for (uint32_t i = 0, n = lanes.count(); i < n; ++i) {
+    auto sim_ctx = new sim_ctx_t();
+    sim_ctxs_.push_back(sim_ctx);
+    Compiler compiler(sim_ctx, lanes, i);
+    compiler.build(eval_list);
+    if (0 == i && num_threads_ > 1) {
+      // user-defined functions are not thread-safe
+      auto ctx = eval_list.back()->ctx();
+      if (!ctx->udfs().empty()) {
+        num_threads_ = 1;
+        continue;
+      }
+      // all lanes share the same schedule
+      sched_ = new sim_sched_t();
+      build_schedule(sched_, compiler.instr_nodes(), num_threads_);
+    }
+  }
+  if (sched_) {
+    pool_ = new worker_pool(num_threads_);
+  }
+}
+
+sim_driver* driver::fork(const std::vector<lnodeimpl*>& eval_list,
+                         const sim_lanes& lanes) const {
+  // instructions are bound to the lane buffers, build new streams
+  auto sim = new driver(num_threads_);
+  sim->initialize(eval_list, lanes);
+  sim_state state;
+  for (uint32_t i = 0, n = lanes.count(); i < n; ++i) {
+    state.clear();
+    this->save_state(i, state);
+    sim->load_state(i, state);
+  }
+  return sim;
+}
+
+void driver::save_state(uint32_t lane, sim_state& state) const {
+  auto sim_ctx = sim_ctxs_.at(lane);
+  for (auto& snode : sim_ctx->snodes) {
+    snode.second->save_state(state[snode.first]);
+  }
+  for (auto& mem : sim_ctx->mems) {
+    auto& data = state[mem.first];
+    data = sdata_type(mem.second.second);
+    bv_copy(data.words(), mem.second.first, mem.second.second);
+  }
 }
 
-void driver::initialize(const std::vector<lnodeimpl*>& eval_list) {
-  Compiler compiler(sim_ctx_);
-  compiler.build(eval_list);
+void driver::load_state(uint32_t lane, const sim_state& state) {
+  auto sim_ctx = sim_ctxs_.at(lane);
+  for (auto& snode : sim_ctx->snodes) {
+    auto it = state.find(snode.first);
+    if (it != state.end()) {
+      snode.second->load_state(it->second);
+    }
+  }
+  for (auto& mem : sim_ctx->mems) {
+    auto it = state.find(mem.first);
+    if (it != state.end()) {
+      bv_copy(mem.second.first, it->second.words(), mem.second.second);
+    }
+  }
 }
 
 void driver::eval() {
-  for (auto instr : sim_ctx_->instrs) {
-    instr->eval();
+  if (pool_) {
+    std::exception_ptr error;
+    pool_->run([&](uint32_t tid) {
+      try {
+        this->eval_thread(tid);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return;
+  }
+  for (auto sim_ctx : sim_ctxs_) {
+    for (auto& code : sim_ctx->code) {
+      code.fn(code.instr);
+    }
+  }
+}
+
+void driver::eval_thread(uint32_t tid) {
+  std::exception_ptr error;
+  for (auto& phase : sched_->phases) {
+    auto& instrs = phase.threads[tid];
+    for (auto sim_ctx : sim_ctxs_) {
+      for (auto i : instrs) {
+        auto& code = sim_ctx->code[i];
+        code.fn(code.instr);
+      }
+    }
+    pool_->barrier();
+    if (!phase.serial.empty()) {
+      if (0 == tid) {
+        // keep the other threads in step if an assertion fires
+        try {
+          for (auto sim_ctx : sim_ctxs_) {
+            for (auto i : phase.serial) {
+              auto& code = sim_ctx->code[i];
+              code.fn(code.instr);
+            }
+          }
+        } catch (...) {
+          error = std::current_exception();
+        }
+      }
+      pool_->barrier();
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
 }
 
+void driver::dump_stats(std::ostream& out) const {
+  out << "ch-stats: simulation threads = " << num_threads_ << std::endl;
+  if (nullptr == sched_)
+    return;
+  uint64_t total = 0;
+  uint64_t critical = 0;
+  for (auto load : sched_->loads) {
+    total += load;
+  }
+  for (auto& phase : sched_->phases) {
+    critical += phase.cost;
+  }
+  out << "ch-stats: partition phases = " << sched_->phases.size() << std::endl;
+  out << "ch-stats: partition clusters = " << sched_->num_clusters << std::endl;
+  for (uint32_t i = 0; i < num_threads_; ++i) {
+    auto load = sched_->loads[i];
+    out << "ch-stats: thread " << i << " load = " << load << " (" << (total ? ((load * 100) / total) : 0) << "%)" << std::endl;
+  }
+  // ratio of the ideal to the achieved per-cycle cost
+  auto balance = critical ? ((total * 100) / (critical * num_threads_)) : 100;
+  out << "ch-stats: partition balance = " << balance << "%" << std::endl;
+}
+
 }
@@ -5,21 +5,37 @@
 namespace ch::internal::simref {
 
 struct sim_ctx_t;
+struct sim_sched_t;
 
 class driver : public sim_driver {
 public:
 
-  driver();
+  explicit driver(uint32_t num_threads = 1);
 
   ~driver();
 
-  void initialize(const std::vector<lnodeimpl*>& eval_list) override;
+  void initialize(const std::vector<lnodeimpl*>& eval_list,
+                  const sim_lanes& lanes) override;
 
   void eval() override;
 
+  sim_driver* fork(const std::vector<lnodeimpl*>& eval_list,
+                   const sim_lanes& lanes) const override;
+
+  void save_state(uint32_t lane, sim_state& state) const override;
+
+  void load_state(uint32_t lane, const sim_state& state) override;
+
+  void dump_stats(std::ostream& out) const override;
+
 private:  
 
-  sim_ctx_t* sim_ctx_;
+  void eval_thread(uint32_t tid);
+
+  std::vector<sim_ctx_t*> sim_ctxs_;
+  sim_sched_t* sched_;
+  worker_pool* pool_;
+  uint32_t num_threads_;
 };
 
 }
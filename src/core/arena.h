@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.h"
+#include <cstddef>
+
+namespace ch {
+namespace internal {
+
+// bump allocator owned by a context for its nodes and their source arrays.
+// freed entries are recycled by size class, the blocks are only returned
+// to the system when the arena is destroyed.
+class node_arena {
+public:
+
+  static constexpr size_t ALIGNMENT  = alignof(std::max_align_t);
+  static constexpr size_t MAX_SIZE   = 1024;
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  node_arena()
+    : curr_(nullptr)
+    , end_(nullptr)
+    , used_bytes_(0)
+    , reserved_bytes_(0) {
+    for (auto& entry : free_lists_) {
+      entry = nullptr;
+    }
+  }
+
+  ~node_arena() {
+    for (auto block : blocks_) {
+      ::operator delete(block);
+    }
+  }
+
+  node_arena(const node_arena&) = delete;
+
+  node_arena& operator=(const node_arena&) = delete;
+
+  void* allocate(size_t size) {
+    size = align(size);
+    used_bytes_ += size;
+    if (size > MAX_SIZE) {
+      reserved_bytes_ += size;
+      return ::operator new(size);
+    }
+    auto& head = free_lists_[size / ALIGNMENT - 1];
+    if (head) {
+      auto entry = head;
+      head = entry->next;
+      return entry;
+    }
+    if (curr_ + size > end_) {
+      auto block = reinterpret_cast<char*>(::operator new(BLOCK_SIZE));
+      blocks_.push_back(block);
+      reserved_bytes_ += BLOCK_SIZE;
+      curr_ = block;
+      end_ = block + BLOCK_SIZE;
+    }
+    auto ptr = curr_;
+    curr_ += size;
+    return ptr;
+  }
+
+  void deallocate(void* ptr, size_t size) {
+    size = align(size);
+    assert(used_bytes_ >= size);
+    used_bytes_ -= size;
+    if (size > MAX_SIZE) {
+      reserved_bytes_ -= size;
+      ::operator delete(ptr);
+      return;
+    }
+    auto entry = reinterpret_cast<free_entry*>(ptr);
+    auto& head = free_lists_[size / ALIGNMENT - 1];
+    entry->next = head;
+    head = entry;
+  }
+
+  // bytes currently allocated
+  size_t used_bytes() const {
+    return used_bytes_;
+  }
+
+  // bytes obtained from the system
+  size_t reserved_bytes() const {
+    return reserved_bytes_;
+  }
+
+private:
+
+  struct free_entry {
+    free_entry* next;
+  };
+
+  static size_t align(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  std::vector<char*> blocks_;
+  char* curr_;
+  char* end_;
+  free_entry* free_lists_[MAX_SIZE / ALIGNMENT];
+  size_t used_bytes_;
+  size_t reserved_bytes_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// STL allocator drawing from a node arena, or from the heap if none is given
+template <typename T>
+class arena_allocator {
+public:
+
+  using value_type = T;
+
+  arena_allocator(node_arena* arena = nullptr) noexcept : arena_(arena) {}
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U>& other) noexcept : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    auto size = n * sizeof(T);
+    if (arena_)
+      return reinterpret_cast<T*>(arena_->allocate(size));
+    return reinterpret_cast<T*>(::operator new(size));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (arena_) {
+      arena_->deallocate(ptr, n * sizeof(T));
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+
+  node_arena* arena() const {
+    return arena_;
+  }
+
+  template <typename U>
+  bool operator==(const arena_allocator<U>& other) const {
+    return (arena_ == other.arena());
+  }
+
+  template <typename U>
+  bool operator!=(const arena_allocator<U>& other) const {
+    return (arena_ != other.arena());
+  }
+
+private:
+
+  node_arena* arena_;
+};
+
+}
+}
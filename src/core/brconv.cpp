@@ -311,8 +311,7 @@ branchconverter::emit(proxyimpl* dst,
     }
 
     // create select node
-    auto sel = ctx_->create_node<selectimpl>(
-                        range.length, branch->key, "", branch->sloc);
+    std::vector<lnodeimpl*> srcs;
     if (branch->key && (branch->key->size() <= 64)) {
       // insert switch cases in ascending order
       for (auto& value : values) {
@@ -321,33 +320,34 @@ branchconverter::emit(proxyimpl* dst,
           // the case predicate should be a literal value
           assert(!branch->key || type_lit == pred->type());
           auto ipred = static_cast<int64_t>(reinterpret_cast<litimpl*>(pred)->value());
-          uint32_t i = 1;
-          for (; i < sel->num_srcs(); i += 2) {
-            auto sel_ipred = static_cast<int64_t>(reinterpret_cast<litimpl*>(sel->src(i).impl())->value());
+          uint32_t i = 0;
+          for (; i < srcs.size(); i += 2) {
+            auto sel_ipred = static_cast<int64_t>(reinterpret_cast<litimpl*>(srcs[i])->value());
             CH_CHECK(sel_ipred != ipred, "duplicate switch case predicate");
             if (sel_ipred > ipred) {
-              sel->insert_src(i, value.second);
-              sel->insert_src(i, pred);
+              srcs.insert(srcs.begin() + i, {pred, value.second});
               break;
             }
           }
-          if (i == sel->num_srcs()) {
-            sel->add_src(pred);
-            sel->add_src(value.second);
+          if (i == srcs.size()) {
+            srcs.push_back(pred);
+            srcs.push_back(value.second);
           }
         } else {
-          sel->add_src(value.second);
+          srcs.push_back(value.second);
         }
       }
     } else {
       for (auto& value : values) {
         auto pred = value.first;
         if (pred) {
-          sel->add_src(pred);
+          srcs.push_back(pred);
         }
-        sel->add_src(value.second);
+        srcs.push_back(value.second);
       }
     }
+    auto sel = ctx_->create_select(
+                        range.length, branch->key, srcs, "", branch->sloc);
     // check sources
     for (auto& src : sel->srcs()) {
       if (src.empty()) {
@@ -133,7 +133,8 @@ context::context(const std::string& name, context* parent)
            &inputs_, &outputs_, &cdomains_, &modules_, &modports_,
            &udfseqs_, &udfcombs_, &udfports_, &gtaps_, &btaps_, &taps_, &literals_)
   , snodes_(&regs_, &msrports_, &mwports_, &udfseqs_)
-  , udfs_(&udfcombs_, &udfseqs_) {
+  , udfs_(&udfcombs_, &udfseqs_)
+  , hash_consing_(false) {
   branchconv_ = new branchconverter(this);
 }
 
@@ -173,6 +174,8 @@ void context::add_node(lnodeimpl* node) {
     assert(false);
   case type_lit:
     literals_.push_back(node);
+    literal_map_.emplace(literal_key(reinterpret_cast<litimpl*>(node)->value()),
+                         reinterpret_cast<litimpl*>(node));
     break;
   case type_proxy:
     proxies_.push_back(node);
@@ -250,6 +253,8 @@ void context::add_node(lnodeimpl* node) {
 
 void context::delete_node(lnodeimpl* node) {
   CH_DBG(3, "*** deleting node: %s%d(#%d)\n", to_string(node->type()), node->size(), node->id());
+  // nodes are only deleted once elaboration is complete
+  assert(!hash_consing_);
 
   // clear system node
   this->reset_system_node(node);
@@ -261,6 +266,7 @@ void context::delete_node(lnodeimpl* node) {
     assert(false);
   case type_lit:
     literals_.remove(node);
+    this->remove_literal(reinterpret_cast<litimpl*>(node));
     break;
   case type_proxy:
     proxies_.remove(node);
@@ -332,6 +338,11 @@ void context::delete_node(lnodeimpl* node) {
 node_list_view::iterator context::delete_node(const node_list_view::iterator& it) {
   auto node = *it;
   CH_DBG(3, "*** deleting node: %s%d(#%d)\n", to_string(node->type()), node->size(), node->id());
+  assert(!hash_consing_);
+
+  if (type_lit == node->type()) {
+    this->remove_literal(reinterpret_cast<litimpl*>(node));
+  }
 
   // clear system node
   this->reset_system_node(node);
@@ -407,8 +418,9 @@ outputimpl* context::get_output(const std::string& name) {
 
 litimpl* context::create_literal(const sdata_type& value) {
   // first lookup literals cache
-  for (auto node : literals_) {
-    auto lit = reinterpret_cast<litimpl*>(node);
+  auto range = literal_map_.equal_range(literal_key(value));
+  for (auto it = range.first; it != range.second; ++it) {
+    auto lit = it->second;
     if (lit->value() == value)
       return lit;
   }
@@ -416,6 +428,141 @@ litimpl* context::create_literal(const sdata_type& value) {
   return this->create_node<litimpl>(value);
 }
 
+void context::remove_literal(litimpl* node) {
+  auto range = literal_map_.equal_range(literal_key(node->value()));
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == node) {
+      literal_map_.erase(it);
+      break;
+    }
+  }
+}
+
+size_t context::literal_key(const sdata_type& value) {
+  size_t key = value.size();
+  for (uint32_t i = 0, n = value.num_words(); i < n; ++i) {
+    key = hash_combine(key, value.words()[i]);
+  }
+  return key;
+}
+
+void context::set_hash_consing(bool enable) {
+  hash_consing_ = enable;
+  if (!enable) {
+    node_map_.clear();
+    shared_nodes_.clear();
+  }
+}
+
+size_t context::node_key(uint32_t type,
+                         uint32_t size,
+                         const std::vector<lnodeimpl*>& srcs,
+                         size_t extra) {
+  // shallow key, source nodes are identified by id
+  size_t key = hash_combine(type, size);
+  for (auto src : srcs) {
+    key = hash_combine(key, src->id());
+  }
+  return hash_combine(key, extra);
+}
+
+lnodeimpl* context::find_node(size_t key,
+                              const std::vector<lnodeimpl*>& srcs,
+                              const std::function<bool(const lnodeimpl*)>& match) const {
+  auto range = node_map_.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto other = it->second;
+    if (other->num_srcs() != srcs.size())
+      continue;
+    bool same_srcs = true;
+    for (uint32_t i = 0, n = srcs.size(); i < n; ++i) {
+      if (other->src(i).id() != srcs[i]->id()) {
+        same_srcs = false;
+        break;
+      }
+    }
+    if (same_srcs && match(other))
+      return other;
+  }
+  return nullptr;
+}
+
+opimpl* context::create_op(ch_op op,
+                           uint32_t size,
+                           bool is_signed,
+                           lnodeimpl* lhs,
+                           lnodeimpl* rhs,
+                           const std::string& name,
+                           const source_location& sloc) {
+  // nodes defined inside conditional blocks are not shared
+  bool shared = hash_consing_ && !branchconv_->enabled() && lhs;
+  if (!shared) {
+    if (rhs)
+      return this->create_node<opimpl>(op, size, is_signed, lhs, rhs, name, sloc);
+    return this->create_node<opimpl>(op, size, is_signed, lhs, name, sloc);
+  }
+
+  std::vector<lnodeimpl*> srcs{lhs};
+  if (rhs) {
+    srcs.push_back(rhs);
+  }
+  is_signed = opimpl::is_signed_opd(op, size, is_signed, lhs, rhs);
+  auto key = node_key(type_op, size, srcs, static_cast<size_t>(op));
+  auto other = this->find_node(key, srcs, [&](const lnodeimpl* node) {
+    auto _node = reinterpret_cast<const opimpl*>(node);
+    return type_op == node->type()
+        && size == node->size()
+        && op == _node->op()
+        && is_signed == _node->is_signed();
+  });
+  if (other) {
+    shared_nodes_.insert(other->id());
+    return reinterpret_cast<opimpl*>(other);
+  }
+
+  opimpl* node;
+  if (rhs) {
+    node = this->create_node<opimpl>(op, size, is_signed, lhs, rhs, name, sloc);
+  } else {
+    node = this->create_node<opimpl>(op, size, is_signed, lhs, name, sloc);
+  }
+  node_map_.emplace(key, node);
+  return node;
+}
+
+selectimpl* context::create_select(uint32_t size,
+                                   lnodeimpl* key,
+                                   const std::vector<lnodeimpl*>& srcs,
+                                   const std::string& name,
+                                   const source_location& sloc) {
+  // nodes defined inside conditional blocks are not shared
+  bool shared = hash_consing_ && !branchconv_->enabled()
+             && std::none_of(srcs.begin(), srcs.end(), [](lnodeimpl* src) { return nullptr == src; });
+  if (!shared)
+    return this->create_node<selectimpl>(size, key, srcs, name, sloc);
+
+  std::vector<lnodeimpl*> all_srcs;
+  if (key) {
+    all_srcs.push_back(key);
+  }
+  all_srcs.insert(all_srcs.end(), srcs.begin(), srcs.end());
+  bool has_key = (key != nullptr);
+  auto hash = node_key(type_sel, size, all_srcs, has_key);
+  auto other = this->find_node(hash, all_srcs, [&](const lnodeimpl* node) {
+    return type_sel == node->type()
+        && size == node->size()
+        && has_key == reinterpret_cast<const selectimpl*>(node)->has_key();
+  });
+  if (other) {
+    shared_nodes_.insert(other->id());
+    return reinterpret_cast<selectimpl*>(other);
+  }
+
+  auto node = this->create_node<selectimpl>(size, key, srcs, name, sloc);
+  node_map_.emplace(hash, node);
+  return node;
+}
+
 timeimpl* context::create_time(const source_location& sloc) {
   if (nullptr == sys_time_) {
     sys_time_ = this->create_node<timeimpl>(sloc);
@@ -637,7 +784,12 @@ void context::dump_stats(std::ostream& out) {
   uint64_t proxies_bits = 0;
   uint64_t other_bits = 0;
 
+  uint64_t memory_used = 0;
+  uint64_t memory_reserved = 0;
+
   std::function<void(context*)> calc_stats = [&](context* ctx) {
+    memory_used += ctx->arena().used_bytes();
+    memory_reserved += ctx->arena().reserved_bytes();
     for (lnodeimpl* node : ctx->nodes()) {
       switch (node->type()) {
       case type_input:      
@@ -708,6 +860,7 @@ void context::dump_stats(std::ostream& out) {
   out << "ch-stats: total muxes = " << num_muxes << " (" << muxes_bits << " bits, " << ((muxes_bits * 100)/nodes_bits) << "%)" << std::endl;
   out << "ch-stats: total proxies = " << num_proxies << " (" << proxies_bits << " bits, " << ((proxies_bits * 100)/nodes_bits) << "%)" << std::endl;
   out << "ch-stats: total other = " << num_other << " (" << other_bits << " bits, " << ((other_bits * 100)/nodes_bits) << "%)" << std::endl;
+  out << "ch-stats: node memory = " << memory_used << " bytes (" << (num_nodes ? (memory_used / num_nodes) : 0) << " bytes/node, " << memory_reserved << " bytes reserved)" << std::endl;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -4,6 +4,8 @@
 #include "platform.h"
 #include "traits.h"
 #include "nodelistview.h"
+#include "device.h"
+#include "nodeset.h"
 
 namespace ch {
 namespace internal {
@@ -142,6 +144,14 @@ public:
     return cdomains_;
   }
 
+  node_arena& arena() {
+    return arena_;
+  }
+
+  const node_arena& arena() const {
+    return arena_;
+  }
+
   void set_managed(bool value) {
     is_managed_ = value;
   }
@@ -162,11 +172,39 @@ public:
 
   template <typename T, typename... Args>
   T* create_node(Args&&... args) {
-    auto node = new T(this, std::forward<Args>(args)...);
+    auto node = new (arena_) T(this, std::forward<Args>(args)...);
     this->add_node(node);
     return node;
   }
 
+  // operators and selects created with all their sources are not modified
+  // during elaboration, with hash-consing enabled they return an existing
+  // identical node, which is looked up before anything is constructed.
+  // proxies are excluded since they also back variables that get assigned.
+  opimpl* create_op(ch_op op,
+                    uint32_t size,
+                    bool is_signed,
+                    lnodeimpl* lhs,
+                    lnodeimpl* rhs,
+                    const std::string& name,
+                    const source_location& sloc);
+
+  selectimpl* create_select(uint32_t size,
+                            lnodeimpl* key,
+                            const std::vector<lnodeimpl*>& srcs,
+                            const std::string& name,
+                            const source_location& sloc);
+
+  void set_hash_consing(bool enable);
+
+  bool is_shared_node(const lnodeimpl* node) const {
+    return shared_nodes_.contains(node->id());
+  }
+
+  void set_shared_node(const lnodeimpl* node) {
+    shared_nodes_.insert(node->id());
+  }
+
   node_list_view::iterator delete_node(const node_list_view::iterator& it);
 
   void delete_node(lnodeimpl* node);
@@ -265,6 +303,10 @@ public:
 
   void dump_stats(std::ostream& out);
 
+  ch_opt_stats& opt_stats() {
+    return opt_stats_;
+  }
+
   //--
 
   void register_enum_string(uint32_t id, enum_string_cb callback);
@@ -275,6 +317,20 @@ protected:
 
   void add_node(lnodeimpl* node);  
 
+  lnodeimpl* find_node(size_t key,
+                       const std::vector<lnodeimpl*>& srcs,
+                       const std::function<bool(const lnodeimpl*)>& match) const;
+
+  static size_t node_key(uint32_t type,
+                         uint32_t size,
+                         const std::vector<lnodeimpl*>& srcs,
+                         size_t extra);
+
+  void remove_literal(litimpl* node);
+
+  static size_t literal_key(const sdata_type& value);
+
+  node_arena   arena_;
   uint32_t     id_;
   std::string  name_;
   context*     parent_;
@@ -315,6 +371,12 @@ protected:
   enum_strings_t enum_strings_;
   cd_stack_t     cd_stack_;  
   std::list<lnodeimpl*> ext_nodes_;
+  ch_opt_stats   opt_stats_;
+
+  std::unordered_multimap<size_t, litimpl*> literal_map_;
+  std::unordered_multimap<size_t, lnodeimpl*> node_map_;
+  node_set shared_nodes_;
+  bool hash_consing_;
 };
 
 std::pair<context*, bool> ctx_create(const std::type_index& signature,
@@ -3,7 +3,10 @@
 #include "context.h"
 #include "compile.h"
 #include "ioimpl.h"
+#include "moduleimpl.h"
 #include "bit.h"
+#include "platform.h"
+#include "ircache.h"
 
 using namespace ch::internal;
 
@@ -11,7 +14,10 @@ deviceimpl::deviceimpl(const std::type_index& signature,
                        bool is_pod,
                        const std::string& name)
   : old_ctx_(nullptr)
-  , is_opened_(false) {
+  , ir_key_(stringf("%s;%s", name.c_str(), signature.name()))
+  , is_pod_(is_pod)
+  , is_opened_(false)
+  , build_optimize_(0) {
   auto ret = ctx_create(signature, is_pod, name);
   ctx_ = ret.first;
   instance_ = ret.second;
@@ -35,16 +41,48 @@ std::string deviceimpl::name() const {
 bool deviceimpl::begin() {
   is_opened_ = true;
   old_ctx_ = ctx_swap(ctx_);
-  return (instance_ != 0);
+  if (instance_ != 0)
+    return true;
+  // reload the elaborated design, the io ports then bind by name
+  return this->is_cacheable()
+      && ircache_load(ctx_, ir_key_);
+}
+
+bool deviceimpl::is_cacheable() const {
+  // only top-level devices without state outside of their io
+  // fully elaborate in describe()
+  return is_pod_
+      && nullptr == old_ctx_
+      && !platform::self().ir_cache_dir().empty();
 }
 
 void deviceimpl::begin_build() {
   ctx_->set_initialized();
+  if (platform::self().cflags() & ch_flags::hash_consing) {
+    ctx_->set_hash_consing(true);
+  }
+  if (nullptr == old_ctx_ && platform::self().profiling()) {
+    build_start_ = std::chrono::steady_clock::now();
+    build_optimize_ = platform::self().profile(profile_counter::optimize);
+  }
 }
 
 void deviceimpl::end_build() {
- compiler compiler(ctx_);
- compiler.optimize();
+  ctx_->set_hash_consing(false);
+  {
+    compiler compiler(ctx_);
+    compiler.optimize();
+  }
+  if (this->is_cacheable()) {
+    ircache_store(ctx_, ir_key_);
+  }
+  if (nullptr == old_ctx_ && platform::self().profiling()) {
+    // top-level elaboration time, excluding the nested optimization passes
+    auto end = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - build_start_).count();
+    auto optimize = platform::self().profile(profile_counter::optimize) - build_optimize_;
+    platform::self().add_profile(profile_counter::elaborate, elapsed - optimize);
+  }
 }
 
 void deviceimpl::end(const std::string& name, const source_location& sloc) {
@@ -126,6 +164,55 @@ void device_base::end(const std::string& name, const source_location& sloc) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void ch::internal::ch_setircache(const std::string& dir, const std::string& fingerprint) {
+  platform::self().set_ir_cache(dir, fingerprint);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void ch::internal::ch_stats(std::ostream& out, const device_base& device) {
   device.impl()->ctx()->dump_stats(out);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+ch_pass_stats& ch_opt_stats::pass(const std::string& name) {
+  for (auto& stats : passes) {
+    if (stats.name == name)
+      return stats;
+  }
+  return passes.emplace_back(name);
+}
+
+ch_opt_stats& ch_opt_stats::operator+=(const ch_opt_stats& other) {
+  iterations   += other.iterations;
+  nodes_before += other.nodes_before;
+  nodes_after  += other.nodes_after;
+  time         += other.time;
+  for (auto& src : other.passes) {
+    auto& dst = this->pass(src.name);
+    dst.runs    += src.runs;
+    dst.changes += src.changes;
+    dst.time    += src.time;
+    dst.nodes   += src.nodes;
+  }
+  return *this;
+}
+
+ch_opt_stats ch::internal::ch_optstats(const device_base& device) {
+  // accumulate the stats of the device and its sub-modules
+  ch_opt_stats ret;
+  std::unordered_set<uint32_t> visited;
+  std::vector<context*> pending{device.impl()->ctx()};
+  while (!pending.empty()) {
+    auto ctx = pending.back();
+    pending.pop_back();
+    if (!visited.insert(ctx->id()).second)
+      continue;
+    ret += ctx->opt_stats();
+    for (auto node : ctx->modules()) {
+      pending.push_back(reinterpret_cast<moduleimpl*>(node)->target());
+    }
+  }
+  return ret;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include <chrono>
 
 namespace ch {
 namespace internal {
@@ -33,10 +34,16 @@ public:
 
 protected:
 
+  bool is_cacheable() const;
+
   context* ctx_;
   context* old_ctx_;
+  std::string ir_key_; // the type signature keeps template instances apart
+  bool is_pod_;
   bool is_opened_;
   uint32_t instance_;
+  std::chrono::steady_clock::time_point build_start_;
+  uint64_t build_optimize_;
 };
 
 }
@@ -0,0 +1,615 @@
+#include "ircache.h"
+#include "context.h"
+#include "compile.h"
+#include "litimpl.h"
+#include "proxyimpl.h"
+#include "ioimpl.h"
+#include "opimpl.h"
+#include "selectimpl.h"
+#include "cdimpl.h"
+#include "regimpl.h"
+#include "memimpl.h"
+#include "timeimpl.h"
+#include "assertimpl.h"
+#include "printimpl.h"
+#include "platform.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+
+using namespace ch::internal;
+
+static constexpr uint32_t IRCACHE_MAGIC   = 0x52494843; // "CHIR"
+static constexpr uint32_t IRCACHE_VERSION = 1;
+
+namespace {
+
+struct ir_node {
+  uint32_t type;
+  uint32_t id;
+  uint32_t size;
+  std::string name;
+  source_location sloc;
+  std::vector<std::pair<uint32_t, uint32_t>> srcs; // (id, size)
+  uint32_t args[3];
+  std::string text;
+  sdata_type data;
+  std::vector<proxyimpl::range_t> ranges;
+};
+
+class ir_writer {
+public:
+
+  ir_writer(std::ostream& out) : out_(out) {}
+
+  void word(uint32_t value) {
+    out_.write(reinterpret_cast<const char*>(&value), sizeof(uint32_t));
+  }
+
+  void string(const std::string& value) {
+    this->word(value.size());
+    out_.write(value.data(), value.size());
+  }
+
+  void data(const sdata_type& value) {
+    this->word(value.size());
+    out_.write(reinterpret_cast<const char*>(value.words()), value.num_words() * sizeof(block_type));
+  }
+
+  void sloc(const source_location& sloc) {
+    this->string(sloc.file());
+    this->word(sloc.line());
+    this->word(sloc.column());
+  }
+
+private:
+
+  std::ostream& out_;
+};
+
+class ir_reader {
+public:
+
+  ir_reader(std::istream& in) : in_(in) {}
+
+  bool good() const {
+    return in_.good();
+  }
+
+  uint32_t word() {
+    uint32_t value = 0;
+    in_.read(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+    return value;
+  }
+
+  std::string string() {
+    auto size = this->word();
+    if (!in_.good())
+      return "";
+    std::string value(size, '\0');
+    in_.read(value.data(), size);
+    return value;
+  }
+
+  sdata_type data() {
+    auto size = this->word();
+    if (!in_.good())
+      return sdata_type();
+    sdata_type value(size);
+    in_.read(reinterpret_cast<char*>(value.words()), value.num_words() * sizeof(block_type));
+    return value;
+  }
+
+  source_location sloc() {
+    auto file = this->string();
+    auto line = this->word();
+    auto column = this->word();
+    return source_location(file, line, column);
+  }
+
+private:
+
+  std::istream& in_;
+};
+
+}
+
+bool ch::internal::ir_save(std::ostream& out, context* ctx, const std::string& fingerprint) {
+  // check for nodes without a serializable form
+  for (auto node : ctx->nodes()) {
+    switch (node->type()) {
+    case type_module:
+    case type_modpin:
+    case type_modpout:
+    case type_bypass:
+    case type_udfc:
+    case type_udfs:
+    case type_udfin:
+    case type_udfout:
+      return false;
+    case type_print:
+      for (auto cb : reinterpret_cast<printimpl*>(node)->enum_strings()) {
+        if (cb)
+          return false;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  ir_writer writer(out);
+  writer.word(IRCACHE_MAGIC);
+  writer.word(IRCACHE_VERSION);
+  writer.string(fingerprint);
+  writer.word(ctx->nodes().size());
+
+  for (auto node : ctx->nodes()) {
+    writer.word(node->type());
+    writer.word(node->id());
+    writer.word(node->size());
+    writer.string(node->name());
+    writer.sloc(node->sloc());
+    writer.word(node->num_srcs());
+    for (auto& src : node->srcs()) {
+      writer.word(src.id());
+      writer.word(src.size());
+    }
+
+    switch (node->type()) {
+    case type_lit:
+      writer.data(reinterpret_cast<litimpl*>(node)->value());
+      break;
+    case type_proxy: {
+      auto& ranges = reinterpret_cast<proxyimpl*>(node)->ranges();
+      writer.word(ranges.size());
+      for (auto& range : ranges) {
+        writer.word(range.src_idx);
+        writer.word(range.dst_offset);
+        writer.word(range.src_offset);
+        writer.word(range.length);
+      }
+    } break;
+    case type_input: {
+      uint32_t system = 0;
+      if (node == ctx->sys_clk()) {
+        system = 1;
+      } else if (node == ctx->sys_reset()) {
+        system = 2;
+      }
+      writer.word(system);
+    } break;
+    case type_op: {
+      auto op = reinterpret_cast<opimpl*>(node);
+      writer.word(static_cast<uint32_t>(op->op()));
+      writer.word(op->is_signed());
+    } break;
+    case type_sel:
+      writer.word(reinterpret_cast<selectimpl*>(node)->has_key());
+      break;
+    case type_cd:
+      writer.word(reinterpret_cast<cdimpl*>(node)->pos_edge());
+      break;
+    case type_reg: {
+      auto reg = reinterpret_cast<regimpl*>(node);
+      writer.word(reg->length());
+      writer.word(reg->has_init_data());
+      writer.word(reg->has_enable());
+    } break;
+    case type_mem: {
+      auto mem = reinterpret_cast<memimpl*>(node);
+      writer.word(mem->data_width());
+      writer.word(mem->num_items());
+      writer.word(mem->force_logic_ram());
+      writer.data(mem->init_data());
+    } break;
+    case type_marport:
+    case type_msrport:
+    case type_mwport: {
+      auto port = reinterpret_cast<memportimpl*>(node);
+      writer.word(port->mem()->id());
+      writer.word(port->has_enable());
+    } break;
+    case type_assert: {
+      auto assertion = reinterpret_cast<assertimpl*>(node);
+      writer.word(assertion->has_pred());
+      writer.string(assertion->message());
+    } break;
+    case type_print: {
+      auto print = reinterpret_cast<printimpl*>(node);
+      writer.word(print->has_pred());
+      writer.string(print->format());
+    } break;
+    default:
+      break;
+    }
+  }
+
+  return out.good();
+}
+
+// checks that the image is a well-formed graph the node constructors
+// rebuild with exactly the recorded sources, before any node is created.
+static bool ir_validate(const std::vector<ir_node>& nodes) {
+  std::unordered_map<uint32_t, uint32_t> index;
+  std::unordered_map<uint32_t, uint32_t> mem_writers;
+  for (uint32_t i = 0, n = nodes.size(); i < n; ++i) {
+    if (!index.emplace(nodes[i].id, i).second)
+      return false;
+    if (type_mwport == nodes[i].type) {
+      ++mem_writers[nodes[i].args[0]];
+    }
+  }
+
+  for (uint32_t i = 0, n = nodes.size(); i < n; ++i) {
+    auto& node = nodes[i];
+    for (auto& src : node.srcs) {
+      auto it = index.find(src.first);
+      if (it == index.end() || nodes[it->second].size != src.second)
+        return false;
+    }
+    uint32_t num_srcs = node.srcs.size();
+    bool valid = false;
+    switch (node.type) {
+    case type_lit:
+      valid = (0 == num_srcs && node.data.size() == node.size);
+      break;
+    case type_proxy:
+      valid = std::all_of(node.ranges.begin(), node.ranges.end(), [&](const proxyimpl::range_t& range) {
+        return range.src_idx < num_srcs;
+      });
+      break;
+    case type_input:
+    case type_time:
+      valid = (0 == num_srcs);
+      break;
+    case type_output:
+    case type_cd:
+    case type_tap:
+      valid = (1 == num_srcs);
+      break;
+    case type_op:
+      valid = (1 == num_srcs || 2 == num_srcs);
+      break;
+    case type_sel:
+      valid = (num_srcs > (node.args[0] ? 1u : 0u));
+      break;
+    case type_reg:
+      // (cd, next, [reset, init_data], [enable])
+      valid = (num_srcs == 2u + (node.args[1] ? 2u : 0u) + (node.args[2] ? 1u : 0u));
+      break;
+    case type_mem:
+      // write ports add themselves as sources
+      valid = (num_srcs == mem_writers[node.id]);
+      break;
+    case type_marport:
+    case type_msrport:
+    case type_mwport: {
+      // the memory has to be created before its ports
+      auto it = index.find(node.args[0]);
+      if (it == index.end() || it->second > i || type_mem != nodes[it->second].type)
+        return false;
+      if (type_marport == node.type) {
+        valid = (2 == num_srcs); // (addr, mem)
+      } else {
+        valid = (num_srcs == 3u + (node.args[1] ? 1u : 0u));
+      }
+    } break;
+    case type_assert:
+      // (cond, time, [pred])
+      valid = (num_srcs == 2u + (node.args[0] ? 1u : 0u));
+      break;
+    case type_print:
+      valid = (num_srcs >= (node.args[0] ? 1u : 0u));
+      break;
+    }
+    if (!valid)
+      return false;
+  }
+
+  return true;
+}
+
+bool ch::internal::ir_load(std::istream& in, context* ctx, const std::string& fingerprint) {
+  ir_reader reader(in);
+  if (reader.word() != IRCACHE_MAGIC
+   || reader.word() != IRCACHE_VERSION
+   || reader.string() != fingerprint)
+    return false;
+
+  // read the whole image before modifying the context
+  std::vector<ir_node> nodes(reader.word());
+  if (!reader.good())
+    return false;
+  for (auto& n : nodes) {
+    n.type = reader.word();
+    n.id   = reader.word();
+    n.size = reader.word();
+    n.name = reader.string();
+    n.sloc = reader.sloc();
+    n.srcs.resize(reader.word());
+    if (!reader.good())
+      return false;
+    for (auto& src : n.srcs) {
+      src.first  = reader.word();
+      src.second = reader.word();
+    }
+    switch (n.type) {
+    case type_lit:
+      n.data = reader.data();
+      break;
+    case type_proxy:
+      n.ranges.resize(reader.word());
+      if (!reader.good())
+        return false;
+      for (auto& range : n.ranges) {
+        range.src_idx    = reader.word();
+        range.dst_offset = reader.word();
+        range.src_offset = reader.word();
+        range.length     = reader.word();
+      }
+      break;
+    case type_input:
+    case type_sel:
+    case type_cd:
+      n.args[0] = reader.word();
+      break;
+    case type_op:
+    case type_marport:
+    case type_msrport:
+    case type_mwport:
+      n.args[0] = reader.word();
+      n.args[1] = reader.word();
+      break;
+    case type_reg:
+      n.args[0] = reader.word();
+      n.args[1] = reader.word();
+      n.args[2] = reader.word();
+      break;
+    case type_mem:
+      n.args[0] = reader.word();
+      n.args[1] = reader.word();
+      n.args[2] = reader.word();
+      n.data = reader.data();
+      break;
+    case type_assert:
+    case type_print:
+      n.args[0] = reader.word();
+      n.text = reader.string();
+      break;
+    case type_output:
+    case type_tap:
+    case type_time:
+      break;
+    default:
+      return false;
+    }
+    if (!reader.good())
+      return false;
+  }
+
+  // any mismatch is a cache miss, the context is left untouched
+  if (!ir_validate(nodes))
+    return false;
+
+  // sources are resolved once all nodes exist,
+  // constructors are given placeholder proxies of the right size.
+  std::unordered_map<uint32_t, lnodeimpl*> stubs;
+  auto stub = [&](const ir_node& n, uint32_t index)->lnodeimpl* {
+    auto size = n.srcs.at(index).second;
+    auto& node = stubs[size];
+    if (nullptr == node) {
+      node = ctx->create_node<proxyimpl>(size, "", n.sloc);
+    }
+    return node;
+  };
+
+  clone_map map;
+  for (auto& n : nodes) {
+    lnodeimpl* node = nullptr;
+    auto num_srcs = n.srcs.size();
+    switch (n.type) {
+    case type_lit:
+      node = ctx->create_literal(n.data);
+      break;
+    case type_proxy: {
+      auto proxy = ctx->create_node<proxyimpl>(n.size, n.name, n.sloc);
+      for (uint32_t i = 0; i < num_srcs; ++i) {
+        proxy->add_src(stub(n, i));
+      }
+      proxy->ranges() = n.ranges;
+      node = proxy;
+    } break;
+    case type_input:
+      if (1 == n.args[0]) {
+        node = ctx->current_clock(n.sloc);
+      } else if (2 == n.args[0]) {
+        node = ctx->current_reset(n.sloc);
+      } else {
+        node = ctx->create_input(n.size, n.name, n.sloc);
+      }
+      break;
+    case type_output:
+      node = ctx->create_node<outputimpl>(n.size,
+                                          stub(n, 0),
+                                          smart_ptr<sdata_type>::make(n.size),
+                                          n.name,
+                                          n.sloc);
+      break;
+    case type_op:
+      if (2 == num_srcs) {
+        node = ctx->create_node<opimpl>(ch_op(n.args[0]), n.size, n.args[1], stub(n, 0), stub(n, 1), n.name, n.sloc);
+      } else {
+        node = ctx->create_node<opimpl>(ch_op(n.args[0]), n.size, n.args[1], stub(n, 0), n.name, n.sloc);
+      }
+      break;
+    case type_sel: {
+      lnodeimpl* key = n.args[0] ? stub(n, 0) : nullptr;
+      std::vector<lnodeimpl*> srcs;
+      for (uint32_t i = (key ? 1 : 0); i < num_srcs; ++i) {
+        srcs.push_back(stub(n, i));
+      }
+      node = ctx->create_node<selectimpl>(n.size, key, srcs, n.name, n.sloc);
+    } break;
+    case type_cd:
+      node = ctx->create_node<cdimpl>(stub(n, 0), n.args[0], n.sloc);
+      break;
+    case type_reg: {
+      // sources are (cd, next, [reset, init_data], [enable])
+      lnodeimpl* reset = n.args[1] ? stub(n, 2) : nullptr;
+      lnodeimpl* init_data = n.args[1] ? stub(n, 3) : nullptr;
+      lnodeimpl* enable = n.args[2] ? stub(n, num_srcs - 1) : nullptr;
+      node = ctx->create_node<regimpl>(n.size, n.args[0], stub(n, 0), reset, enable, stub(n, 1), init_data, n.name, n.sloc);
+    } break;
+    case type_mem:
+      node = ctx->create_node<memimpl>(n.args[0], n.args[1], n.data, n.args[2], n.name, n.sloc);
+      break;
+    case type_marport:
+    case type_msrport:
+    case type_mwport: {
+      auto mem = reinterpret_cast<memimpl*>(map.at(n.args[0]));
+      if (type_marport == n.type) {
+        node = ctx->create_node<marportimpl>(mem, stub(n, 0), n.name, n.sloc);
+      } else if (type_msrport == n.type) {
+        // sources are (cd, addr, [enable], mem)
+        lnodeimpl* enable = n.args[1] ? stub(n, 2) : nullptr;
+        node = ctx->create_node<msrportimpl>(mem, stub(n, 0), stub(n, 1), enable, n.name, n.sloc);
+      } else {
+        // sources are (cd, addr, [enable], wdata)
+        lnodeimpl* enable = n.args[1] ? stub(n, 2) : nullptr;
+        node = ctx->create_node<mwportimpl>(mem, stub(n, 0), stub(n, 1), stub(n, num_srcs - 1), enable, n.sloc);
+      }
+    } break;
+    case type_time:
+      node = ctx->create_time(n.sloc);
+      break;
+    case type_assert: {
+      // sources are (cond, time, [pred])
+      lnodeimpl* pred = n.args[0] ? stub(n, 2) : nullptr;
+      node = ctx->create_node<assertimpl>(stub(n, 0), pred, n.text, n.sloc);
+    } break;
+    case type_print: {
+      lnodeimpl* pred = n.args[0] ? stub(n, 0) : nullptr;
+      std::vector<lnode> args;
+      for (uint32_t i = (pred ? 1 : 0); i < num_srcs; ++i) {
+        args.emplace_back(stub(n, i));
+      }
+      std::vector<enum_string_cb> enum_strings(args.size(), nullptr);
+      node = ctx->create_node<printimpl>(n.text, args, enum_strings, pred, n.sloc);
+    } break;
+    case type_tap:
+      node = ctx->create_node<tapimpl>(stub(n, 0), n.name, n.sloc);
+      break;
+    }
+    map[n.id] = node;
+  }
+
+  // resolve sources
+  for (auto& n : nodes) {
+    auto node = map.at(n.id);
+    assert(node->num_srcs() == n.srcs.size());
+    for (uint32_t i = 0, num_srcs = n.srcs.size(); i < num_srcs; ++i) {
+      auto src = map.at(n.srcs[i].first);
+      if (node->src(i).id() != src->id()) {
+        node->set_src(i, src);
+      }
+    }
+  }
+
+  // delete the placeholders and nodes allocated as a side effect
+  std::unordered_set<uint32_t> loaded;
+  for (auto& entry : map) {
+    loaded.insert(entry.second->id());
+  }
+  for (auto it = ctx->nodes().begin(), end = ctx->nodes().end(); it != end;) {
+    auto node = *it;
+    if (0 == loaded.count(node->id())) {
+      assert(nullptr == node->users());
+      it = ctx->delete_node(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static std::string ircache_fingerprint() {
+  auto& fingerprint = platform::self().ir_fingerprint();
+  if (!fingerprint.empty())
+    return fingerprint;
+
+  // default to the identity of the running executable
+  char path[PATH_MAX];
+  auto len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (len <= 0)
+    return "";
+  path[len] = '\0';
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return "";
+  return stringf("%s:%lld:%lld", path, (long long)st.st_size, (long long)st.st_mtime);
+}
+
+static std::string ircache_path(const std::string& name, const std::string& fingerprint) {
+  // the key covers the device, the client fingerprint and the compiler flags
+  auto key = std::hash<std::string>()(stringf("%s;%s;cflags=%d;v%d",
+                                              name.c_str(),
+                                              fingerprint.c_str(),
+                                              static_cast<int>(platform::self().cflags()),
+                                              IRCACHE_VERSION));
+  return stringf("%s/ircache-%016llx.chir", platform::self().ir_cache_dir().c_str(), (unsigned long long)key);
+}
+
+bool ch::internal::ircache_load(context* ctx, const std::string& name) {
+  auto fingerprint = ircache_fingerprint();
+  if (fingerprint.empty())
+    return false;
+  auto path = ircache_path(name, fingerprint);
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open())
+    return false;
+  ctx->set_initialized();
+  auto hit = ir_load(in, ctx, fingerprint + ";" + name);
+  CH_DBG(1, "ircache: %s '%s' (%s)\n", (hit ? "hit" : "miss"), name.c_str(), path.c_str());
+  return hit;
+}
+
+void ch::internal::ircache_store(context* ctx, const std::string& name) {
+  auto fingerprint = ircache_fingerprint();
+  if (fingerprint.empty())
+    return;
+
+  // sub-modules are saved as a single flattened context
+  context* flat_ctx = ctx;
+  if (ctx->modules().size()) {
+    flat_ctx = new context(ctx->name());
+    flat_ctx->acquire();
+    compiler compiler(flat_ctx);
+    compiler.create_merged_context(ctx);
+    compiler.optimize();
+  }
+
+  auto& dir = platform::self().ir_cache_dir();
+  mkdir(dir.c_str(), 0755);
+  auto path = ircache_path(name, fingerprint);
+
+  // write a temporary file first so that concurrent readers never see partial images
+  auto tmp_path = stringf("%s.%d.tmp", path.c_str(), getpid());
+  bool saved;
+  {
+    std::ofstream out(tmp_path, std::ios::binary);
+    saved = out.is_open() && ir_save(out, flat_ctx, fingerprint + ";" + name);
+  }
+  if (!saved || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    saved = false;
+  }
+  CH_DBG(1, "ircache: %s '%s' (%s)\n", (saved ? "stored" : "skipped"), name.c_str(), path.c_str());
+
+  if (flat_ctx != ctx) {
+    flat_ctx->release();
+  }
+}
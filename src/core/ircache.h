@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common.h"
+
+namespace ch {
+namespace internal {
+
+class context;
+
+// serialize an elaborated context, returns false if the graph contains
+// nodes that cannot be saved (sub-modules, user-defined functions, enum prints).
+bool ir_save(std::ostream& out, context* ctx, const std::string& fingerprint);
+
+// load a serialized graph into an empty context,
+// returns false if the image is invalid or was saved with another fingerprint.
+bool ir_load(std::istream& in, context* ctx, const std::string& fingerprint);
+
+// lookup the elaborated design of a device in the IR cache directory
+bool ircache_load(context* ctx, const std::string& name);
+
+// store the elaborated design of a device into the IR cache directory
+void ircache_store(context* ctx, const std::string& name);
+
+}
+}
@@ -22,7 +22,8 @@ std::ostream& ch::internal::operator<<(std::ostream& out, ch_op op) {
 
 lnode::lnode(lnodeimpl* impl) 
   : impl_(impl)
-  , next_user_(nullptr) {
+  , next_user_(nullptr)
+  , prev_user_(nullptr) {
   if (impl) {
     impl->add_user(this);
   }
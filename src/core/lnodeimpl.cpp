@@ -28,11 +28,48 @@ lnodeimpl::lnodeimpl(uint32_t id,
   , name_(name)
   , sloc_(sloc)
   , hash_(0)
+  , srcs_(&ctx->arena())
   , prev_(nullptr)
   , next_(nullptr)
   , users_(nullptr) 
 {}
 
+// allocation header recording the owning arena
+struct node_header_t {
+  node_arena* arena;
+  size_t size;
+};
+
+static constexpr size_t NODE_HEADER_SIZE = (sizeof(node_header_t) + node_arena::ALIGNMENT - 1)
+                                         & ~(node_arena::ALIGNMENT - 1);
+
+void* lnodeimpl::operator new(size_t size, node_arena& arena) {
+  auto header = reinterpret_cast<node_header_t*>(arena.allocate(size + NODE_HEADER_SIZE));
+  header->arena = &arena;
+  header->size = size + NODE_HEADER_SIZE;
+  return reinterpret_cast<char*>(header) + NODE_HEADER_SIZE;
+}
+
+void* lnodeimpl::operator new(size_t size) {
+  auto header = reinterpret_cast<node_header_t*>(::operator new(size + NODE_HEADER_SIZE));
+  header->arena = nullptr;
+  header->size = size + NODE_HEADER_SIZE;
+  return reinterpret_cast<char*>(header) + NODE_HEADER_SIZE;
+}
+
+void lnodeimpl::operator delete(void* ptr) {
+  auto header = reinterpret_cast<node_header_t*>(reinterpret_cast<char*>(ptr) - NODE_HEADER_SIZE);
+  if (header->arena) {
+    header->arena->deallocate(header, header->size);
+  } else {
+    ::operator delete(header);
+  }
+}
+
+void lnodeimpl::operator delete(void* ptr, node_arena&) {
+  lnodeimpl::operator delete(ptr);
+}
+
 lnodeimpl::~lnodeimpl() {
   for (lnode *curr = users_; curr;) {
     auto user = curr;
@@ -40,6 +77,7 @@ lnodeimpl::~lnodeimpl() {
     assert(user->impl_ == this);
     user->impl_ = nullptr;
     user->next_user_ = nullptr;
+    user->prev_user_ = nullptr;
   }
   users_ = nullptr;
 }
@@ -114,26 +152,27 @@ bool lnodeimpl::has_user(lnode* user) const {
 }
 
 void lnodeimpl::add_user(lnode* user) {
+  user->prev_user_ = nullptr;
   user->next_user_ = users_;
+  if (users_) {
+    users_->prev_user_ = user;
+  }
   users_ = user;
 }
 
 void lnodeimpl::remove_user(lnode* user) {
-  for (lnode *prev = nullptr, *curr = users_; curr;) {
-    assert(curr->impl_ == this);
-    if (curr == user) {
-      if (prev) {
-        prev->next_user_ = curr->next_user_;
-      } else {
-        users_ = curr->next_user_;
-      }
-      curr->impl_ = nullptr;
-      return;
-    }
-    prev = curr;
-    curr = curr->next_user_;
+  assert(user->impl_ == this);
+  if (user->prev_user_) {
+    user->prev_user_->next_user_ = user->next_user_;
+  } else {
+    users_ = user->next_user_;
+  }
+  if (user->next_user_) {
+    user->next_user_->prev_user_ = user->prev_user_;
   }
-  assert(false);
+  user->impl_ = nullptr;
+  user->next_user_ = nullptr;
+  user->prev_user_ = nullptr;
 }
 
 void lnodeimpl::replace_uses(lnodeimpl* node) {  
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lnode.h"
+#include "arena.h"
 
 #define CH_LNODE_TYPE(t) type_##t,
 #define CH_LNODE_NAME(n) #n,
@@ -48,6 +49,17 @@ using clone_map = std::unordered_map<uint32_t, lnodeimpl*>;
 class lnodeimpl : public refcounted {
 public:
 
+  using src_list = std::vector<lnode, arena_allocator<lnode>>;
+
+  // nodes are allocated from the arena of their context
+  static void* operator new(size_t size, node_arena& arena);
+
+  static void* operator new(size_t size);
+
+  static void operator delete(void* ptr);
+
+  static void operator delete(void* ptr, node_arena& arena);
+
   uint32_t id() const {
     return id_;
   }
@@ -76,7 +88,7 @@ public:
     return ctx_;
   }
 
-  const std::vector<lnode>& srcs() const {
+  const src_list& srcs() const {
     return srcs_;
   }
   
@@ -158,7 +170,7 @@ protected:
 
 private:
 
-  std::vector<lnode> srcs_;
+  src_list srcs_;
 
   lnodeimpl* prev_;
   lnodeimpl* next_;
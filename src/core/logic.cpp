@@ -35,6 +35,7 @@ void logic_buffer::write(uint32_t dst_offset,
                          uint32_t length) {
   assert(impl_);
   this->ensure_proxy();
+  CH_CHECK(!impl_->ctx()->is_shared_node(impl_), "cannot assign to a hash-consed expression %s", impl_->debug_info().c_str());
   reinterpret_cast<proxyimpl*>(impl_)->write(dst_offset, src.impl(), src_offset, length, impl_->sloc());
 }
 
@@ -63,4 +64,8 @@ void logic_buffer::ensure_proxy() const {
   auto proxy = ctx_curr()->create_node<proxyimpl>(impl->size(), "", impl->sloc());
   impl->replace_uses(proxy);
   proxy->write(0, impl, 0, impl->size(), impl->sloc());
+  // the proxy takes over the users of a shared node
+  if (impl->ctx()->is_shared_node(impl)) {
+    impl->ctx()->set_shared_node(proxy);
+  }
 }
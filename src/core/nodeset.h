@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.h"
+
+namespace ch {
+namespace internal {
+
+// dense set of node ids backed by a bitset.
+// node ids are allocated sequentially, the storage starts at the lowest
+// inserted id and grows on demand in both directions.
+class node_set {
+public:
+
+  node_set() : base_(0), size_(0) {}
+
+  bool contains(uint32_t id) const {
+    if (id < base_)
+      return false;
+    auto idx = id - base_;
+    auto w = idx / WORD_BITS;
+    if (w >= words_.size())
+      return false;
+    return (words_[w] >> (idx % WORD_BITS)) & 0x1;
+  }
+
+  uint32_t count(uint32_t id) const {
+    return this->contains(id) ? 1 : 0;
+  }
+
+  bool insert(uint32_t id) {
+    this->reserve(id);
+    auto idx = id - base_;
+    auto& word = words_[idx / WORD_BITS];
+    auto mask = uint64_t(1) << (idx % WORD_BITS);
+    if (word & mask)
+      return false;
+    word |= mask;
+    ++size_;
+    return true;
+  }
+
+  bool erase(uint32_t id) {
+    if (!this->contains(id))
+      return false;
+    auto idx = id - base_;
+    words_[idx / WORD_BITS] &= ~(uint64_t(1) << (idx % WORD_BITS));
+    --size_;
+    return true;
+  }
+
+  void clear() {
+    std::fill(words_.begin(), words_.end(), 0);
+    size_ = 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return (0 == size_);
+  }
+
+private:
+
+  static constexpr uint32_t WORD_BITS = 64;
+
+  void reserve(uint32_t id) {
+    auto id_base = id - (id % WORD_BITS);
+    if (words_.empty()) {
+      base_ = id_base;
+    } else if (id < base_) {
+      words_.insert(words_.begin(), (base_ - id_base) / WORD_BITS, 0);
+      base_ = id_base;
+    }
+    size_t w = (id - base_) / WORD_BITS;
+    if (w >= words_.size()) {
+      words_.resize(std::max(w + 1, 2 * words_.size()), 0);
+    }
+  }
+
+  std::vector<uint64_t> words_;
+  uint32_t base_;
+  size_t size_;
+};
+
+}
+}
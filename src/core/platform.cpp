@@ -6,11 +6,22 @@ class platform::Impl {
   int dbg_level_;
   int dbg_node_;
   int cflags_;
+  std::string jit_cache_dir_;
+  uint64_t jit_cache_size_;
+  uint32_t jit_region_size_;
+  uint32_t jit_threads_;
+  std::string ir_cache_dir_;
+  std::string ir_fingerprint_;
+  std::string profile_file_;
+  std::atomic<uint64_t> profile_[(int)profile_counter::count];
 
   Impl()
     : dbg_level_(0)
     , dbg_node_(0)
-    , cflags_(0) {
+    , cflags_(0)
+    , jit_cache_size_(256ull << 20)
+    , jit_region_size_(4096)
+    , jit_threads_(0) {
 
     auto dbg_level = std::getenv("CASH_DEBUG_LEVEL");
     if (dbg_level) {
@@ -26,6 +37,60 @@ class platform::Impl {
     if (ch_flags) {
       cflags_ = atoi(ch_flags);
     }
+
+    auto jit_cache = std::getenv("CASH_JIT_CACHE");
+    if (jit_cache) {
+      jit_cache_dir_ = jit_cache;
+    }
+
+    // cache size limit in megabytes
+    auto jit_cache_size = std::getenv("CASH_JIT_CACHE_SIZE");
+    if (jit_cache_size) {
+      jit_cache_size_ = uint64_t(atoll(jit_cache_size)) << 20;
+    }
+
+    // maximum number of nodes per JIT function, zero disables splitting
+    auto jit_region_size = std::getenv("CASH_JIT_REGION_SIZE");
+    if (jit_region_size) {
+      jit_region_size_ = atoi(jit_region_size);
+    }
+
+    // number of JIT compile threads, zero uses all cores
+    auto jit_threads = std::getenv("CASH_JIT_THREADS");
+    if (jit_threads) {
+      jit_threads_ = atoi(jit_threads);
+    }
+
+    // directory of the elaborated designs cache
+    auto ir_cache = std::getenv("CASH_IR_CACHE");
+    if (ir_cache) {
+      ir_cache_dir_ = ir_cache;
+    }
+
+    // file receiving the compile and simulation profile on exit
+    auto profile_file = std::getenv("CASH_PROFILE");
+    if (profile_file) {
+      profile_file_ = profile_file;
+    }
+
+    for (auto& counter : profile_) {
+      counter = 0;
+    }
+  }
+
+  ~Impl() {
+    if (profile_file_.empty())
+      return;
+    std::ofstream out(profile_file_);
+    auto secs = [&](profile_counter counter) {
+      return profile_[(int)counter] * 1e-9;
+    };
+    out << "{\"elaborate\": " << secs(profile_counter::elaborate)
+        << ", \"optimize\": " << secs(profile_counter::optimize)
+        << ", \"jit\": " << secs(profile_counter::jit)
+        << ", \"simulate\": " << secs(profile_counter::simulate)
+        << ", \"ticks\": " << profile_[(int)profile_counter::ticks]
+        << "}" << std::endl;
   }
 
   friend class platform;
@@ -55,6 +120,47 @@ void platform::set_cflags(ch::internal::ch_flags value) {
   impl_->cflags_ = static_cast<int>(value);
 }
 
+const std::string& platform::jit_cache_dir() const {
+  return impl_->jit_cache_dir_;
+}
+
+uint64_t platform::jit_cache_size() const {
+  return impl_->jit_cache_size_;
+}
+
+uint32_t platform::jit_region_size() const {
+  return impl_->jit_region_size_;
+}
+
+uint32_t platform::jit_threads() const {
+  return impl_->jit_threads_;
+}
+
+const std::string& platform::ir_cache_dir() const {
+  return impl_->ir_cache_dir_;
+}
+
+const std::string& platform::ir_fingerprint() const {
+  return impl_->ir_fingerprint_;
+}
+
+void platform::set_ir_cache(const std::string& dir, const std::string& fingerprint) {
+  impl_->ir_cache_dir_ = dir;
+  impl_->ir_fingerprint_ = fingerprint;
+}
+
+bool platform::profiling() const {
+  return !impl_->profile_file_.empty();
+}
+
+uint64_t platform::profile(profile_counter counter) const {
+  return impl_->profile_[(int)counter];
+}
+
+void platform::add_profile(profile_counter counter, uint64_t value) {
+  impl_->profile_[(int)counter] += value;
+}
+
 platform& platform::self() {
   static platform s_instance;
   return s_instance;
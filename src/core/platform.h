@@ -1,10 +1,20 @@
 #pragma once
 
 #include "cflags.h"
+#include <chrono>
 
 namespace ch {
 namespace internal {
 
+enum class profile_counter {
+  elaborate,
+  optimize,
+  jit,
+  simulate,
+  ticks,
+  count
+};
+
 class platform {
 public:
 
@@ -21,11 +31,62 @@ public:
   ch::internal::ch_flags cflags() const;
 
   void set_cflags(ch::internal::ch_flags value);
+
+  const std::string& jit_cache_dir() const;
+
+  uint64_t jit_cache_size() const;
+
+  uint32_t jit_region_size() const;
+
+  uint32_t jit_threads() const;
+
+  const std::string& ir_cache_dir() const;
+
+  const std::string& ir_fingerprint() const;
+
+  void set_ir_cache(const std::string& dir, const std::string& fingerprint);
+
+  bool profiling() const;
+
+  uint64_t profile(profile_counter counter) const;
+
+  void add_profile(profile_counter counter, uint64_t value);
   
 protected:
   class Impl;
   Impl* impl_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+class profile_timer {
+public:
+
+  profile_timer(profile_counter counter)
+    : counter_(counter)
+    , enabled_(platform::self().profiling()) {
+    if (enabled_) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~profile_timer() {
+    if (enabled_) {
+      platform::self().add_profile(counter_, this->elapsed());
+    }
+  }
+
+  uint64_t elapsed() const {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+  }
+
+private:
+
+  profile_counter counter_;
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+};
+
 }
 }
@@ -0,0 +1,343 @@
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #define CH_SIMD_X86
+  #include <immintrin.h>
+#endif
+
+namespace ch {
+namespace internal {
+namespace simd {
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace generic {
+
+static void bit_and(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = lhs[i] & rhs[i];
+  }
+}
+
+static void bit_or(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = lhs[i] | rhs[i];
+  }
+}
+
+static void bit_xor(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = lhs[i] ^ rhs[i];
+  }
+}
+
+static void bit_inv(uint64_t* out, const uint64_t* in, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = ~in[i];
+  }
+}
+
+static bool eq(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    if (lhs[i] != rhs[i])
+      return false;
+  }
+  return true;
+}
+
+static int32_t diff(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  for (int32_t i = static_cast<int32_t>(n) - 1; i >= 0; --i) {
+    if (lhs[i] != rhs[i])
+      return i;
+  }
+  return -1;
+}
+
+static void shr(uint64_t* out, const uint64_t* in, uint32_t n, uint32_t shift) {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = (in[i] >> shift) | (in[i + 1] << (64 - shift));
+  }
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef CH_SIMD_X86
+
+namespace avx2 {
+
+#define CH_SIMD_AVX2 __attribute__((target("avx2")))
+
+#define CH_SIMD_AVX2_BINARY(name, insn) \
+  CH_SIMD_AVX2 static void name(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) { \
+    uint32_t i = 0; \
+    for (; i + 4 <= n; i += 4) { \
+      auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i)); \
+      auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i)); \
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), insn(a, b)); \
+    } \
+    generic::name(out + i, lhs + i, rhs + i, n - i); \
+  }
+
+CH_SIMD_AVX2_BINARY(bit_and, _mm256_and_si256)
+CH_SIMD_AVX2_BINARY(bit_or, _mm256_or_si256)
+CH_SIMD_AVX2_BINARY(bit_xor, _mm256_xor_si256)
+
+#undef CH_SIMD_AVX2_BINARY
+
+CH_SIMD_AVX2 static void bit_inv(uint64_t* out, const uint64_t* in, uint32_t n) {
+  auto ones = _mm256_set1_epi64x(-1);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(a, ones));
+  }
+  generic::bit_inv(out + i, in + i, n - i);
+}
+
+CH_SIMD_AVX2 static bool eq(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+    auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+    auto x = _mm256_xor_si256(a, b);
+    if (!_mm256_testz_si256(x, x))
+      return false;
+  }
+  return generic::eq(lhs + i, rhs + i, n - i);
+}
+
+CH_SIMD_AVX2 static int32_t diff(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  // the top words not covered by a full vector are checked first
+  uint32_t i = n & ~3u;
+  auto r = generic::diff(lhs + i, rhs + i, n - i);
+  if (r >= 0)
+    return i + r;
+  while (i) {
+    i -= 4;
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+    auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+    auto m = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))) ^ 0xf;
+    if (m)
+      return i + (31 - __builtin_clz(m));
+  }
+  return -1;
+}
+
+CH_SIMD_AVX2 static void shr(uint64_t* out, const uint64_t* in, uint32_t n, uint32_t shift) {
+  auto s_lo = _mm_cvtsi32_si128(shift);
+  auto s_hi = _mm_cvtsi32_si128(64 - shift);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 1));
+    auto r = _mm256_or_si256(_mm256_srl_epi64(a, s_lo), _mm256_sll_epi64(b, s_hi));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+  }
+  generic::shr(out + i, in + i, n - i, shift);
+}
+
+#undef CH_SIMD_AVX2
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace avx512 {
+
+#define CH_SIMD_AVX512 __attribute__((target("avx512f")))
+
+// words left over from full vectors go through the avx2 kernels
+#define CH_SIMD_AVX512_BINARY(name, insn) \
+  CH_SIMD_AVX512 static void name(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) { \
+    uint32_t i = 0; \
+    for (; i + 8 <= n; i += 8) { \
+      auto a = _mm512_loadu_si512(lhs + i); \
+      auto b = _mm512_loadu_si512(rhs + i); \
+      _mm512_storeu_si512(out + i, insn(a, b)); \
+    } \
+    avx2::name(out + i, lhs + i, rhs + i, n - i); \
+  }
+
+CH_SIMD_AVX512_BINARY(bit_and, _mm512_and_si512)
+CH_SIMD_AVX512_BINARY(bit_or, _mm512_or_si512)
+CH_SIMD_AVX512_BINARY(bit_xor, _mm512_xor_si512)
+
+#undef CH_SIMD_AVX512_BINARY
+
+CH_SIMD_AVX512 static void bit_inv(uint64_t* out, const uint64_t* in, uint32_t n) {
+  auto ones = _mm512_set1_epi64(-1);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto a = _mm512_loadu_si512(in + i);
+    _mm512_storeu_si512(out + i, _mm512_xor_si512(a, ones));
+  }
+  avx2::bit_inv(out + i, in + i, n - i);
+}
+
+CH_SIMD_AVX512 static bool eq(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto a = _mm512_loadu_si512(lhs + i);
+    auto b = _mm512_loadu_si512(rhs + i);
+    if (_mm512_cmpneq_epu64_mask(a, b))
+      return false;
+  }
+  return avx2::eq(lhs + i, rhs + i, n - i);
+}
+
+CH_SIMD_AVX512 static int32_t diff(const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  uint32_t i = n & ~7u;
+  auto r = avx2::diff(lhs + i, rhs + i, n - i);
+  if (r >= 0)
+    return i + r;
+  while (i) {
+    i -= 8;
+    auto a = _mm512_loadu_si512(lhs + i);
+    auto b = _mm512_loadu_si512(rhs + i);
+    uint32_t m = _mm512_cmpneq_epu64_mask(a, b);
+    if (m)
+      return i + (31 - __builtin_clz(m));
+  }
+  return -1;
+}
+
+CH_SIMD_AVX512 static void shr(uint64_t* out, const uint64_t* in, uint32_t n, uint32_t shift) {
+  // the unmasked shifts merge into an undefined vector that gcc reports
+  // as uninitialized, the zero-masked forms with a full mask do not.
+  auto s_lo = _mm_cvtsi32_si128(shift);
+  auto s_hi = _mm_cvtsi32_si128(64 - shift);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto a = _mm512_loadu_si512(in + i);
+    auto b = _mm512_loadu_si512(in + i + 1);
+    auto lo = _mm512_maskz_srl_epi64(0xff, a, s_lo);
+    auto hi = _mm512_maskz_sll_epi64(0xff, b, s_hi);
+    _mm512_storeu_si512(out + i, _mm512_or_si512(lo, hi));
+  }
+  avx2::shr(out + i, in + i, n - i, shift);
+}
+
+#undef CH_SIMD_AVX512
+
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+const kernels_t& get_kernels(isa_type isa) {
+#ifdef CH_SIMD_X86
+  static const kernels_t s_avx512{isa_type::avx512,
+    avx512::bit_and, avx512::bit_or, avx512::bit_xor, avx512::bit_inv,
+    avx512::eq, avx512::diff, avx512::shr};
+  static const kernels_t s_avx2{isa_type::avx2,
+    avx2::bit_and, avx2::bit_or, avx2::bit_xor, avx2::bit_inv,
+    avx2::eq, avx2::diff, avx2::shr};
+  if (isa_type::avx512 == isa)
+    return s_avx512;
+  if (isa_type::avx2 == isa)
+    return s_avx2;
+#endif
+  static const kernels_t s_generic{isa_type::generic,
+    generic::bit_and, generic::bit_or, generic::bit_xor, generic::bit_inv,
+    generic::eq, generic::diff, generic::shr};
+  (void)isa;
+  return s_generic;
+}
+
+isa_type detect_isa() {
+  auto isa = isa_type::generic;
+#ifdef CH_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    isa = isa_type::avx512;
+  } else if (__builtin_cpu_supports("avx2")) {
+    isa = isa_type::avx2;
+  }
+#endif
+  auto env = getenv("CASH_SIMD");
+  if (env) {
+    isa_type cap = isa;
+    if (0 == strcmp(env, "generic")) {
+      cap = isa_type::generic;
+    } else if (0 == strcmp(env, "avx2")) {
+      cap = isa_type::avx2;
+    }
+    if (cap < isa) {
+      isa = cap;
+    }
+  }
+  return isa;
+}
+
+const kernels_t& kernels() {
+  static const kernels_t& s_kernels = get_kernels(detect_isa());
+  return s_kernels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace generic {
+
+uint64_t add(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  uint64_t carry = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto a = lhs[i];
+    auto c = a + rhs[i];
+    auto d = c + carry;
+    carry = (c < a) || (d < carry);
+    out[i] = d;
+  }
+  return carry;
+}
+
+uint64_t sub(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+  uint64_t borrow = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto a = lhs[i];
+    auto b = rhs[i];
+    auto c = a - b;
+    auto d = c - borrow;
+    borrow = (a < b) || (c < borrow);
+    out[i] = d;
+  }
+  return borrow;
+}
+
+}
+
+uint64_t add(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+#ifdef CH_SIMD_X86
+  unsigned char carry = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    unsigned long long r;
+    carry = _addcarry_u64(carry, lhs[i], rhs[i], &r);
+    out[i] = r;
+  }
+  return carry;
+#else
+  return generic::add(out, lhs, rhs, n);
+#endif
+}
+
+uint64_t sub(uint64_t* out, const uint64_t* lhs, const uint64_t* rhs, uint32_t n) {
+#ifdef CH_SIMD_X86
+  unsigned char borrow = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    unsigned long long r;
+    borrow = _subborrow_u64(borrow, lhs[i], rhs[i], &r);
+    out[i] = r;
+  }
+  return borrow;
+#else
+  return generic::sub(out, lhs, rhs, n);
+#endif
+}
+
+}
+}
+}
@@ -11,12 +11,20 @@
 using namespace ch::internal;
 
 void clock_driver::add_signal(inputimpl* node) {
-  *node->value() = value_;
-  nodes_.push_back(node->value());
+  this->add_signal(node->value());
+}
+
+void clock_driver::add_signal(const io_value_t& value) {
+  *value = value_;
+  nodes_.push_back(value);
 }
 
 void clock_driver::eval() {
-  value_ = !value_;
+  this->set_value(!value_);
+}
+
+void clock_driver::set_value(bool value) {
+  value_ = value;
   for (auto node : nodes_) {
     *node = value_;
   }
@@ -24,12 +32,95 @@ void clock_driver::eval() {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-simulatorimpl::simulatorimpl(const std::vector<device_base>& devices)
+void clock_scheduler::add_clock(ioportimpl* node,
+                                uint32_t period,
+                                uint32_t phase,
+                                const sim_lanes& lanes) {
+  CH_CHECK(period >= 2 && 0 == (period % 2), "invalid clock period %d", period);
+  std::vector<io_value_t> signals;
+  for (uint32_t i = 0, n = lanes.count(); i < n; ++i) {
+    signals.push_back(lanes.port(i, node));
+  }
+  clocks_.push_back({node, period, phase % period, signals});
+}
+
+void clock_scheduler::eval(ch_tick t) {
+  for (auto& clock : clocks_) {
+    // low for the first half of the period, high for the second
+    bool value = ((t + clock.period - clock.phase) % clock.period) >= (clock.period / 2);
+    for (auto& signal : clock.signals) {
+      *signal = value;
+    }
+  }
+}
+
+ch_tick clock_scheduler::next_edge(ch_tick t) const {
+  auto ret = std::numeric_limits<ch_tick>::max();
+  for (auto& clock : clocks_) {
+    auto half = clock.period / 2;
+    auto offset = (t + 1 + clock.period - clock.phase) % half;
+    auto edge = t + 1 + (offset ? (half - offset) : 0);
+    ret = std::min(ret, edge);
+  }
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void sim_lanes::add_port(ioportimpl* node) {
+  auto& value = node->value();
+  auto& ports = ports_[value.get()];
+  if (!ports.empty())
+    return;
+  ports.reserve(count_);
+  ports.push_back(value);
+  for (uint32_t i = 1; i < count_; ++i) {
+    // new lanes start with the current port value
+    ports.emplace_back(new sdata_type(*value));
+  }
+}
+
+void sim_lanes::fork(const sim_lanes& other) {
+  count_ = other.count_;
+  for (auto& entry : other.ports_) {
+    auto& ports = ports_[entry.first];
+    ports.reserve(count_);
+    for (auto& value : entry.second) {
+      ports.emplace_back(new sdata_type(*value));
+    }
+  }
+}
+
+const io_value_t& sim_lanes::port(uint32_t lane, ioportimpl* node) const {
+  return this->port(lane, *node->value());
+}
+
+const io_value_t& sim_lanes::port(uint32_t lane, const sdata_type& value) const {
+  auto it = ports_.find(&value);
+  CH_CHECK(it != ports_.end(), "invalid simulation port");
+  CH_CHECK(lane < count_, "invalid simulation lane %d", lane);
+  return it->second.at(lane);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+simulatorimpl::simulatorimpl(const std::vector<device_base>& devices,
+                             const ch_simopts& options)
   : eval_ctx_(nullptr)
   , clk_driver_(false)
   , reset_driver_(false)
   , sim_driver_(nullptr)
-  , verbose_tracing_(false) {
+  , jit_driver_(nullptr)
+  , jit_ready_(false)
+  , num_jit_swaps_(0)
+  , lanes_(options.num_lanes)
+  , num_threads_(options.num_threads)
+  , verbose_tracing_(false)
+  , edge_only_(false) {
+  CH_CHECK(options.num_lanes > 0, "invalid number of simulation lanes");
+  if (0 == num_threads_) {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
   // enqueue all contexts
   for (auto dev : devices) {
     auto ctx = dev.impl()->ctx();
@@ -47,7 +138,60 @@ simulatorimpl::simulatorimpl(const std::vector<device_base>& devices)
   }
 }
 
+simulatorimpl::simulatorimpl(simulatorimpl& other)
+  : contexts_(other.contexts_)
+  , eval_ctx_(other.eval_ctx_)
+  , eval_list_(other.eval_list_)
+  , clk_driver_(other.clk_driver_.value())
+  , reset_driver_(other.reset_driver_.value())
+  , sim_driver_(nullptr)
+  , jit_driver_(nullptr)
+  , jit_ready_(false)
+  , num_jit_swaps_(0)
+  , num_threads_(other.num_threads_)
+  , verbose_tracing_(other.verbose_tracing_)
+  , edge_only_(other.edge_only_) {
+  CH_CHECK(eval_ctx_->udfs().empty(), "user-defined functions cannot be forked");
+  for (auto ctx : contexts_) {
+    ctx->acquire();
+  }
+  eval_ctx_->acquire();
+
+  if (other.jit_ready_) {
+    other.swap_driver();
+  }
+
+  // the fork gets its own port buffers, devices keep pointing to the original
+  lanes_.fork(other.lanes_);
+  sim_driver_ = other.sim_driver_->fork(eval_list_, lanes_);
+  sim_driver_->acquire();
+
+  // bind system signals
+  auto clk = eval_ctx_->sys_clk();
+  if (clk) {
+    for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+      clk_driver_.add_signal(lanes_.port(i, clk));
+    }
+  }
+  auto reset = eval_ctx_->sys_reset();
+  if (reset) {
+    for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+      reset_driver_.add_signal(lanes_.port(i, reset));
+    }
+  }
+  for (auto& clock : other.clk_scheduler_.clocks()) {
+    clk_scheduler_.add_clock(clock.node, clock.period, clock.phase, lanes_);
+  }
+}
+
 simulatorimpl::~simulatorimpl() {
+#if defined(LIBJIT) || defined(LLVMJIT)
+  if (jit_driver_) {
+    jit_driver_->cancel();
+    jit_thread_.join();
+    jit_driver_->release();
+  }
+#endif
   if (sim_driver_) {
     sim_driver_->release();
   }
@@ -85,36 +229,262 @@ void simulatorimpl::initialize() {
       compiler compiler(eval_ctx_);
       compiler.build_eval_list(eval_list);
     }
+    eval_list_ = eval_list;
+
+    // allocate lane buffers
+    {
+      CH_CHECK(1 == lanes_.count() || eval_ctx_->udfs().empty(),
+               "user-defined functions are not supported with multiple simulation lanes");
+      for (auto node : eval_ctx_->inputs()) {
+        lanes_.add_port(reinterpret_cast<ioportimpl*>(node));
+      }
+      for (auto node : eval_ctx_->outputs()) {
+        lanes_.add_port(reinterpret_cast<ioportimpl*>(node));
+      }
+      for (auto node : eval_ctx_->taps()) {
+        lanes_.add_port(reinterpret_cast<ioportimpl*>(node));
+      }
+    }
 
     // initialize driver
   #if defined(LIBJIT) || defined(LLVMJIT)
-    if (0 == (platform::self().cflags() & ch_flags::disable_jit)) {
-      sim_driver_ = new simjit::driver();
+    auto cflags = platform::self().cflags();
+    if (0 == (cflags & ch_flags::disable_jit)) {
+      if (num_threads_ > lanes_.count()) {
+        // only the interpreter partitions the logic of a lane
+        fprintf(stderr, "warning: compiled simulation runs one thread per lane, %u of %u threads are idle"
+                        " (set ch_flags::disable_jit to partition the design)\n",
+                num_threads_ - lanes_.count(), num_threads_);
+      }
+      if (0 == (cflags & (ch_flags::disable_tex | ch_flags::dump_ast | ch_flags::dump_asm))
+       && eval_ctx_->udfs().empty()) {
+        // run on the interpreter while the native code is compiled
+        jit_driver_ = new simjit::driver(num_threads_);
+        jit_driver_->acquire();
+        jit_thread_ = std::thread([this, eval_list]() {
+          try {
+            jit_driver_->initialize(eval_list, lanes_);
+          } catch (...) {
+            jit_error_ = std::current_exception();
+          }
+          jit_ready_ = true;
+        });
+        sim_driver_ = new simref::driver();
+      } else {
+        sim_driver_ = new simjit::driver(num_threads_);
+      }
     } else {
-      sim_driver_ = new simref::driver();
+      sim_driver_ = new simref::driver(num_threads_);
     }
   #else
-    sim_driver_ = new simref::driver();
+    sim_driver_ = new simref::driver(num_threads_);
   #endif
     sim_driver_->acquire();
-    sim_driver_->initialize(eval_list);
+    sim_driver_->initialize(eval_list, lanes_);
   }
 
   // bind system signals
   auto clk = eval_ctx_->sys_clk();
   if (clk) {
-    clk_driver_.add_signal(clk);
+    for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+      clk_driver_.add_signal(lanes_.port(i, clk));
+    }
   }
   auto reset = eval_ctx_->sys_reset();
   if (reset) {
-    reset_driver_.add_signal(reset);
+    for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+      reset_driver_.add_signal(lanes_.port(i, reset));
+    }
+  }
+
+  // skipping ticks without clock edges would change the simulation time
+  // and how often prints and asserts are evaluated
+  edge_only_ = (nullptr == eval_ctx_->sys_time());
+  for (auto node : eval_ctx_->gtaps()) {
+    if (0 == node->size()) {
+      edge_only_ = false;
+    }
+  }
+}
+
+void simulatorimpl::add_clock(const sdata_type& port, uint32_t period, uint32_t phase) {
+  auto& inputs = eval_ctx_->inputs();
+  auto it = std::find_if(inputs.begin(), inputs.end(), [&](lnodeimpl* node) {
+    return (reinterpret_cast<ioportimpl*>(node)->value().get() == &port);
+  });
+  CH_CHECK(it != inputs.end() && *it != eval_ctx_->sys_clk(), "invalid clock port");
+
+  if (clk_scheduler_.empty()) {
+    // the system clock moves to the scheduler
+    auto clk = eval_ctx_->sys_clk();
+    if (clk) {
+      clk_scheduler_.add_clock(clk, 2, 0, lanes_);
+    }
+  }
+  clk_scheduler_.add_clock(reinterpret_cast<ioportimpl*>(*it), period, phase, lanes_);
+}
+
+static constexpr uint32_t CHECKPOINT_MAGIC   = 0x504b4843; // "CHKP"
+static constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+static void write_word(std::ostream& out, uint32_t value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(uint32_t));
+}
+
+static uint32_t read_word(std::istream& in) {
+  uint32_t value = 0;
+  in.read(reinterpret_cast<char*>(&value), sizeof(uint32_t));
+  CH_CHECK(in.good(), "invalid checkpoint");
+  return value;
+}
+
+static void write_data(std::ostream& out, uint32_t id, const sdata_type& data) {
+  write_word(out, id);
+  write_word(out, data.size());
+  out.write(reinterpret_cast<const char*>(data.words()), data.num_words() * sizeof(block_type));
+}
+
+static void read_data(std::istream& in, sdata_type& data) {
+  in.read(reinterpret_cast<char*>(data.words()), data.num_words() * sizeof(block_type));
+  CH_CHECK(in.good(), "invalid checkpoint");
+}
+
+void simulatorimpl::checkpoint(std::ostream& out) {
+  if (jit_ready_) {
+    this->swap_driver();
+  }
+
+  std::vector<ioportimpl*> ports;
+  for (auto list : {&eval_ctx_->inputs(), &eval_ctx_->outputs(), &eval_ctx_->taps()}) {
+    for (auto node : *list) {
+      ports.push_back(reinterpret_cast<ioportimpl*>(node));
+    }
+  }
+
+  write_word(out, CHECKPOINT_MAGIC);
+  write_word(out, CHECKPOINT_VERSION);
+  write_word(out, lanes_.count());
+  write_word(out, clk_driver_.value());
+  write_word(out, reset_driver_.value());
+
+  sim_state state;
+  for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+    write_word(out, ports.size());
+    for (auto port : ports) {
+      write_data(out, port->id(), *lanes_.port(i, port));
+    }
+
+    // sort entries for a stable layout
+    state.clear();
+    sim_driver_->save_state(i, state);
+    std::map<uint32_t, const sdata_type*> sorted;
+    for (auto& entry : state) {
+      sorted[entry.first] = &entry.second;
+    }
+    write_word(out, sorted.size());
+    for (auto& entry : sorted) {
+      write_data(out, entry.first, *entry.second);
+    }
   }
 }
 
+void simulatorimpl::restore(std::istream& in) {
+  if (jit_ready_) {
+    this->swap_driver();
+  }
+
+  std::unordered_map<uint32_t, ioportimpl*> ports;
+  for (auto list : {&eval_ctx_->inputs(), &eval_ctx_->outputs(), &eval_ctx_->taps()}) {
+    for (auto node : *list) {
+      ports[node->id()] = reinterpret_cast<ioportimpl*>(node);
+    }
+  }
+
+  CH_CHECK(read_word(in) == CHECKPOINT_MAGIC, "invalid checkpoint");
+  CH_CHECK(read_word(in) == CHECKPOINT_VERSION, "unsupported checkpoint version");
+  CH_CHECK(read_word(in) == lanes_.count(), "checkpoint lanes mismatch");
+  auto clk_value = (0 != read_word(in));
+  auto reset_value = (0 != read_word(in));
+
+  sim_state state;
+  for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+    for (uint32_t k = 0, m = read_word(in); k < m; ++k) {
+      auto id = read_word(in);
+      auto size = read_word(in);
+      auto it = ports.find(id);
+      CH_CHECK(it != ports.end() && it->second->size() == size, "incompatible checkpoint");
+      read_data(in, *lanes_.port(i, it->second));
+    }
+
+    // use the current layout to validate the saved entries
+    state.clear();
+    sim_driver_->save_state(i, state);
+    auto num_entries = read_word(in);
+    CH_CHECK(num_entries == state.size(), "incompatible checkpoint");
+    for (uint32_t k = 0; k < num_entries; ++k) {
+      auto id = read_word(in);
+      auto size = read_word(in);
+      auto it = state.find(id);
+      CH_CHECK(it != state.end() && it->second.size() == size, "incompatible checkpoint");
+      read_data(in, it->second);
+    }
+    sim_driver_->load_state(i, state);
+  }
+
+  clk_driver_.set_value(clk_value);
+  reset_driver_.set_value(reset_value);
+}
+
 void simulatorimpl::eval() {
+  if (jit_ready_) {
+    this->swap_driver();
+  }
   sim_driver_->eval();
 }
 
+void simulatorimpl::wait_jit() {
+  if (jit_driver_) {
+    this->swap_driver();
+  }
+}
+
+void simulatorimpl::swap_driver() {
+#if defined(LIBJIT) || defined(LLVMJIT)
+  jit_thread_.join();
+  jit_ready_ = false;
+  auto jit_driver = jit_driver_;
+  jit_driver_ = nullptr;
+  if (jit_error_) {
+    jit_driver->release();
+    std::rethrow_exception(jit_error_);
+  }
+
+  // carry the sequential state over to the native driver
+  sim_state state;
+  for (uint32_t i = 0, n = lanes_.count(); i < n; ++i) {
+    state.clear();
+    sim_driver_->save_state(i, state);
+    jit_driver->load_state(i, state);
+  }
+  sim_driver_->release();
+  sim_driver_ = jit_driver;
+  ++num_jit_swaps_;
+#endif
+}
+
+void simulatorimpl::dump_stats(std::ostream& out) const {
+  out << "ch-stats: simulation lanes = " << lanes_.count() << std::endl;
+  sim_driver_->dump_stats(out);
+}
+
+void simulatorimpl::poke(uint32_t lane, const sdata_type& port, const sdata_type& value) {
+  *lanes_.port(lane, port) = value;
+}
+
+const sdata_type& simulatorimpl::peek(uint32_t lane, const sdata_type& port) const {
+  return *lanes_.port(lane, port);
+}
+
 ch_tick simulatorimpl::reset(ch_tick t) {
   if (!reset_driver_.empty()) {
     reset_driver_.eval();
@@ -125,7 +495,20 @@ ch_tick simulatorimpl::reset(ch_tick t) {
 }
 
 ch_tick simulatorimpl::step(ch_tick t, uint32_t count) {
+  profile_timer timer(profile_counter::simulate);
+  if (platform::self().profiling()) {
+    platform::self().add_profile(profile_counter::ticks, count);
+  }
   auto ret = t + count;
+  if (!clk_scheduler_.empty()) {
+    // the first tick picks up poked inputs, the others need a clock edge
+    clk_scheduler_.eval(t);
+    while (t < ret) {
+      this->eval();
+      t = edge_only_ ? std::min(clk_scheduler_.next_edge(t), ret) : (t + 1);
+      clk_scheduler_.eval(t);
+    }
+  } else
   if (clk_driver_.empty()) {
     while (count--) {
       this->eval();
@@ -159,8 +542,13 @@ void simulatorimpl::run(ch_tick num_ticks) {
 
 ch_simulator::ch_simulator() : impl_(nullptr) {}
 
-ch_simulator::ch_simulator(const std::vector<device_base>& devices) {
-  impl_ = new simulatorimpl(devices);
+ch_simulator::ch_simulator(const std::vector<device_base>& devices)
+  : ch_simulator(devices, ch_simopts())
+{}
+
+ch_simulator::ch_simulator(const std::vector<device_base>& devices,
+                           const ch_simopts& options) {
+  impl_ = new simulatorimpl(devices, options);
   impl_->acquire();
 
   // initialize
@@ -230,3 +618,51 @@ ch_tick ch_simulator::step(ch_tick t, uint32_t count) {
 void ch_simulator::eval() {
   impl_->eval();
 }
+
+uint32_t ch_simulator::num_lanes() const {
+  return impl_->num_lanes();
+}
+
+uint32_t ch_simulator::num_threads() const {
+  return impl_->num_threads();
+}
+
+void ch_simulator::wait_jit() {
+  impl_->wait_jit();
+}
+
+uint32_t ch_simulator::num_jit_swaps() const {
+  return impl_->num_jit_swaps();
+}
+
+void ch_simulator::poke_data(uint32_t lane, const sdata_type& port, const sdata_type& value) {
+  impl_->poke(lane, port, value);
+}
+
+const sdata_type& ch_simulator::peek_data(uint32_t lane, const sdata_type& port) const {
+  return impl_->peek(lane, port);
+}
+
+void ch_simulator::add_clock_data(const sdata_type& port, uint32_t period, uint32_t phase) {
+  impl_->add_clock(port, period, phase);
+}
+
+void ch_simulator::checkpoint(std::ostream& out) const {
+  impl_->checkpoint(out);
+}
+
+void ch_simulator::restore(std::istream& in) {
+  impl_->restore(in);
+}
+
+ch_simulator ch_simulator::fork() const {
+  return ch_simulator(new simulatorimpl(*impl_));
+}
+
+void ch::internal::ch_stats(std::ostream& out, const ch_simulator& simulator) {
+  simulator.impl()->dump_stats(out);
+}
+
+ch_opt_stats ch::internal::ch_optstats(const ch_simulator& simulator) {
+  return simulator.impl()->eval_ctx()->opt_stats();
+}
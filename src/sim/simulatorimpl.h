@@ -1,13 +1,23 @@
 #pragma once
 
-#include "device.h"
+#include "simulator.h"
+#include <thread>
 
 namespace ch {
 namespace internal {
 
 class inputimpl;
+class ioportimpl;
+class worker_pool;
 using io_value_t = smart_ptr<sdata_type>;
 
+namespace simjit {
+class driver;
+}
+
+// sequential state of a simulation lane indexed by node id
+using sim_state = std::unordered_map<uint32_t, sdata_type>;
+
 class clock_driver {
 public:
 
@@ -15,12 +25,20 @@ public:
 
   void add_signal(inputimpl* node);
 
+  void add_signal(const io_value_t& value);
+
   void eval();
 
   bool empty() const {
     return nodes_.empty();
   }
 
+  bool value() const {
+    return value_;
+  }
+
+  void set_value(bool value);
+
 protected:
 
   std::vector<io_value_t> nodes_;
@@ -46,6 +64,67 @@ protected:
   uint64_t value_;
 };
 
+class sim_lanes {
+public:
+
+  sim_lanes(uint32_t count = 1) : count_(count) {}
+
+  // copy of the lanes with their own port buffers
+  void fork(const sim_lanes& other);
+
+  uint32_t count() const {
+    return count_;
+  }
+
+  void add_port(ioportimpl* node);
+
+  const io_value_t& port(uint32_t lane, ioportimpl* node) const;
+
+  const io_value_t& port(uint32_t lane, const sdata_type& value) const;
+
+protected:
+
+  // per-lane buffers indexed by the lane 0 port value
+  std::unordered_map<const sdata_type*, std::vector<io_value_t>> ports_;
+  uint32_t count_;
+};
+
+class clock_scheduler {
+public:
+
+  clock_scheduler() {}
+
+  void add_clock(ioportimpl* node,
+                 uint32_t period,
+                 uint32_t phase,
+                 const sim_lanes& lanes);
+
+  // drive all clocks to their level at the given tick
+  void eval(ch_tick t);
+
+  // first tick after t at which a clock toggles
+  ch_tick next_edge(ch_tick t) const;
+
+  bool empty() const {
+    return clocks_.empty();
+  }
+
+  struct clock_t {
+    ioportimpl* node;
+    uint32_t period;
+    uint32_t phase;
+    std::vector<io_value_t> signals;
+  };
+
+  const auto& clocks() const {
+    return clocks_;
+  }
+
+protected:
+
+  std::vector<clock_t> clocks_;
+};
+
 class sim_driver : public refcounted {
 public:
 
@@ -53,15 +132,30 @@ public:
 
   virtual ~sim_driver() {}
 
-  virtual void initialize(const std::vector<lnodeimpl*>&) = 0;
+  virtual void initialize(const std::vector<lnodeimpl*>& eval_list,
+                          const sim_lanes& lanes) = 0;
 
   virtual void eval() = 0;
+
+  // copy of the driver and its state bound to the given lanes
+  virtual sim_driver* fork(const std::vector<lnodeimpl*>& eval_list,
+                           const sim_lanes& lanes) const = 0;
+
+  virtual void save_state(uint32_t lane, sim_state& state) const = 0;
+
+  virtual void load_state(uint32_t lane, const sim_state& state) = 0;
+
+  virtual void dump_stats(std::ostream&) const {}
 };
 
 class simulatorimpl : public refcounted {
 public:
 
-  simulatorimpl(const std::vector<device_base>& devices);
+  simulatorimpl(const std::vector<device_base>& devices,
+                const ch_simopts& options = ch_simopts());
+
+  // fork of another simulator, sharing its design and compiled code
+  simulatorimpl(simulatorimpl& other);
 
   virtual ~simulatorimpl();
 
@@ -77,14 +171,56 @@ public:
 
   virtual void eval();
 
+  uint32_t num_lanes() const {
+    return lanes_.count();
+  }
+
+  uint32_t num_threads() const {
+    return num_threads_;
+  }
+
+  context* eval_ctx() const {
+    return eval_ctx_;
+  }
+
+  void dump_stats(std::ostream& out) const;
+
+  void poke(uint32_t lane, const sdata_type& port, const sdata_type& value);
+
+  const sdata_type& peek(uint32_t lane, const sdata_type& port) const;
+
+  void add_clock(const sdata_type& port, uint32_t period, uint32_t phase);
+
+  void wait_jit();
+
+  uint32_t num_jit_swaps() const {
+    return num_jit_swaps_;
+  }
+
+  void checkpoint(std::ostream& out);
+
+  void restore(std::istream& in);
+
 protected:  
 
+  void swap_driver();
+
   std::vector<context*> contexts_;
   context* eval_ctx_;
+  std::vector<lnodeimpl*> eval_list_;
   clock_driver clk_driver_;
   clock_driver reset_driver_;
+  clock_scheduler clk_scheduler_;
   sim_driver* sim_driver_;
+  simjit::driver* jit_driver_;
+  std::thread jit_thread_;
+  std::atomic<bool> jit_ready_;
+  std::exception_ptr jit_error_;
+  uint32_t num_jit_swaps_;
+  sim_lanes lanes_;
+  uint32_t num_threads_;
   bool verbose_tracing_;
+  bool edge_only_;
 };
 
 }
@@ -4,6 +4,10 @@
 #include "moduleimpl.h"
 #include "context.h"
 #include "verilogwriter.h"
+#include "waveform.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 
 using namespace ch::internal;
 
@@ -30,6 +34,182 @@ auto remove_path = [](const std::string& path) {
   return (pos != std::string::npos) ? path.substr(pos+1) : path;
 };
 
+// encodes full trace blocks and writes them to a file on a background thread
+class tracerimpl::streamer {
+public:
+
+  streamer(const tracerimpl* tracer,
+           const std::string& file,
+           trace_format format,
+           uint32_t block_width,
+           uint32_t max_blocks)
+    : tracer_(tracer)
+    , file_(file)
+    , out_(file, (trace_format::cwf == format) ? std::ios::binary : std::ios::out)
+    , format_(format)
+    , block_width_(block_width)
+    , max_blocks_(max_blocks)
+    , batch_size_(max_blocks / 2)
+    , num_blocks_(0)
+    , tick_(0)
+    , closing_(false) {
+    CH_CHECK(out_.is_open(), "failed to open file '%s'", file.c_str());
+    cursor_.tick = 0;
+    cursor_.values.resize(tracer->signals_.size());
+    if (trace_format::vcd == format_) {
+      tracer_->vcd_header(out_);
+    } else if (trace_format::cwf == format_) {
+      cwf_.reset(new cwf_writer(out_, tracer_->cwf_signals()));
+    }
+    thread_ = std::thread([this]() { this->run(); });
+  }
+
+  ~streamer() {
+    this->stop();
+    for (auto block : free_) {
+      destroy_block(block);
+    }
+  }
+
+  // returns an empty block, waits for the writer when all blocks are in flight
+  trace_block_t* acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() { return !free_.empty() || num_blocks_ < max_blocks_; });
+    if (free_.empty()) {
+      ++num_blocks_;
+      return create_block(block_width_);
+    }
+    auto block = free_.back();
+    free_.pop_back();
+    lock.unlock();
+    std::fill_n(block->data, ceildiv(block_width_, bitwidth_v<block_t>), 0);
+    block->size = 0;
+    return block;
+  }
+
+  void push(trace_block_t* block) {
+    bool notify;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(block);
+      notify = (pending_.size() >= batch_size_);
+    }
+    // the writer is woken up per batch to limit context switches
+    if (notify) {
+      cv_.notify_all();
+    }
+  }
+
+  // writes the pending blocks and reports writer errors
+  void close(uint64_t ticks) {
+    this->stop();
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    if (cwf_) {
+      cwf_->close(ticks);
+    }
+    out_.close();
+    CH_CHECK(!out_.fail(), "failed to write file '%s'", file_.c_str());
+
+    // text indices are padded to the width of the last tick,
+    // which is only known now.
+    auto indices_width = std::to_string(ticks).length();
+    if (trace_format::text == format_ && indices_width > 1) {
+      auto tmp_file = file_ + ".tmp";
+      {
+        std::ifstream in(file_);
+        std::ofstream out(tmp_file);
+        std::string line;
+        while (std::getline(in, line)) {
+          auto pos = std::min(line.find(':'), indices_width);
+          out << std::string(indices_width - pos, ' ') << line << '\n';
+        }
+        CH_CHECK(!out.fail(), "failed to write file '%s'", tmp_file.c_str());
+      }
+      CH_CHECK(0 == std::rename(tmp_file.c_str(), file_.c_str()),
+               "failed to rename file '%s'", tmp_file.c_str());
+    }
+  }
+
+private:
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void run() {
+    for (;;) {
+      std::deque<trace_block_t*> blocks;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]() { return pending_.size() >= batch_size_ || closing_; });
+        if (pending_.empty())
+          break;
+        blocks.swap(pending_);
+      }
+      for (auto block : blocks) {
+        if (!error_) {
+          try {
+            this->write(block);
+          } catch (...) {
+            error_ = std::current_exception();
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          free_.push_back(block);
+        }
+        cv_.notify_all();
+      }
+    }
+    out_.flush();
+  }
+
+  void write(const trace_block_t* block) {
+    switch (format_) {
+    case trace_format::text:
+      tracer_->text_block(out_, block, 0, cursor_);
+      break;
+    case trace_format::vcd:
+      tracer_->vcd_block(out_, block, tick_);
+      break;
+    case trace_format::cwf:
+      tracer_->cwf_block(*cwf_, block, tick_);
+      break;
+    }
+    CH_CHECK(!out_.fail(), "failed to write file '%s'", file_.c_str());
+  }
+
+  const tracerimpl* tracer_;
+  std::string file_;
+  std::ofstream out_;
+  trace_format format_;
+  uint32_t block_width_;
+  uint32_t max_blocks_;
+  uint32_t batch_size_;
+  uint32_t num_blocks_;
+  text_cursor_t cursor_;
+  std::unique_ptr<cwf_writer> cwf_;
+  uint64_t tick_;
+  std::deque<trace_block_t*> pending_;
+  std::vector<trace_block_t*> free_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread thread_;
+  std::exception_ptr error_;
+  bool closing_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 tracerimpl::tracerimpl(const std::vector<device_base>& devices)
   : simulatorimpl(devices)
   , trace_width_(0)
@@ -37,6 +217,8 @@ tracerimpl::tracerimpl(const std::vector<device_base>& devices)
   , trace_head_(nullptr)
   , trace_tail_(nullptr)
   , num_traces_(0)
+  , streamer_(nullptr)
+  , is_streamed_(false)
   , is_single_context_(1 == contexts_.size() && 0 == contexts_.back()->modules().size()) {
   if ((platform::self().cflags() & ch_flags::verbose_tracing) != 0) {
     verbose_tracing_ = true;
@@ -44,11 +226,16 @@ tracerimpl::tracerimpl(const std::vector<device_base>& devices)
 }
 
 tracerimpl::~tracerimpl() {
+  if (streamer_) {
+    // complete the file, errors can only be reported by close_stream()
+    try {
+      this->close_stream();
+    } catch (...) {}
+  }
   auto block = trace_head_;
   while (block) {
     auto next = block->next;
-    block->~trace_block_t();
-    ::operator delete [](block);
+    destroy_block(block);
     block = next;
   }
 }
@@ -57,6 +244,9 @@ void tracerimpl::initialize() {
   //--
   simulatorimpl::initialize();
 
+  // traces are recorded for every tick
+  edge_only_ = false;
+
   //--
   auto add_signal = [&](ioportimpl* node) {
     signals_.emplace_back(node);
@@ -101,6 +291,10 @@ void tracerimpl::eval() {
   // advance simulation
   simulatorimpl::eval();
 
+  // a closed stream ends the trace
+  if (is_streamed_ && nullptr == streamer_)
+    return;
+
   // allocate new trace block
   auto block_width = NUM_TRACES * trace_width_;
   if (nullptr == trace_tail_
@@ -139,10 +333,15 @@ void tracerimpl::eval() {
 }
 
 void tracerimpl::allocate_trace(uint32_t block_width) {
-  auto block_size = (bitwidth_v<block_t> / 8) * ceildiv(block_width, bitwidth_v<block_t>);
-  auto buf = new uint8_t[sizeof(trace_block_t) + block_size]();
-  auto data = reinterpret_cast<block_t*>(buf + sizeof(trace_block_t));
-  auto trace_block = new (buf) trace_block_t(data);
+  if (streamer_) {
+    if (trace_tail_) {
+      this->flush_trace();
+    }
+    trace_tail_ = streamer_->acquire();
+    ++num_traces_;
+    return;
+  }
+  auto trace_block = create_block(block_width);
   if (nullptr == trace_head_) {
     trace_head_ = trace_block;
   }
@@ -153,7 +352,69 @@ void tracerimpl::allocate_trace(uint32_t block_width) {
   ++num_traces_;
 }
 
-void tracerimpl::toText(std::ofstream& out) const {
+void tracerimpl::flush_trace() {
+  // the block is released once written,
+  // the values eval() compares against are kept aside
+  for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+    auto& prev = prev_values_.at(i);
+    if (prev.first != trace_tail_->data)
+      continue;
+    bv_copy(stream_values_.data(), stream_offsets_[i],
+            prev.first, prev.second, signals_[i]->size());
+    prev.first = stream_values_.data();
+    prev.second = stream_offsets_[i];
+  }
+  streamer_->push(trace_tail_);
+  trace_tail_ = nullptr;
+}
+
+tracerimpl::trace_block_t* tracerimpl::create_block(uint32_t block_width) {
+  auto block_size = (bitwidth_v<block_t> / 8) * ceildiv(block_width, bitwidth_v<block_t>);
+  auto buf = new uint8_t[sizeof(trace_block_t) + block_size]();
+  auto data = reinterpret_cast<block_t*>(buf + sizeof(trace_block_t));
+  return new (buf) trace_block_t(data);
+}
+
+void tracerimpl::destroy_block(trace_block_t* block) {
+  block->~trace_block_t();
+  delete [] reinterpret_cast<uint8_t*>(block);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void tracerimpl::stream(const std::string& file, trace_format format, uint32_t max_blocks) {
+  CH_CHECK(0 == ticks_ && !is_streamed_, "streaming should start before the simulation");
+  CH_CHECK(max_blocks >= 2, "streaming needs at least two trace blocks");
+
+  // storage for the values eval() compares against once their block is written
+  uint32_t width = 0;
+  stream_offsets_.resize(signals_.size());
+  for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+    stream_offsets_[i] = width;
+    width += signals_[i]->size();
+  }
+  stream_values_.resize(ceildiv(width, bitwidth_v<block_t>));
+
+  streamer_ = new streamer(this, file, format, NUM_TRACES * trace_width_, max_blocks);
+  is_streamed_ = true;
+}
+
+void tracerimpl::close_stream() {
+  CH_CHECK(streamer_, "the trace is not streamed");
+  if (trace_tail_) {
+    this->flush_trace();
+  }
+  std::unique_ptr<streamer> stream(streamer_);
+  streamer_ = nullptr;
+  stream->close(ticks_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void tracerimpl::text_block(std::ostream& out,
+                            const trace_block_t* block,
+                            uint32_t indices_width,
+                            text_cursor_t& cursor) const {
   //--
   auto get_signal_name = [&](ioportimpl* node) {
     if (!is_single_context_ && 1 == contexts_.size()) {
@@ -162,55 +423,53 @@ void tracerimpl::toText(std::ofstream& out) const {
     return node->name();
   };
 
-  uint32_t t = 0;
   auto mask_width = valid_mask_.size();
-  auto indices_width = std::to_string(ticks_).length();
-
-  std::vector<std::pair<block_t*, uint32_t>> 
-      prev_values(signals_.size(), std::make_pair<block_t*, uint32_t>(nullptr, 0));
-
-  auto trace_block = trace_head_;
-  while (trace_block) {
-    auto src_block = trace_block->data;
-    auto src_width = trace_block->size;
-    uint32_t src_offset = 0;
-    while (src_offset < src_width) {
-      uint32_t mask_offset = src_offset;
-      src_offset += mask_width;
-      out << std::setw(indices_width) << t << ":";
-      auto_separator sep(",");
-      for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
-        auto signal = signals_[i];
-        auto signal_type = signal->type();
-        auto signal_size = signal->size();
-        auto signal_name = get_signal_name(signal);
-        bool valid = bv_get(src_block, mask_offset + i);
-        if (valid) {
-          auto value = get_value(src_block, signal_size, src_offset);
+  auto src_block = block->data;
+  auto src_width = block->size;
+  uint32_t src_offset = 0;
+  while (src_offset < src_width) {
+    uint32_t mask_offset = src_offset;
+    src_offset += mask_width;
+    out << std::setw(indices_width) << cursor.tick << ":";
+    auto_separator sep(",");
+    for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+      auto signal = signals_[i];
+      auto signal_type = signal->type();
+      auto signal_size = signal->size();
+      auto signal_name = get_signal_name(signal);
+      bool valid = bv_get(src_block, mask_offset + i);
+      if (valid) {
+        auto value = get_value(src_block, signal_size, src_offset);
+        out << sep << " " << signal_name << "=" << value;
+        if (type_input != signal_type) {
+          cursor.values.at(i) = std::move(value);
+        }
+        src_offset += signal_size;
+      } else {
+        if (type_input != signal_type) {
+          auto& value = cursor.values.at(i);
+          assert(!value.empty());
           out << sep << " " << signal_name << "=" << value;
-          if (type_input != signal_type) {
-            auto& prev = prev_values.at(i);
-            prev.first = src_block;
-            prev.second = src_offset;
-          }
-          src_offset += signal_size;
-        } else {
-          if (type_input != signal_type) {
-            auto& prev = prev_values.at(i);
-            assert(prev.first);
-            auto value = get_value(prev.first, signal_size, prev.second);
-            out << sep << " " << signal_name << "=" << value;
-          }
         }
       }
-      out << std::endl;
-      ++t;
     }
-    trace_block = trace_block->next;
+    out << '\n';
+    ++cursor.tick;
   }
 }
 
-void tracerimpl::toVCD(std::ofstream& out) const {  
+void tracerimpl::toText(std::ofstream& out) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+  text_cursor_t cursor;
+  cursor.tick = 0;
+  cursor.values.resize(signals_.size());
+  auto indices_width = std::to_string(ticks_).length();
+  for (auto block = trace_head_; block; block = block->next) {
+    this->text_block(out, block, indices_width, cursor);
+  }
+}
+
+void tracerimpl::vcd_header(std::ostream& out) const {
   dup_tracker<std::string> dup_mod_names;
   std::list<std::string> mod_stack;
 
@@ -270,55 +529,106 @@ void tracerimpl::toVCD(std::ofstream& out) const {
     mod_stack.pop_back();
   }  
   out << "$enddefinitions $end" << std::endl;
+}
 
-  // log trace data
-  uint32_t t = 0;
+void tracerimpl::vcd_block(std::ostream& out, const trace_block_t* block, uint64_t& tick) const {
+  std::string bits;
   auto mask_width = valid_mask_.size();
-
-  auto trace_block = trace_head_;
-  while (trace_block) {
-    auto src_block = trace_block->data;
-    auto src_width = trace_block->size;
-    uint32_t src_offset = 0;
-    while (src_offset < src_width) {
-      uint32_t mask_offset = src_offset;
-      src_offset += mask_width;
-      bool new_trace = false;
-      for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
-        bool valid = bv_get(src_block, mask_offset + i);
-        if (valid) {
-          if (!new_trace) {
-            out << '#' << t << std::endl;
-            new_trace = true;
-          }
-          auto signal = signals_[i];
-          auto signal_size = signal->size();
-          auto value = get_value(src_block, signal_size, src_offset);
-          src_offset += signal_size;
-          if (signal_size > 1) {
-            out << 'b';
-          }
-          size_t q = 0;
-          for (auto it = value.rbegin(), end = value.rend(); it != end;) {
-            ++q;
-            out << (*it++ ? '1' : '0');            
-          }
-          if (signal_size > 1)
-            out << ' ';
-          out << signal->id() << std::endl;
+  auto src_block = block->data;
+  auto src_width = block->size;
+  uint32_t src_offset = 0;
+  while (src_offset < src_width) {
+    uint32_t mask_offset = src_offset;
+    src_offset += mask_width;
+    bool new_trace = false;
+    for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+      bool valid = bv_get(src_block, mask_offset + i);
+      if (valid) {
+        if (!new_trace) {
+          out << '#' << tick << '\n';
+          new_trace = true;
         }
+        auto signal = signals_[i];
+        auto signal_size = signal->size();
+        // format the bits from the msb in one write
+        bits.clear();
+        if (signal_size > 1) {
+          bits.push_back('b');
+        }
+        for (uint32_t j = signal_size; j--;) {
+          bits.push_back(bv_get(src_block, src_offset + j) ? '1' : '0');
+        }
+        if (signal_size > 1) {
+          bits.push_back(' ');
+        }
+        src_offset += signal_size;
+        out << bits << signal->id() << '\n';
       }
-      if (new_trace)
-        out << std::endl;
-      ++t;
     }
-    trace_block = trace_block->next;
+    if (new_trace)
+      out << '\n';
+    ++tick;
+  }
+}
+
+void tracerimpl::toVCD(std::ofstream& out) const {  
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+  this->vcd_header(out);
+
+  // log trace data
+  uint64_t tick = 0;
+  for (auto block = trace_head_; block; block = block->next) {
+    this->vcd_block(out, block, tick);
+  }
+}
+
+std::vector<std::pair<std::string, uint32_t>> tracerimpl::cwf_signals() const {
+  // signals are named as in text traces
+  std::vector<std::pair<std::string, uint32_t>> signals;
+  for (auto node : signals_) {
+    auto name = node->name();
+    if (!is_single_context_ && 1 == contexts_.size()) {
+      name = remove_path(name);
+    }
+    signals.emplace_back(name, node->size());
+  }
+  return signals;
+}
+
+void tracerimpl::cwf_block(cwf_writer& writer, const trace_block_t* block, uint64_t& tick) const {
+  auto mask_width = valid_mask_.size();
+  auto src_block = block->data;
+  auto src_width = block->size;
+  uint32_t src_offset = 0;
+  while (src_offset < src_width) {
+    uint32_t mask_offset = src_offset;
+    src_offset += mask_width;
+    writer.begin_tick(tick);
+    for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+      if (bv_get(src_block, mask_offset + i)) {
+        writer.set_value(i, src_block, src_offset);
+        src_offset += signals_[i]->size();
+      }
+    }
+    ++tick;
   }
 }
 
+void tracerimpl::toCWF(std::ofstream& out) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+  cwf_writer writer(out, this->cwf_signals());
+  uint64_t tick = 0;
+  for (auto block = trace_head_; block; block = block->next) {
+    this->cwf_block(writer, block, tick);
+  }
+  writer.close(ticks_);
+}
+
 void tracerimpl::toVerilog(std::ofstream& out,
                            const std::string& moduleFileName,
                            bool passthru) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+
   //--
   auto netlist_name = [&](lnodeimpl* node)->std::string {
     std::stringstream ss;
@@ -601,6 +911,8 @@ void tracerimpl::toVerilog(std::ofstream& out,
 
 void tracerimpl::toVerilator(std::ofstream& out,
                              const std::string& moduleTypeName) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+
   //--
   auto get_signal_name = [&](ioportimpl* node) {
     auto path = node->name();
@@ -799,6 +1111,8 @@ void tracerimpl::toVerilator(std::ofstream& out,
 
 void tracerimpl::toSystemC(std::ofstream& out,
                            const std::string& moduleTypeName) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+
   //--
   auto get_signal_name = [&](ioportimpl* node) {
     auto path = node->name();
@@ -1479,6 +1793,8 @@ void tracerimpl::toVPI_v(std::ofstream& out, const std::string& moduleFileName)
 void tracerimpl::toVPI(const std::string& vfile, 
                        const std::string& cfile, 
                        const std::string& moduleFileName) const {
+  CH_CHECK(!is_streamed_, "the trace was streamed to a file");
+
   {
     std::ofstream out(vfile);
     this->toVPI_v(out, moduleFileName);
@@ -1522,6 +1838,26 @@ void ch_tracer::toVCD(std::ofstream& out) {
   return reinterpret_cast<tracerimpl*>(impl_)->toVCD(out);
 }
 
+void ch_tracer::toCWF(std::ofstream& out) {
+  return reinterpret_cast<tracerimpl*>(impl_)->toCWF(out);
+}
+
+void ch_tracer::streamText(const std::string& file, uint32_t max_blocks) {
+  reinterpret_cast<tracerimpl*>(impl_)->stream(file, trace_format::text, max_blocks);
+}
+
+void ch_tracer::streamVCD(const std::string& file, uint32_t max_blocks) {
+  reinterpret_cast<tracerimpl*>(impl_)->stream(file, trace_format::vcd, max_blocks);
+}
+
+void ch_tracer::streamCWF(const std::string& file, uint32_t max_blocks) {
+  reinterpret_cast<tracerimpl*>(impl_)->stream(file, trace_format::cwf, max_blocks);
+}
+
+void ch_tracer::closeStream() {
+  reinterpret_cast<tracerimpl*>(impl_)->close_stream();
+}
+
 void ch_tracer::toVerilog(std::ofstream& out,
                           const std::string& moduleFileName,
                           bool passthru) {
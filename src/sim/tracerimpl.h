@@ -6,6 +6,14 @@
 namespace ch {
 namespace internal {
 
+class cwf_writer;
+
+enum class trace_format {
+  text,
+  vcd,
+  cwf,
+};
+
 class tracerimpl : public simulatorimpl {
 public:
 
@@ -19,6 +27,14 @@ public:
 
   void toVCD(std::ofstream& out) const;
 
+  void toCWF(std::ofstream& out) const;
+
+  // writes the trace to a file while simulating,
+  // holding at most max_blocks trace blocks in memory
+  void stream(const std::string& file, trace_format format, uint32_t max_blocks);
+
+  void close_stream();
+
   void toVerilog(std::ofstream& out,
                  const std::string& moduleFileName,
                  bool passthru) const;
@@ -51,10 +67,37 @@ protected:
     trace_block_t* next;
   };
 
+  // last value of each signal carried across text blocks
+  struct text_cursor_t {
+    uint64_t tick;
+    std::vector<bv_t> values;
+  };
+
+  class streamer;
+
   void eval() override;
 
   void allocate_trace(uint32_t block_width);
 
+  void flush_trace();
+
+  static trace_block_t* create_block(uint32_t block_width);
+
+  static void destroy_block(trace_block_t* block);
+
+  void text_block(std::ostream& out,
+                  const trace_block_t* block,
+                  uint32_t indices_width,
+                  text_cursor_t& cursor) const;
+
+  void vcd_header(std::ostream& out) const;
+
+  void vcd_block(std::ostream& out, const trace_block_t* block, uint64_t& tick) const;
+
+  std::vector<std::pair<std::string, uint32_t>> cwf_signals() const;
+
+  void cwf_block(cwf_writer& writer, const trace_block_t* block, uint64_t& tick) const;
+
   static auto get_value(const block_t* src, uint32_t size, uint32_t src_offset) {
     bv_t value(size);
     bv_copy(value.words(), 0, src, src_offset, size);
@@ -73,6 +116,10 @@ protected:
   trace_block_t* trace_head_;
   trace_block_t* trace_tail_;
   uint32_t num_traces_;
+  streamer* streamer_;
+  std::vector<block_t> stream_values_;
+  std::vector<uint32_t> stream_offsets_;
+  bool is_streamed_;
   bool is_single_context_;
 };
 
@@ -0,0 +1,332 @@
+#include "waveform.h"
+#include "tracer.h"
+#include <zlib.h>
+
+using namespace ch::internal;
+
+namespace {
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t get_varint(const uint8_t*& in, const uint8_t* end) {
+  uint64_t value = 0;
+  for (uint32_t shift = 0; in < end && shift < 64; shift += 7) {
+    auto byte = *in++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (0 == (byte & 0x80))
+      return value;
+  }
+  throw std::runtime_error("corrupted waveform data");
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+cwf_writer::cwf_writer(std::ostream& out,
+                       const std::vector<std::pair<std::string, uint32_t>>& signals)
+  : out_(out)
+  , offset_(0)
+  , frame_start_(0)
+  , tick_(0)
+  , frame_open_(false) {
+  signals_.resize(signals.size());
+  uint32_t max_width = 0;
+  for (uint32_t i = 0, n = signals.size(); i < n; ++i) {
+    signals_[i].width = signals[i].second;
+    signals_[i].last_tick = 0;
+    max_width = std::max(max_width, signals[i].second);
+  }
+  words_.resize(ceildiv(max_width, 64));
+
+  // header
+  uint32_t header[] = {CWF_MAGIC, CWF_VERSION, static_cast<uint32_t>(signals.size())};
+  this->write(header, sizeof(header));
+  for (auto& signal : signals) {
+    uint32_t desc[] = {signal.second, static_cast<uint32_t>(signal.first.size())};
+    this->write(desc, sizeof(desc));
+    this->write(signal.first.data(), signal.first.size());
+  }
+}
+
+void cwf_writer::begin_tick(uint64_t tick) {
+  if (frame_open_ && tick - frame_start_ >= FRAME_TICKS) {
+    this->flush_frame(tick);
+  }
+  if (!frame_open_) {
+    this->open_frame(tick);
+  }
+  tick_ = tick;
+}
+
+void cwf_writer::set_value(uint32_t signal, const uint64_t* src, uint32_t src_offset) {
+  auto& s = signals_.at(signal);
+  auto num_bytes = ceildiv(s.width, 8);
+  std::fill(words_.begin(), words_.end(), 0);
+  bv_copy(words_.data(), 0, src, src_offset, s.width);
+  auto bytes = reinterpret_cast<const uint8_t*>(words_.data());
+  if (tick_ == frame_start_) {
+    // replaces the carried value at the frame start
+    s.data.assign(bytes, bytes + num_bytes);
+  } else {
+    put_varint(s.data, tick_ - s.last_tick);
+    s.data.insert(s.data.end(), bytes, bytes + num_bytes);
+  }
+  s.value.assign(bytes, bytes + num_bytes);
+  s.last_tick = tick_;
+}
+
+void cwf_writer::close(uint64_t num_ticks) {
+  if (frame_open_) {
+    this->flush_frame(num_ticks);
+  }
+
+  // index
+  auto index_offset = offset_;
+  for (auto& frame : frames_) {
+    uint64_t entry[] = {frame.offset, frame.start, frame.end};
+    this->write(entry, sizeof(entry));
+  }
+  uint64_t footer[] = {frames_.size(), num_ticks, index_offset};
+  this->write(footer, sizeof(footer));
+  uint32_t magic = CWF_MAGIC;
+  this->write(&magic, sizeof(magic));
+  out_.flush();
+}
+
+void cwf_writer::open_frame(uint64_t tick) {
+  // each frame starts with the current signal values
+  for (auto& s : signals_) {
+    s.data = s.value;
+    s.last_tick = tick;
+  }
+  frame_start_ = tick;
+  frame_open_ = true;
+}
+
+void cwf_writer::flush_frame(uint64_t end) {
+  frames_.push_back({offset_, frame_start_, end});
+
+  // compress the signal chunks
+  std::vector<uint32_t> sizes(2 * signals_.size());
+  zbuf_.clear();
+  for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+    auto& data = signals_[i].data;
+    auto zsize = compressBound(data.size());
+    auto pos = zbuf_.size();
+    zbuf_.resize(pos + zsize);
+    auto status = compress2(zbuf_.data() + pos, &zsize, data.data(), data.size(), Z_BEST_SPEED);
+    CH_CHECK(Z_OK == status, "waveform compression failed");
+    zbuf_.resize(pos + zsize);
+    sizes[2 * i + 0] = zsize;
+    sizes[2 * i + 1] = data.size();
+  }
+  this->write(sizes.data(), sizes.size() * sizeof(uint32_t));
+  this->write(zbuf_.data(), zbuf_.size());
+  frame_open_ = false;
+}
+
+void cwf_writer::write(const void* data, size_t size) {
+  out_.write(reinterpret_cast<const char*>(data), size);
+  offset_ += size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ch {
+namespace internal {
+
+class cwfreaderimpl {
+public:
+
+  cwfreaderimpl(const std::string& file) : in_(file, std::ios::binary) {
+    CH_CHECK(in_.is_open(), "failed to open file '%s'", file.c_str());
+
+    // header
+    uint32_t header[3];
+    this->read_at(0, header, sizeof(header));
+    CH_CHECK(CWF_MAGIC == header[0], "invalid waveform file '%s'", file.c_str());
+    CH_CHECK(CWF_VERSION == header[1], "unsupported waveform version %d", header[1]);
+    uint64_t offset = sizeof(header);
+    signals_.resize(header[2]);
+    for (auto& signal : signals_) {
+      uint32_t desc[2];
+      this->read_at(offset, desc, sizeof(desc));
+      offset += sizeof(desc);
+      signal.width = desc[0];
+      signal.name.resize(desc[1]);
+      this->read_at(offset, signal.name.data(), desc[1]);
+      offset += desc[1];
+    }
+
+    // footer and frame index
+    in_.seekg(0, std::ios::end);
+    uint64_t file_size = in_.tellg();
+    uint64_t footer[3];
+    uint32_t magic = 0;
+    CH_CHECK(file_size >= offset + sizeof(footer) + sizeof(magic), "incomplete waveform file '%s'", file.c_str());
+    this->read_at(file_size - sizeof(magic), &magic, sizeof(magic));
+    CH_CHECK(CWF_MAGIC == magic, "incomplete waveform file '%s'", file.c_str());
+    this->read_at(file_size - sizeof(magic) - sizeof(footer), footer, sizeof(footer));
+    num_ticks_ = footer[1];
+    frames_.resize(footer[0]);
+    if (!frames_.empty()) {
+      this->read_at(footer[2], frames_.data(), frames_.size() * sizeof(frame_t));
+    }
+  }
+
+  ch_tick num_ticks() const {
+    return num_ticks_;
+  }
+
+  uint32_t num_signals() const {
+    return signals_.size();
+  }
+
+  const std::string& signal_name(uint32_t signal) const {
+    return signals_.at(signal).name;
+  }
+
+  uint32_t signal_width(uint32_t signal) const {
+    return signals_.at(signal).width;
+  }
+
+  int find_signal(const std::string& name) const {
+    for (uint32_t i = 0, n = signals_.size(); i < n; ++i) {
+      if (signals_[i].name == name)
+        return i;
+    }
+    return -1;
+  }
+
+  std::vector<std::pair<ch_tick, sdata_type>> read(uint32_t signal, ch_tick start, ch_tick end) {
+    CH_CHECK(signal < signals_.size(), "invalid signal index %d", signal);
+    std::vector<std::pair<ch_tick, sdata_type>> values;
+    end = std::min<ch_tick>(end, num_ticks_);
+    if (start >= end)
+      return values;
+
+    auto width = signals_[signal].width;
+    auto num_bytes = ceildiv(width, 8);
+    std::vector<uint32_t> sizes(2 * signals_.size());
+    std::vector<uint8_t> zdata, data;
+
+    // first frame overlapping the window
+    auto it = std::upper_bound(frames_.begin(), frames_.end(), start,
+      [](ch_tick tick, const frame_t& frame) { return tick < frame.end; });
+
+    for (; it != frames_.end() && it->start < end; ++it) {
+      // locate the signal chunk in the frame
+      this->read_at(it->offset, sizes.data(), sizes.size() * sizeof(uint32_t));
+      uint64_t offset = it->offset + sizes.size() * sizeof(uint32_t);
+      for (uint32_t i = 0; i < signal; ++i) {
+        offset += sizes[2 * i];
+      }
+      auto zsize = sizes[2 * signal + 0];
+      uLongf size = sizes[2 * signal + 1];
+      zdata.resize(zsize);
+      data.resize(size);
+      this->read_at(offset, zdata.data(), zsize);
+      auto status = uncompress(data.data(), &size, zdata.data(), zsize);
+      CH_CHECK(Z_OK == status && size == data.size(), "corrupted waveform data");
+
+      // decode the value changes, the first one at the frame start
+      const uint8_t* in = data.data();
+      auto in_end = in + data.size();
+      ch_tick tick = it->start;
+      bool first = true;
+      while (in < in_end) {
+        if (!first) {
+          tick += get_varint(in, in_end);
+        }
+        first = false;
+        CH_CHECK(in + num_bytes <= in_end, "corrupted waveform data");
+        if (tick >= end)
+          break;
+        sdata_type value(width);
+        value.write(0, in, 1, 0, width);
+        in += num_bytes;
+        if (tick <= start) {
+          // latest value at the window start
+          if (values.empty()) {
+            values.emplace_back(start, std::move(value));
+          } else {
+            values.back().second = std::move(value);
+          }
+        } else if (tick != it->start || values.back().second != value) {
+          // values carried into a frame are not changes
+          values.emplace_back(tick, std::move(value));
+        }
+      }
+    }
+    return values;
+  }
+
+private:
+
+  struct signal_t {
+    std::string name;
+    uint32_t width;
+  };
+
+  struct frame_t {
+    uint64_t offset;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  void read_at(uint64_t offset, void* data, size_t size) {
+    in_.seekg(offset);
+    in_.read(reinterpret_cast<char*>(data), size);
+    CH_CHECK(in_.good(), "failed to read waveform data");
+  }
+
+  std::ifstream in_;
+  std::vector<signal_t> signals_;
+  std::vector<frame_t> frames_;
+  ch_tick num_ticks_;
+};
+
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ch_cwfreader::ch_cwfreader(const std::string& file)
+  : impl_(new cwfreaderimpl(file))
+{}
+
+ch_cwfreader::~ch_cwfreader() {
+  delete impl_;
+}
+
+ch_tick ch_cwfreader::num_ticks() const {
+  return impl_->num_ticks();
+}
+
+uint32_t ch_cwfreader::num_signals() const {
+  return impl_->num_signals();
+}
+
+const std::string& ch_cwfreader::signal_name(uint32_t signal) const {
+  return impl_->signal_name(signal);
+}
+
+uint32_t ch_cwfreader::signal_width(uint32_t signal) const {
+  return impl_->signal_width(signal);
+}
+
+int ch_cwfreader::find_signal(const std::string& name) const {
+  return impl_->find_signal(name);
+}
+
+std::vector<std::pair<ch_tick, sdata_type>>
+ch_cwfreader::read(uint32_t signal, ch_tick start, ch_tick end) const {
+  return impl_->read(signal, start, end);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.h"
+
+namespace ch {
+namespace internal {
+
+static constexpr uint32_t CWF_MAGIC   = 0x46574843; // "CHWF"
+static constexpr uint32_t CWF_VERSION = 1;
+
+// writer of the compact waveform format (CWF).
+// the trace is split into frames of ticks, each frame stores the value
+// changes of every signal as a separately compressed chunk starting with
+// the signal value at the frame start. a frame index ends the file.
+class cwf_writer {
+public:
+
+  // ticks per frame, the unit of compression and random access
+  static constexpr uint32_t FRAME_TICKS = 4096;
+
+  // signals are given as (name, width)
+  cwf_writer(std::ostream& out,
+             const std::vector<std::pair<std::string, uint32_t>>& signals);
+
+  void begin_tick(uint64_t tick);
+
+  // records the value of a signal at the current tick
+  void set_value(uint32_t signal, const uint64_t* src, uint32_t src_offset);
+
+  // writes the last frame and the index
+  void close(uint64_t num_ticks);
+
+private:
+
+  struct signal_t {
+    uint32_t width;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> value;
+    uint64_t last_tick;
+  };
+
+  struct frame_t {
+    uint64_t offset;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  void open_frame(uint64_t tick);
+
+  void flush_frame(uint64_t end);
+
+  void write(const void* data, size_t size);
+
+  std::ostream& out_;
+  std::vector<signal_t> signals_;
+  std::vector<frame_t> frames_;
+  std::vector<uint64_t> words_;
+  std::vector<uint8_t> zbuf_;
+  uint64_t offset_;
+  uint64_t frame_start_;
+  uint64_t tick_;
+  bool frame_open_;
+};
+
+}
+}
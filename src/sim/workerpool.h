@@ -0,0 +1,105 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace ch {
+namespace internal {
+
+class worker_pool {
+public:
+
+  worker_pool(uint32_t num_threads)
+    : job_(nullptr)
+    , epoch_(0)
+    , pending_(0)
+    , arrived_(0)
+    , generation_(0)
+    , stop_(false)
+    , num_threads_(num_threads) {
+    for (uint32_t i = 1; i < num_threads; ++i) {
+      workers_.emplace_back(&worker_pool::worker, this, i);
+    }
+  }
+
+  ~worker_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // runs job(tid) on all threads, the caller is thread 0
+  void run(const std::function<void(uint32_t)>& job) {
+    job_ = &job;
+    pending_ = num_threads_ - 1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++epoch_;
+    }
+    cv_.notify_all();
+    job(0);
+    spin_wait([&]() { return 0 == pending_; });
+  }
+
+  void barrier() {
+    auto generation = generation_.load();
+    if (arrived_.fetch_add(1) + 1 == num_threads_) {
+      arrived_ = 0;
+      ++generation_;
+    } else {
+      spin_wait([&]() { return generation != generation_; });
+    }
+  }
+
+private:
+
+  static constexpr uint32_t SPIN_LIMIT = 4096;
+
+  template <typename P>
+  static void spin_wait(const P& pred) {
+    for (uint32_t i = 0; !pred(); ++i) {
+      if (i >= SPIN_LIMIT) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void worker(uint32_t tid) {
+    uint64_t epoch = 0;
+    for (;;) {
+      // spin briefly for the next cycle before going to sleep
+      for (uint32_t i = 0; i < SPIN_LIMIT && epoch == epoch_; ++i);
+      if (epoch == epoch_) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]() { return stop_ || epoch != epoch_; });
+        if (stop_)
+          return;
+      }
+      epoch = epoch_;
+      (*job_)(tid);
+      --pending_;
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  const std::function<void(uint32_t)>* job_;
+  std::atomic<uint64_t> epoch_;
+  std::atomic<uint32_t> pending_;
+  std::atomic<uint32_t> arrived_;
+  std::atomic<uint32_t> generation_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_;
+  uint32_t num_threads_;
+};
+
+}
+}
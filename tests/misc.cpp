@@ -384,6 +384,23 @@ TEST_CASE("misc", "[misc]") {
       auto y = static_cast<int32_t>(q);
       return (0x707 == y);
     });
+
+    TESTX([]()->bool {
+      // moves between inline and heap storage
+      RetCheck ret;
+      sdata_type x(100, "123456789abcdef0123456789_h");
+      sdata_type y(std::move(x));
+      ret &= (x.empty() && y == sdata_type(100, "123456789abcdef0123456789_h"));
+      sdata_type z(300, 0x707);
+      z = std::move(y);
+      ret &= (100 == z.size() && z == sdata_type(100, "123456789abcdef0123456789_h"));
+      y = sdata_type(300, "1_h");
+      z = y;
+      z.resize(20);
+      z = 0x707;
+      ret &= (static_cast<int32_t>(z) == 0x707 && y.is_one());
+      return ret;
+    });
   }
 
   SECTION("sign_ext", "[sign_ext]") {
@@ -18,6 +18,102 @@ struct inverter {
   }
 };
 
+template <typename T>
+struct accumulator {
+  __io (
+    __in (T)  in,
+    __out (T) out
+  );
+
+  void describe() {
+    ch_reg<T> sum(0);
+    sum->next = sum + io.in;
+    io.out = sum;
+  }
+};
+
+template <typename T>
+struct delayed_accumulator {
+  __io (
+    __in (T)  in,
+    __out (T) out,
+    __out (T) delayed
+  );
+
+  void describe() {
+    ch_reg<T> sum(0);
+    sum->next = sum + io.in;
+    io.out = sum;
+    io.delayed = ch_delay(sum, 3);
+  }
+};
+
+template <typename T>
+struct wide_alu {
+  __io (
+    __in (T)          a,
+    __in (T)          b,
+    __in (ch_uint8)   s,
+    __out (T)         sum,
+    __out (T)         diff,
+    __out (T)         prod,
+    __out (T)         shl,
+    __out (T)         shr,
+    __out (T)         sel,
+    __out (ch_bool)   lt,
+    __out (ch_bool)   any
+  );
+
+  void describe() {
+    io.sum  = io.a + io.b;
+    io.diff = io.a - io.b;
+    io.prod = io.a * io.b;
+    io.shl  = io.a << io.s;
+    io.shr  = io.a >> io.s;
+    io.sel  = ch_sel(io.a < io.b, io.a, ch_sel(io.a == io.b, ~io.b, io.b));
+    io.lt   = io.a < io.b;
+    io.any  = ch_orr(io.a ^ io.b);
+  }
+};
+
+struct mux_accumulator {
+  __io (
+    __in (ch_uint8)  in,
+    __out (ch_uint8) out,
+    __out (ch_bool)  hit
+  );
+
+  void describe() {
+    ch_reg<ch_uint8> sum(0);
+    auto lo = ch_slice<4>(io.in);
+    auto hi = ch_slice<4>(io.in, 4);
+    sum->next = ch_sel(lo > hi, io.in + sum, ch_sel(lo == hi, io.in ^ sum, sum - io.in));
+    io.out = sum;
+    io.hit = (lo == 3) && (hi != 0);
+  }
+};
+
+struct dual_clock_counter {
+  __io (
+    __in (ch_bool)   clk2,
+    __out (ch_uint8) fast,
+    __out (ch_uint8) slow
+  );
+
+  void describe() {
+    ch_reg<ch_uint8> fast(0);
+    fast->next = fast + 1;
+
+    ch_pushcd(io.clk2);
+    ch_reg<ch_uint8> slow(0);
+    slow->next = slow + 1;
+    ch_popcd();
+
+    io.fast = fast;
+    io.slow = slow;
+  }
+};
+
 }
 
 TEST_CASE("simulation", "[sim]") {
@@ -39,6 +135,372 @@ TEST_CASE("simulation", "[sim]") {
     });
   }
 
+  SECTION("lanes", "[lanes]") {
+    TESTX([]()->bool {
+      ch_device<accumulator<ch_uint8>> device;
+      ch_simopts options;
+      options.num_lanes = 8;
+      ch_simulator sim(device, options);
+      for (uint32_t i = 0; i < sim.num_lanes(); ++i) {
+        sim.poke(i, device.io.in, i + 1);
+      }
+      sim.run(8);
+      bool ret = (sim.num_lanes() == 8);
+      for (uint32_t i = 0; i < sim.num_lanes(); ++i) {
+        ret &= (sim.peek(i, device.io.out) == 3 * (i + 1));
+      }
+      ret &= (device.io.out == sim.peek(0, device.io.out));
+      return ret;
+    });
+  }
+
+  SECTION("tiered", "[tiered]") {
+    TESTX([]()->bool {
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simopts options;
+      options.num_lanes = 2;
+      ch_simulator sim(device, options);
+      sim.poke(0, device.io.in, 1);
+      sim.poke(1, device.io.in, 3);
+      bool ret = true;
+      auto t = sim.reset(0);
+      for (int i = 1; i <= 100; ++i) {
+        if (51 == i) {
+          // the remaining cycles run on the compiled code
+          sim.wait_jit();
+        }
+        t = sim.step(t, 2);
+        for (uint32_t l = 0; l < sim.num_lanes(); ++l) {
+          auto in = (0 == l) ? 1 : 3;
+          ret &= (sim.peek(l, device.io.out) == i * in);
+          if (i > 3) {
+            ret &= (sim.peek(l, device.io.delayed) == (i - 3) * in);
+          }
+        }
+      }
+      auto tiered = (0 == (ch_getflags() & (ch_flags::disable_jit | ch_flags::disable_tex
+                                          | ch_flags::dump_ast | ch_flags::dump_asm)));
+    #if !defined(LIBJIT) && !defined(LLVMJIT)
+      tiered = false;
+    #endif
+      ret &= (sim.num_jit_swaps() == (tiered ? 1u : 0u));
+      return ret;
+    });
+  }
+
+  SECTION("threads", "[threads]") {
+    TESTX([]()->bool {
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simopts options;
+      options.num_lanes = 2;
+      options.num_threads = 4;
+      ch_simulator sim(device, options);
+      sim.wait_jit();
+      ch_stats(std::cout, sim);
+      sim.poke(0, device.io.in, 1);
+      sim.poke(1, device.io.in, 3);
+      bool ret = (sim.num_threads() == 4);
+      auto t = sim.reset(0);
+      for (int i = 1; i <= 20; ++i) {
+        t = sim.step(t, 2);
+        for (uint32_t l = 0; l < sim.num_lanes(); ++l) {
+          auto in = (0 == l) ? 1 : 3;
+          ret &= (sim.peek(l, device.io.out) == i * in);
+          if (i > 3) {
+            ret &= (sim.peek(l, device.io.delayed) == (i - 3) * in);
+          }
+        }
+      }
+      return ret;
+    });
+  }
+
+  SECTION("activity", "[activity]") {
+    TESTX([]()->bool {
+      auto_cflags_enable tex_off(ch_flags::disable_tex);
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simulator sim(device);
+      bool ret = true;
+      int sum = 0;
+      auto t = sim.reset(0);
+      for (int i = 1; i <= 30; ++i) {
+        // hold the input for a few cycles between changes
+        auto in = (i / 4) % 3;
+        device.io.in = in;
+        t = sim.step(t, 2);
+        sum += in;
+        ret &= (device.io.out == sum);
+      }
+      return ret;
+    });
+    TESTX([]()->bool {
+      auto_cflags_enable act_off(ch_flags::disable_tex | ch_flags::disable_act);
+      ch_device<accumulator<ch_uint8>> device;
+      ch_simulator sim(device);
+      bool ret = true;
+      int sum = 0;
+      auto t = sim.reset(0);
+      for (int i = 1; i <= 10; ++i) {
+        auto in = (i / 3) + 1;
+        device.io.in = in;
+        t = sim.step(t, 2);
+        sum += in;
+        ret &= (device.io.out == sum);
+      }
+      return ret;
+    });
+    TESTX([]()->bool {
+      auto_cflags_enable tex_off(ch_flags::disable_tex);
+      ch_device<inverter<ch_bit2>> device;
+      ch_simulator sim(device);
+      device.io.in = 2;
+      sim.eval();
+      bool ret = (1 == device.io.out);
+      sim.eval();
+      ret &= (1 == device.io.out);
+      device.io.in = 1;
+      sim.eval();
+      ret &= (2 == device.io.out);
+      return ret;
+    });
+  }
+
+  SECTION("layout", "[layout]") {
+    auto run = [](int flags)->bool {
+      auto_cflags_enable tex_off(flags);
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simulator sim(device);
+      bool ret = true;
+      int sum = 0;
+      std::vector<int> sums;
+      auto t = sim.reset(0);
+      for (int i = 1; i <= 16; ++i) {
+        device.io.in = i;
+        t = sim.step(t, 2);
+        sum += i;
+        sums.push_back(sum);
+        ret &= (device.io.out == sum);
+        if (i > 3) {
+          ret &= (device.io.delayed == sums[i - 4]);
+        }
+      }
+      return ret;
+    };
+    TESTX([&]()->bool {
+      return run(static_cast<int>(ch_flags::disable_tex));
+    });
+    TESTX([&]()->bool {
+      return run(ch_flags::disable_tex | ch_flags::disable_lay);
+    });
+  }
+
+  SECTION("wide", "[wide]") {
+    auto run = [](auto sdata, int flags)->bool {
+      using S = decltype(sdata);
+      using T = ch_logic_t<S>;
+      auto_cflags_enable wide_off(flags);
+      ch_device<wide_alu<T>> device;
+      ch_simulator sim(device);
+      bool ret = true;
+      uint64_t seed = 0x9e3779b97f4a7c15ull;
+      auto next = [&]() {
+        S x(0);
+        for (int j = 0; j < 4; ++j) {
+          seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+          x = (x << 64) | S(seed >> 1);
+        }
+        return x;
+      };
+      auto t = sim.reset(0);
+      for (int i = 0; i < 16; ++i) {
+        S a = next();
+        S b = (i % 4) ? next() : a;
+        int s = ((i * 37) % ch_width_v<T> + (i % 5 == 0) * 250) & 0xff;
+        device.io.a = a;
+        device.io.b = b;
+        device.io.s = s;
+        t = sim.step(t, 2);
+        ret &= (device.io.sum == (a + b));
+        ret &= (device.io.diff == (a - b));
+        ret &= (device.io.prod == (a * b));
+        ret &= (device.io.shl == (a << s));
+        ret &= (device.io.shr == (a >> s));
+        ret &= (device.io.sel == ((a < b) ? a : ((a == b) ? ~b : b)));
+        ret &= (device.io.lt == (a < b));
+        ret &= (device.io.any == (a != b));
+      }
+      return ret;
+    };
+    TESTX([&]()->bool {
+      return run(ch_suint<130>(0), 0);
+    });
+    TESTX([&]()->bool {
+      return run(ch_sint<200>(0), 0);
+    });
+    TESTX([&]()->bool {
+      return run(ch_suint<256>(0), 0);
+    });
+    TESTX([&]()->bool {
+      return run(ch_sint<200>(0), static_cast<int>(ch_flags::disable_wid));
+    });
+  }
+
+  SECTION("clocks", "[clocks]") {
+    TESTX([]()->bool {
+      ch_device<dual_clock_counter> device;
+      ch_simulator sim(device);
+      sim.add_clock(device.io.clk2, 6);
+      auto t = sim.reset(0);
+      auto fast = static_cast<int>(device.io.fast);
+      auto slow = static_cast<int>(device.io.slow);
+      t = sim.step(t, 12);
+      bool ret = (device.io.fast == fast + 6);
+      ret &= (device.io.slow == slow + 2);
+      t = sim.step(t, 5);
+      ret &= (device.io.fast == fast + 8);
+      ret &= (device.io.slow == slow + 3);
+      return ret;
+    });
+    TESTX([]()->bool {
+      ch_device<dual_clock_counter> device;
+      ch_simopts options;
+      options.num_lanes = 2;
+      ch_simulator sim(device, options);
+      sim.add_clock(device.io.clk2, 4, 1);
+      auto t = sim.reset(0);
+      auto slow = static_cast<int>(sim.peek(1, device.io.slow));
+      t = sim.step(t, 16);
+      return (sim.peek(0, device.io.slow) == slow + 4)
+          && (sim.peek(1, device.io.slow) == slow + 4);
+    });
+  }
+
+  SECTION("checkpoint", "[checkpoint]") {
+    TESTX([]()->bool {
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simulator sim(device);
+      device.io.in = 2;
+      auto t = sim.reset(0);
+      t = sim.step(t, 20);
+      std::stringstream buf;
+      sim.checkpoint(buf);
+      auto out = static_cast<int>(device.io.out);
+      auto delayed = static_cast<int>(device.io.delayed);
+      bool ret = (20 == out) && (14 == delayed);
+      device.io.in = 5;
+      t = sim.step(t, 10);
+      ret &= (device.io.out == out + 25);
+      sim.restore(buf);
+      ret &= (device.io.out == out);
+      ret &= (device.io.delayed == delayed);
+      ret &= (device.io.in == 2);
+      t = sim.step(t, 2);
+      ret &= (device.io.out == out + 2);
+      ret &= (device.io.delayed == delayed + 2);
+      return ret;
+    });
+    TESTX([]()->bool {
+      auto_cflags_enable tex_off(ch_flags::disable_tex);
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simopts options;
+      options.num_lanes = 2;
+      ch_simulator sim(device, options);
+      sim.poke(0, device.io.in, 1);
+      sim.poke(1, device.io.in, 3);
+      auto t = sim.reset(0);
+      t = sim.step(t, 8);
+      sim.checkpoint("checkpoint.bin");
+      t = sim.step(t, 8);
+      sim.restore("checkpoint.bin");
+      t = sim.step(t, 2);
+      return (sim.peek(0, device.io.out) == 5)
+          && (sim.peek(1, device.io.out) == 15)
+          && (sim.peek(1, device.io.delayed) == 6);
+    });
+    TESTX([]()->bool {
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      ch_simulator sim(device);
+      device.io.in = 1;
+      auto t = sim.reset(0);
+      t = sim.step(t, 10);
+      auto fork = sim.fork();
+      fork.poke(0, device.io.in, 4);
+      bool ret = (fork.peek(0, device.io.out) == 5);
+      auto t2 = fork.step(t, 4);
+      ret &= (fork.peek(0, device.io.out) == 13);
+      ret &= (device.io.out == 5);
+      t = sim.step(t, 4);
+      ret &= (device.io.out == 7);
+      ret &= (fork.peek(0, device.io.out) == 13);
+      fork.step(t2, 2);
+      ret &= (fork.peek(0, device.io.delayed) == 5);
+      return ret;
+    });
+  }
+
+  SECTION("ircache", "[ircache]") {
+    TESTX([]()->bool {
+      uint32_t iterations = 0;
+      auto run = [&]()->int {
+        ch_device<mux_accumulator> device;
+        iterations = ch_optstats(device).iterations;
+        ch_simulator sim(device);
+        device.io.in = 0x35;
+        auto t = sim.reset(0);
+        sim.step(t, 4);
+        return static_cast<int>(device.io.out);
+      };
+      char dir[] = "/tmp/cash-ircache-XXXXXX";
+      if (nullptr == mkdtemp(dir))
+        return false;
+      ch_setircache(dir, dir);
+      // the empty cache misses and stores the design
+      auto stored = run();
+      bool ret = (iterations != 0);
+      // the reloaded design skips the optimizer
+      auto cached = run();
+      ret &= (0 == iterations);
+      ch_setircache("");
+      auto elaborated = run();
+      ret &= (iterations != 0);
+      ret &= (stored == elaborated);
+      ret &= (cached == elaborated);
+      ret &= (0 == system(stringf("rm -rf %s", dir).c_str()));
+      return ret;
+    });
+  }
+
+  SECTION("chain", "[chain]") {
+    TESTX([]()->bool {
+      // a deep combinational chain elaborates without recursing per node
+      static constexpr uint32_t depth = 50000;
+      ch_device<GenericModule<ch_uint32, ch_uint32>> device(
+        [](ch_uint32 in)->ch_uint32 {
+          std::vector<ch_uint32> chain;
+          chain.reserve(depth + 1);
+          chain.emplace_back(in);
+          for (uint32_t i = 0; i < depth; ++i) {
+            auto& x = chain.back();
+            chain.emplace_back((i & 1) ? ch_uint32(x + i) : ch_uint32(x ^ i));
+          }
+          return chain.back();
+        }
+      );
+      ch_simulator sim(device);
+      bool ret = true;
+      for (uint32_t in : {0x0u, 0x1234u, 0xdeadbeefu}) {
+        uint32_t x = in;
+        for (uint32_t i = 0; i < depth; ++i) {
+          x = (i & 1) ? (x + i) : (x ^ i);
+        }
+        device.io.in = in;
+        sim.run(1);
+        ret &= (device.io.out == x);
+      }
+      return ret;
+    });
+  }
+
   SECTION("tracer", "[tracer]") {
     TESTX([]()->bool {
       ch_device<inverter<ch_bit2>> device;
@@ -67,6 +529,110 @@ TEST_CASE("simulation", "[sim]") {
       t4.toVCD("trace.vcd");
       return (1 == device1.io.out && 1 == device2.io.out);
     });
+    TESTX([]()->bool {
+      // streamed traces match the ones written at the end
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      auto trace = [&](int mode) {
+        device.io.in = 0;
+        ch_tracer tracer(device);
+        if (1 == mode) {
+          tracer.streamText("stream.log", 2);
+        } else if (2 == mode) {
+          tracer.streamVCD("stream.vcd", 2);
+        }
+        auto t = tracer.reset(0);
+        for (int i = 0; i < 600; ++i) {
+          device.io.in = (i % 7) ? 1 : 0;
+          t = tracer.step(t, 2);
+        }
+        if (mode) {
+          tracer.closeStream();
+        } else {
+          tracer.toText("memory.log");
+          tracer.toVCD("memory.vcd");
+        }
+      };
+      auto read_file = [](const char* file) {
+        std::ifstream in(file);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+      };
+      trace(0);
+      trace(1);
+      trace(2);
+      auto text = read_file("memory.log");
+      auto vcd = read_file("memory.vcd");
+      return (text.size() > 1000 && text == read_file("stream.log")
+           && vcd.size() > 1000 && vcd == read_file("stream.vcd"));
+    });
+    TESTX([]()->bool {
+      // binary traces span several frames and read back by window
+      ch_device<delayed_accumulator<ch_uint<80>>> device;
+      std::map<ch_tick, uint64_t> sums;
+      auto trace = [&](bool streamed) {
+        device.io.in = 0;
+        ch_tracer tracer(device);
+        if (streamed) {
+          tracer.streamCWF("stream.cwf", 2);
+        }
+        auto t = tracer.reset(0);
+        uint64_t sum = 0;
+        for (int i = 0; i < 6000; ++i) {
+          device.io.in = (i % 7) ? 1 : 0;
+          t = tracer.step(t, 2);
+          sum += (i % 7) ? 1 : 0;
+          sums[t] = sum;
+        }
+        if (streamed) {
+          tracer.closeStream();
+        } else {
+          tracer.toCWF("memory.cwf");
+        }
+      };
+      auto read_file = [](const char* file) {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+      };
+      trace(false);
+      trace(true);
+      if (read_file("memory.cwf") != read_file("stream.cwf"))
+        return false;
+
+      ch_cwfreader reader("memory.cwf");
+      auto out = reader.find_signal("io.out");
+      if (reader.num_ticks() < 12000 || out < 0 || reader.signal_width(out) != 80
+       || reader.find_signal("io.missing") != -1)
+        return false;
+      // decoded values match the simulated sums on both sides of each frame boundary
+      for (ch_tick boundary : {4096, 8192}) {
+        for (ch_tick tick = boundary - 6; tick <= boundary + 6; tick += 2) {
+          auto value = reader.read(out, tick, tick + 1);
+          if (value.size() != 1 || value[0].second != sdata_type(80, sums.at(tick)))
+            return false;
+        }
+      }
+      auto all = reader.read(out, 0, reader.num_ticks());
+      for (size_t i = 1; i < all.size(); ++i) {
+        if (all[i].first <= all[i-1].first || all[i].second == all[i-1].second)
+          return false;
+      }
+      // a window matches the full read from the value at its start
+      ch_tick start = 5001, end = 9000;
+      auto window = reader.read(out, start, end);
+      auto it = std::upper_bound(all.begin(), all.end(), start,
+        [](ch_tick tick, const std::pair<ch_tick, sdata_type>& v) { return tick < v.first; });
+      if (window.empty() || window[0].first != start || window[0].second != std::prev(it)->second)
+        return false;
+      for (size_t i = 1; i < window.size(); ++i, ++it) {
+        if (it == all.end() || window[i].first != it->first || window[i].second != it->second)
+          return false;
+      }
+      return (all.size() > 5000
+           && (it == all.end() || it->first >= end));
+    });
   }
 
   SECTION("stats", "[stats]") {
@@ -91,5 +657,66 @@ TEST_CASE("simulation", "[sim]") {
       ch_stats(std::cout, device);
       return true;
     });
+
+    TESTX([]()->bool {
+      ch_device<GenericModule2<ch_uint4, ch_uint4, ch_uint4>> device(
+        [](ch_uint4 lhs, ch_uint4 rhs)->ch_uint4 {
+          auto a = (lhs & rhs) | 0;
+          auto b = (lhs & rhs) | 0;
+          return a ^ (b + 1);
+        }
+      );
+      auto stats = ch_optstats(device);
+      int ret = (stats.iterations != 0);
+      ret &= (stats.nodes_after < stats.nodes_before);
+      ret &= (stats.pass("CSE").runs != 0);
+      ret &= (stats.pass("CFO").changes != 0);
+      ch_simulator sim(device);
+      auto sim_stats = ch_optstats(sim);
+      ret &= (sim_stats.nodes_after == stats.nodes_after);
+      return !!ret;
+    });
+
+    TESTX([]()->bool {
+      ch_device<GenericModule2<ch_uint8, ch_uint8, ch_uint<128>>> device(
+        [](ch_uint8 lhs, ch_uint8 rhs)->ch_uint<128> {
+          ch_uint<128> x(lhs), y(rhs);
+          auto z = (x + y) ^ (x << 4);
+          ch_uint<128> w(ch_slice<8>(z * 3 + ~x));
+          return w | (z << 8);
+        }
+      );
+      auto stats = ch_optstats(device);
+      int ret = (stats.pass("BWN").changes != 0);
+      ch_simulator sim(device);
+      device.io.lhs = 200;
+      device.io.rhs = 100;
+      sim.run(2);
+      ret &= (device.io.out == 0xdac3b);
+      return !!ret;
+    });
+
+    TESTX([]()->bool {
+      auto_cflags_enable hc_on(ch_flags::hash_consing);
+      ch_device<GenericModule2<ch_uint4, ch_uint4, ch_uint4>> device(
+        [](ch_uint4 lhs, ch_uint4 rhs)->ch_uint4 {
+          auto a = (lhs + rhs) ^ (lhs & rhs);
+          auto b = (lhs + rhs) ^ (lhs & rhs);
+          ch_uint4 c(a - b);
+          __if (lhs > rhs) {
+            c = (lhs + rhs) - (lhs & rhs);
+          };
+          return c;
+        }
+      );
+      auto stats = ch_optstats(device);
+      int ret = (stats.pass("CSE").changes == 0);
+      ch_simulator sim(device);
+      device.io.lhs = 9;
+      device.io.rhs = 5;
+      sim.run(2);
+      ret &= (device.io.out == 13);
+      return !!ret;
+    });
   }
 }
@@ -422,6 +422,76 @@ TEST_CASE("system", "[system]") {
       a %= b;
       return a == 1;
     });
+    TESTX([]()->bool {
+      ch_suint<1024> one(1);
+      auto a = (one << 900) + 5;
+      auto b = (one << 900) + 3;
+      RetCheck ret;
+      ret &= ((a + b) == (one << 901) + 8);
+      ret &= ((a - b) == 2);
+      ret &= ((b - a) == ~ch_suint<1024>(1));
+      ret &= (a > b);
+      ret &= (b < a);
+      ret &= (a != b);
+      ret &= ((a & b) == (one << 900) + 1);
+      ret &= ((a | b) == (one << 900) + 7);
+      ret &= ((a ^ b) == 6);
+      ret &= (~~a == a);
+      ret &= (ch_slice<960>(a, 40) == (ch_suint<960>(1) << 860));
+      return ret;
+    });
+    TESTX([]()->bool {
+      // compare the host kernels with the generic ones
+      auto host = simd::detect_isa();
+      std::vector<uint64_t> x(41), y(41), r0(41), r1(41);
+      uint64_t seed = 0x9e3779b97f4a7c15ull;
+      for (uint32_t i = 0; i < 41; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        x[i] = seed;
+        y[i] = (i % 3) ? seed : ~seed;
+      }
+      RetCheck ret;
+      for (int isa = 0; isa <= static_cast<int>(host); ++isa) {
+        auto& k = simd::get_kernels(static_cast<simd::isa_type>(isa));
+        auto& g = simd::get_kernels(simd::isa_type::generic);
+        for (uint32_t n = 1; n <= 40; ++n) {
+          k.bit_xor(r0.data(), x.data(), y.data(), n);
+          g.bit_xor(r1.data(), x.data(), y.data(), n);
+          ret &= std::equal(r0.begin(), r0.begin() + n, r1.begin());
+          k.bit_inv(r0.data(), x.data(), n);
+          g.bit_inv(r1.data(), x.data(), n);
+          ret &= std::equal(r0.begin(), r0.begin() + n, r1.begin());
+          k.shr(r0.data(), x.data(), n, 13);
+          g.shr(r1.data(), x.data(), n, 13);
+          ret &= std::equal(r0.begin(), r0.begin() + n, r1.begin());
+          ret &= (k.eq(x.data(), x.data(), n) == true);
+          ret &= (k.eq(x.data(), y.data(), n) == g.eq(x.data(), y.data(), n));
+          ret &= (k.diff(x.data(), y.data(), n) == g.diff(x.data(), y.data(), n));
+          ret &= (k.diff(x.data(), x.data(), n) == -1);
+        }
+      }
+      return ret;
+    });
+    TESTX([]()->bool {
+      // wide enough for the Karatsuba and multi-word division paths
+      ch_suint<4096> a(0), b(0);
+      uint64_t seed = 0x9e3779b97f4a7c15ull;
+      for (int i = 0; i < 32; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        a = (a << 64) | ch_suint<4096>(seed);
+        b = (b << 64) | ch_suint<4096>(~seed);
+      }
+      auto c = (b >> 1000) + 7;
+      RetCheck ret;
+      ret &= ((a * b) / b == a);
+      ret &= ((a * b) % b == 0);
+      ret &= ((a * b) == (b * a));
+      ret &= ((a * c) / a == c);
+      ret &= ((a / c) * c + (a % c) == a);
+      ret &= ((a % c) < c);
+      ret &= (((a * b) - a) / a == b - 1);
+      return ret;
+    });
   }
   SECTION("cast", "[cast]") {
     TESTX([]()->bool {